@@ -0,0 +1,339 @@
+/**
+ * @file Bench.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Pieces shared by the benchmarks: keys, timing and JSON output.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include <unistd.h>
+
+#if defined(__linux__)
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+#endif
+
+#include "Bench.h"
+
+BenchKeys::BenchKeys(std::size_t First, std::size_t Count):
+    keys(Count * BENCH_KEY_STRIDE, '\0') {
+  static const char digits[] = "abcdefghijklmnopqrstuvwxyz012345";
+
+  for (std::size_t i = 0; i < Count; i++) {
+    // splitmix64, a bijection, so no two indices share a key.
+    std::uint64_t mix = First + i + 0x9e3779b97f4a7c15ull;
+    mix = (mix ^ (mix >> 30)) * 0xbf58476d1ce4e5b9ull;
+    mix = (mix ^ (mix >> 27)) * 0x94d049bb133111ebull;
+    mix = mix ^ (mix >> 31);
+
+    char* key = &keys[i * BENCH_KEY_STRIDE];
+    key[0] = 'k';
+
+    // 13 digits of 5 bits cover the 64 bits.
+    for (std::size_t c = 1; c <= 13; c++) {
+      key[c] = digits[mix & 31];
+      mix >>= 5;
+    }
+  }
+}
+
+double GetNanosecondsPerTick() {
+  static const double nanoseconds_per_tick = [] {
+    const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    const std::uint64_t start_ticks = GetTicks();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    const std::uint64_t ticks = GetTicks() - start_ticks;
+    std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    return ticks == 0 ? 1.0 : elapsed.count() / static_cast<double>(ticks);
+  }();
+
+  return nanoseconds_per_tick;
+}
+
+// Histogram stuff
+
+BenchHistogram::BenchHistogram():
+    counts((64 - SUB_BITS + 1) << SUB_BITS, 0), total(0), largest(0), sum(0) {}
+
+void BenchHistogram::record(std::uint64_t Value) {
+  counts[get_bucket(Value)]++;
+  total++;
+  largest = std::max(largest, Value);
+  sum += static_cast<double>(Value);
+}
+
+std::uint64_t BenchHistogram::percentile(double Percentile) const {
+  const double rank = Percentile / 100.0 * static_cast<double>(total);
+  std::uint64_t seen = 0;
+
+  for (std::size_t bucket = 0; bucket < counts.size(); bucket++) {
+    seen += counts[bucket];
+
+    if (seen != 0 && static_cast<double>(seen) >= rank) {
+      return std::min(get_value(bucket), largest);
+    }
+  }
+
+  return largest;
+}
+
+std::uint64_t BenchHistogram::count() const {
+  return total;
+}
+
+std::uint64_t BenchHistogram::count_above(std::uint64_t Value) const {
+  std::uint64_t above = 0;
+
+  for (std::size_t bucket = get_bucket(Value) + 1; bucket < counts.size();
+       bucket++) {
+    above += counts[bucket];
+  }
+
+  return above;
+}
+
+void BenchHistogram::write(std::ostream& out) const {
+  out << "{\"count\": " << total << ", \"mean\": "
+      << (total == 0 ? 0.0 : sum / static_cast<double>(total))
+      << ", \"p50\": " << percentile(50) << ", \"p90\": " << percentile(90)
+      << ", \"p99\": " << percentile(99)
+      << ", \"p999\": " << percentile(99.9) << ", \"max\": " << largest
+      << "}";
+}
+
+std::size_t BenchHistogram::get_bucket(std::uint64_t Value) {
+  if (Value < (std::uint64_t(1) << SUB_BITS)) {
+    return static_cast<std::size_t>(Value);
+  }
+
+  // The position of the highest bit decides the power of two, the next
+  // SUB_BITS bits decide the bucket inside of it.
+#if defined(__GNUC__)
+  const unsigned magnitude = 63 - static_cast<unsigned>(__builtin_clzll(Value));
+#else
+  unsigned magnitude = 0;
+  while ((Value >> magnitude) > 1) {
+    magnitude++;
+  }
+#endif
+
+  const unsigned shift = magnitude - SUB_BITS;
+  const std::size_t group = shift + 1;
+  const std::size_t offset =
+    static_cast<std::size_t>(Value >> shift) - (std::size_t(1) << SUB_BITS);
+
+  return (group << SUB_BITS) + offset;
+}
+
+std::uint64_t BenchHistogram::get_value(std::size_t Bucket) {
+  const std::size_t group = Bucket >> SUB_BITS;
+
+  if (group == 0) {
+    return Bucket;
+  }
+
+  const unsigned shift = static_cast<unsigned>(group - 1);
+  const std::uint64_t offset = Bucket & ((std::size_t(1) << SUB_BITS) - 1);
+  const std::uint64_t base = (std::uint64_t(1) << SUB_BITS) + offset + 1;
+
+  return (base << shift) - 1;
+}
+
+// Counter stuff
+
+//! The names of the counters in the JSON output
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+  "cycles", "instructions", "cache_misses", "branch_misses", "dtlb_misses"
+};
+
+BenchCounters::BenchCounters(bool Enabled): counters() {
+  for (int& counter : counters) {
+    counter = -1;
+  }
+
+#if defined(__linux__)
+  if (!Enabled) {
+    return;
+  }
+
+  const std::uint64_t dtlb_read_miss = PERF_COUNT_HW_CACHE_DTLB
+                                     | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                     | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+  const std::uint32_t types[COUNTER_COUNT] = {
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HW_CACHE
+  };
+
+  const std::uint64_t configs[COUNTER_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    dtlb_read_miss
+  };
+
+  for (std::size_t i = 0; i < COUNTER_COUNT; i++) {
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+
+    attributes.size = sizeof(attributes);
+    attributes.type = types[i];
+    attributes.config = configs[i];
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // There is no glibc wrapper for this one.
+    counters[i] = static_cast<int>(
+      syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0)
+    );
+  }
+#else
+  static_cast<void>(Enabled);
+#endif
+}
+
+BenchCounters::~BenchCounters() {
+  for (int counter : counters) {
+    if (counter >= 0) {
+      close(counter);
+    }
+  }
+}
+
+bool BenchCounters::available() const {
+  for (int counter : counters) {
+    if (counter >= 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void BenchCounters::start() {
+#if defined(__linux__)
+  for (int counter : counters) {
+    if (counter >= 0) {
+      ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+      ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+void BenchCounters::stop(BenchResult& Result) {
+#if defined(__linux__)
+  for (std::size_t i = 0; i < COUNTER_COUNT; i++) {
+    if (counters[i] >= 0) {
+      ioctl(counters[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+
+  for (std::size_t i = 0; i < COUNTER_COUNT; i++) {
+    // The count, the time enabled and the time running.
+    std::uint64_t values[3] = {0, 0, 0};
+
+    if (counters[i] < 0
+        || read(counters[i], values, sizeof(values)) != sizeof(values)
+        || values[2] == 0) {
+      continue;
+    }
+
+    Result.Counters_[i] = static_cast<double>(values[0])
+                        * static_cast<double>(values[1])
+                        / static_cast<double>(values[2]);
+  }
+#else
+  static_cast<void>(Result);
+#endif
+}
+
+// Memory stuff
+
+std::size_t GetResidentBytes() {
+  std::ifstream statm("/proc/self/statm");
+  std::size_t pages = 0;
+  std::size_t resident = 0;
+
+  if (!(statm >> pages >> resident)) {
+    return 0;
+  }
+
+  return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+unsigned GetPercentile(std::vector<unsigned>& samples, double Percentile) {
+  if (samples.empty()) {
+    return 0;
+  }
+
+  const std::size_t rank = std::min(
+    samples.size() - 1,
+    static_cast<std::size_t>(Percentile / 100.0 * samples.size())
+  );
+
+  std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+
+  return samples[rank];
+}
+
+void WriteBenchResult(std::ostream& out, const BenchResult& Result) {
+  const double ops = static_cast<double>(Result.Ops_);
+
+  out << "{\"ops\": " << Result.Ops_;
+
+  if (Result.Ops_ == 0 || Result.Seconds_ <= 0) {
+    out << ", \"ns_per_op\": null, \"ops_per_sec\": null";
+  } else {
+    out << ", \"ns_per_op\": " << Result.Seconds_ * 1e9 / ops
+        << ", \"ops_per_sec\": " << ops / Result.Seconds_;
+  }
+
+  if (Result.Ops_ == 0 || Result.Probes_ < 0) {
+    out << ", \"probes_per_op\": null";
+  } else {
+    out << ", \"probes_per_op\": " << Result.Probes_ / ops;
+  }
+
+  // Only the counters that were read.
+  for (std::size_t i = 0; i < COUNTER_COUNT; i++) {
+    if (Result.Ops_ != 0 && Result.Counters_[i] >= 0) {
+      out << ", \"" << COUNTER_NAMES[i]
+          << "_per_op\": " << Result.Counters_[i] / ops;
+    }
+  }
+
+  out << "}";
+}
+
+void WriteJsonString(std::ostream& out, const char* Text) {
+  out << '"';
+
+  for (; *Text != '\0'; Text++) {
+    if (*Text == '"' || *Text == '\\') {
+      out << '\\';
+    }
+    out << *Text;
+  }
+
+  out << '"';
+}
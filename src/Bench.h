@@ -0,0 +1,328 @@
+/**
+ * @file Bench.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Pieces shared by the benchmarks: keys, timing and JSON output.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+#endif
+
+#ifndef BENCHH
+#define BENCHH
+//---------------------------------------------------------------------------
+
+//! The amount of bytes every generated key takes (including the '\0')
+const std::size_t BENCH_KEY_STRIDE = 16;
+
+/**
+ * @brief Keys for the benchmarks, stored back to back. Key i is made from a
+ * mix of i, so different indices always give different keys and consecutive
+ * indices don't give similar ones.
+ */
+class BenchKeys {
+public:
+
+  /**
+   * @brief Generates the keys for the indices [First, First + Count).
+   *
+   * @param First The first index.
+   * @param Count The amount of keys.
+   */
+  BenchKeys(std::size_t First, std::size_t Count);
+
+  /**
+   * @brief Returns a key.
+   *
+   * @param Index The position of the key (not the index it was made from).
+   * @return The key.
+   */
+  const char* operator[](std::size_t Index) const {
+    return &keys[Index * BENCH_KEY_STRIDE];
+  }
+
+  /**
+   * @brief The amount of keys.
+   *
+   * @return The amount of keys.
+   */
+  std::size_t size() const { return keys.size() / BENCH_KEY_STRIDE; }
+
+private:
+
+  /**
+   * @brief The keys.
+   */
+  std::vector<char> keys;
+};
+
+//! The hardware counters BenchCounters can read
+enum BenchCounter {
+  COUNTER_CYCLES,
+  COUNTER_INSTRUCTIONS,
+  COUNTER_CACHE_MISSES,
+  COUNTER_BRANCH_MISSES,
+  COUNTER_DTLB_MISSES,
+  COUNTER_COUNT
+};
+
+/**
+ * @brief What a benchmark measured.
+ */
+struct BenchResult {
+  std::size_t Ops_{0}; //!< Amount of operations
+  double Seconds_{0};  //!< Time it took
+  double Probes_{0};   //!< Probes done (negative if unknown)
+
+  //! Hardware counters, negative for the ones that weren't read
+  double Counters_[COUNTER_COUNT]{-1, -1, -1, -1, -1};
+};
+
+/**
+ * @brief Reads hardware performance counters of the calling thread with
+ * perf_event_open (Linux only). Counters the kernel or the machine don't
+ * allow are left out, and when they are multiplexed the counts are scaled to
+ * the time they were enabled.
+ */
+class BenchCounters {
+public:
+
+  /**
+   * @brief Opens the counters, or nothing if not Enabled.
+   *
+   * @param Enabled Whether to read the counters at all.
+   */
+  explicit BenchCounters(bool Enabled);
+
+  BenchCounters(const BenchCounters&) = delete;
+  BenchCounters& operator=(const BenchCounters&) = delete;
+
+  /**
+   * @brief Closes the counters.
+   */
+  ~BenchCounters();
+
+  /**
+   * @brief Whether any counter could be opened.
+   *
+   * @return Whether there is something to read.
+   */
+  bool available() const;
+
+  /**
+   * @brief Resets and starts every counter.
+   */
+  void start();
+
+  /**
+   * @brief Stops the counters and writes what they counted since start().
+   *
+   * @param Result Where to write the counts.
+   */
+  void stop(BenchResult& Result);
+
+private:
+
+  /**
+   * @brief The file descriptor of every counter (-1 if it's not open).
+   */
+  int counters[COUNTER_COUNT];
+};
+
+/**
+ * @brief Measures wall clock time.
+ */
+class BenchTimer {
+public:
+
+  /**
+   * @brief Starts the timer.
+   */
+  BenchTimer(): start(std::chrono::steady_clock::now()) {}
+
+  /**
+   * @brief The time since the timer started.
+   *
+   * @return The time in seconds.
+   */
+  double Seconds() const {
+    std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+  }
+
+private:
+
+  /**
+   * @brief When the timer started.
+   */
+  std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * @brief A cheap timestamp: the time stamp counter where there is one, the
+ * steady clock otherwise. Use GetNanosecondsPerTick to turn a difference of
+ * two timestamps into time.
+ *
+ * @return The timestamp.
+ */
+inline std::uint64_t GetTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<std::uint64_t>(
+    std::chrono::steady_clock::now().time_since_epoch().count()
+  );
+#endif
+}
+
+/**
+ * @brief How long a tick of GetTicks is. Measured against the steady clock
+ * the first time it's called, which takes a few milliseconds.
+ *
+ * @return The length of a tick in nanoseconds.
+ */
+double GetNanosecondsPerTick();
+
+/**
+ * @brief A histogram in the style of HdrHistogram: values are counted exactly
+ * up to 2^SUB_BITS and after that every power of two is split into 2^SUB_BITS
+ * buckets, so any value is off by less than 1% and recording is a couple of
+ * shifts and an increment.
+ */
+class BenchHistogram {
+public:
+
+  /**
+   * @brief Creates an empty histogram.
+   */
+  BenchHistogram();
+
+  /**
+   * @brief Counts a value.
+   *
+   * @param Value The value.
+   */
+  void record(std::uint64_t Value);
+
+  /**
+   * @brief The value a percentile of the counted values are at or below.
+   *
+   * @param Percentile The percentile, between 0 and 100.
+   * @return The highest value of the bucket of the percentile (0 if empty).
+   */
+  std::uint64_t percentile(double Percentile) const;
+
+  /**
+   * @brief The amount of values counted.
+   *
+   * @return The amount of values.
+   */
+  std::uint64_t count() const;
+
+  /**
+   * @brief The amount of values counted that are bigger than a value (as far
+   * as the buckets can tell).
+   *
+   * @param Value The value.
+   * @return The amount of values above it.
+   */
+  std::uint64_t count_above(std::uint64_t Value) const;
+
+  /**
+   * @brief Writes the histogram as a JSON object with `count`, `mean`, `p50`,
+   * `p90`, `p99`, `p999` and `max`.
+   *
+   * @param out Where to write.
+   */
+  void write(std::ostream& out) const;
+
+private:
+
+  //! Bits of precision kept for every power of two
+  static const unsigned SUB_BITS = 7;
+
+  /**
+   * @brief The bucket of a value.
+   *
+   * @param Value The value.
+   * @return The index of the bucket.
+   */
+  static std::size_t get_bucket(std::uint64_t Value);
+
+  /**
+   * @brief The highest value of a bucket.
+   *
+   * @param Bucket The index of the bucket.
+   * @return The value.
+   */
+  static std::uint64_t get_value(std::size_t Bucket);
+
+  /**
+   * @brief The count of every bucket.
+   */
+  std::vector<std::uint64_t> counts;
+
+  /**
+   * @brief The amount of values counted.
+   */
+  std::uint64_t total;
+
+  /**
+   * @brief The biggest value counted.
+   */
+  std::uint64_t largest;
+
+  /**
+   * @brief The sum of the values counted, for the mean.
+   */
+  double sum;
+};
+
+/**
+ * @brief The memory the process has resident right now.
+ *
+ * @return The size in bytes (0 if it can't be read).
+ */
+std::size_t GetResidentBytes();
+
+/**
+ * @brief Picks a percentile out of some samples. Reorders the samples.
+ *
+ * @param samples The samples.
+ * @param Percentile The percentile, between 0 and 100.
+ * @return The sample at the percentile (0 if there are none).
+ */
+unsigned GetPercentile(std::vector<unsigned>& samples, double Percentile);
+
+/**
+ * @brief Writes a result as a JSON object with `ops`, `ns_per_op`,
+ * `ops_per_sec` and `probes_per_op` (null if unknown), plus `cycles_per_op`
+ * and the other counters that were read.
+ *
+ * @param out Where to write.
+ * @param Result The result.
+ */
+void WriteBenchResult(std::ostream& out, const BenchResult& Result);
+
+/**
+ * @brief Writes a string as a JSON string.
+ *
+ * @param out Where to write.
+ * @param Text The string.
+ */
+void WriteJsonString(std::ostream& out, const char* Text);
+
+#endif
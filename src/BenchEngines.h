@@ -0,0 +1,290 @@
+/**
+ * @file BenchEngines.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Every table the benchmarks can drive, behind the same interface.
+ * Like OAHashTable.h, this may only be included by one file per program.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "OAHashTable.h"
+#include "OALockFreeHashTable.h"
+#include "OAReplicatedHashTable.h"
+#include "OASeqlockHashTable.h"
+#include "OASnapshotHashTable.h"
+#include "ShardedOAHashTable.h"
+#include "Support.h"
+
+#ifndef BENCHENGINESH
+#define BENCHENGINESH
+//---------------------------------------------------------------------------
+
+//! The data stored with every key
+typedef int BenchValue;
+
+//! The configuration every engine is built from
+typedef OAHashTable<BenchValue>::OAHTConfig EngineConfig;
+
+/*
+ * Every engine has a constructor taking an EngineConfig and insert, remove,
+ * find, clear and GetStats with the same behavior (and exceptions) as
+ * OAHashTable.
+ */
+
+/**
+ * @brief OAHashTable with a given instrumentation and slot placement.
+ */
+template<typename Instrumentation, OAHTNumaPolicy Numa = NUMA_DEFAULT>
+class OAEngine {
+public:
+
+  //! The table
+  typedef OAHashTable<BenchValue, Instrumentation> Table;
+
+  explicit OAEngine(const EngineConfig& Config):
+      table(typename Table::OAHTConfig(
+        Config.InitialTableSize_,
+        Config.PrimaryHashFunc_,
+        Config.SecondaryHashFunc_,
+        Config.MaxLoadFactor_,
+        Config.GrowthFactor_,
+        Config.DeletionPolicy_,
+        0,
+        0,
+        0,
+        false,
+        Numa
+      )) {}
+
+  void insert(const char* Key, BenchValue Data) { table.insert(Key, Data); }
+  void remove(const char* Key) { table.remove(Key); }
+  BenchValue find(const char* Key) const { return table.find(Key); }
+  void clear() { table.clear(); }
+  OAHTStats GetStats() const { return table.GetStats(); }
+
+private:
+
+  Table table; //!< The engine
+};
+
+//! OAHashTable with its slots spread over every NUMA node
+typedef OAEngine<OANoInstrumentation, NUMA_INTERLEAVE> InterleavedEngine;
+
+/**
+ * @brief std::unordered_map with std::string keys. The config is ignored.
+ */
+class UnorderedMapEngine {
+public:
+
+  explicit UnorderedMapEngine(const EngineConfig&): table() {}
+
+  void insert(const char* Key, BenchValue Data) {
+    if (!table.emplace(Key, Data).second) {
+      throw OAHashTableException(
+        OAHashTableException::E_DUPLICATE,
+        "There is a duplicate item in the list."
+      );
+    }
+  }
+
+  void remove(const char* Key) {
+    if (table.erase(Key) == 0) {
+      throw OAHashTableException(
+        OAHashTableException::E_ITEM_NOT_FOUND,
+        "Key not in table."
+      );
+    }
+  }
+
+  BenchValue find(const char* Key) const {
+    auto found = table.find(Key);
+
+    if (found == table.end()) {
+      throw OAHashTableException(
+        OAHashTableException::E_ITEM_NOT_FOUND,
+        "Item not found in table."
+      );
+    }
+
+    return found->second;
+  }
+
+  void clear() { table.clear(); }
+
+  OAHTStats GetStats() const {
+    OAHTStats stats;
+    stats.Count_ = table.size();
+    stats.TableSize_ = table.bucket_count();
+    return stats;
+  }
+
+private:
+
+  std::unordered_map<std::string, BenchValue> table; //!< The engine
+};
+
+/**
+ * @brief ShardedOAHashTable with the default amount of shards.
+ */
+class ShardedEngine {
+public:
+
+  //! The table
+  typedef ShardedOAHashTable<BenchValue> Table;
+
+  explicit ShardedEngine(const EngineConfig& Config): table(Config) {}
+
+  void insert(const char* Key, BenchValue Data) { table.insert(Key, Data); }
+  void remove(const char* Key) { table.remove(Key); }
+  BenchValue find(const char* Key) const { return table.find(Key); }
+  void clear() { table.clear(); }
+  OAHTStats GetStats() const { return table.GetStats(); }
+
+private:
+
+  Table table; //!< The engine
+};
+
+/**
+ * @brief OAReplicatedHashTable with a replica on every NUMA node.
+ */
+class ReplicatedEngine {
+public:
+
+  //! The table
+  typedef OAReplicatedHashTable<BenchValue> Table;
+
+  explicit ReplicatedEngine(const EngineConfig& Config): table(Config) {}
+
+  void insert(const char* Key, BenchValue Data) { table.insert(Key, Data); }
+  void remove(const char* Key) { table.remove(Key); }
+  BenchValue find(const char* Key) const { return table.find(Key); }
+  void clear() { table.clear(); }
+  OAHTStats GetStats() const { return table.GetStats(); }
+
+private:
+
+  Table table; //!< The engine
+};
+
+/**
+ * @brief OASeqlockHashTable, used from the writer thread only.
+ */
+class SeqlockEngine {
+public:
+
+  //! The table
+  typedef OASeqlockHashTable<BenchValue> Table;
+
+  explicit SeqlockEngine(const EngineConfig& Config): table(Config) {}
+
+  void insert(const char* Key, BenchValue Data) { table.insert(Key, Data); }
+  void remove(const char* Key) { table.remove(Key); }
+  BenchValue find(const char* Key) const { return table.find(Key); }
+  void clear() { table.clear(); }
+  OAHTStats GetStats() const { return table.GetStats(); }
+
+private:
+
+  Table table; //!< The engine
+};
+
+/**
+ * @brief OASnapshotHashTable, with a snapshot taken every SNAPSHOT_WRITES
+ * writes and kept until the next one, like a reader that gets a copy now and
+ * then. Every write after a snapshot pays for copying what it touches.
+ */
+class SnapshotEngine {
+public:
+
+  //! The table
+  typedef OASnapshotHashTable<BenchValue> Table;
+
+  //! Writes between two snapshots
+  static const unsigned SNAPSHOT_WRITES = 1024;
+
+  explicit SnapshotEngine(const EngineConfig& Config):
+      table(Config), snapshot(table), writes(0) {}
+
+  void insert(const char* Key, BenchValue Data) {
+    table.insert(Key, Data);
+    wrote();
+  }
+
+  void remove(const char* Key) {
+    table.remove(Key);
+    wrote();
+  }
+
+  BenchValue find(const char* Key) const { return table.find(Key); }
+  void clear() { table.clear(); }
+  OAHTStats GetStats() const { return table.GetStats(); }
+
+private:
+
+  /**
+   * @brief Counts a write, taking a snapshot every SNAPSHOT_WRITES.
+   */
+  void wrote() {
+    if (++writes % SNAPSHOT_WRITES == 0) {
+      snapshot = table;
+    }
+  }
+
+  Table table;     //!< The engine
+  Table snapshot;  //!< The latest snapshot
+  unsigned writes; //!< Writes so far
+};
+
+/**
+ * @brief OALockFreeHashTable. It only takes integer keys, so the keys are
+ * turned into one with GetFullHash (without the values it reserves). The hash
+ * functions and the deletion policy of the config are ignored.
+ */
+class LockFreeEngine {
+public:
+
+  //! The table
+  typedef OALockFreeHashTable<BenchValue> Table;
+
+  explicit LockFreeEngine(const EngineConfig& Config):
+      config(
+        Config.InitialTableSize_,
+        Config.MaxLoadFactor_,
+        Config.GrowthFactor_,
+        Config.SecondaryHashFunc_ != nullptr
+      ),
+      table(new Table(config)) {}
+
+  void insert(const char* Key, BenchValue Data) {
+    table->insert(key(Key), Data);
+  }
+
+  void remove(const char* Key) { table->remove(key(Key)); }
+  BenchValue find(const char* Key) const { return table->find(key(Key)); }
+  void clear() { table.reset(new Table(config)); }
+  OAHTStats GetStats() const { return table->GetStats(); }
+
+private:
+
+  /**
+   * @brief The integer key for a string.
+   *
+   * @param Key The string.
+   * @return The integer, never 0 or ~0.
+   */
+  static Table::KEY key(const char* Key) { return GetFullHash(Key) >> 1 | 1; }
+
+  Table::OALFConfig config;     //!< To build a new table on a clear
+  std::unique_ptr<Table> table; //!< The engine
+};
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ * @file HashFuncs.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief The string hash functions shared by the drivers and the tools.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#ifndef HASHFUNCSH
+#define HASHFUNCSH
+//---------------------------------------------------------------------------
+
+//! Same as the one in OAHashTable.h
+typedef unsigned (*HASHFUNC)(const char*, unsigned);
+
+unsigned ConstantHash(const char*, unsigned);
+unsigned ReflexiveHash(const char* Key, unsigned TableSize);
+unsigned PJWHash(const char* Key, unsigned TableSize);
+unsigned SimpleHash(const char* Key, unsigned TableSize);
+unsigned RSHash(const char* Key, unsigned TableSize);
+unsigned UHash(const char* Key, unsigned TableSize);
+
+struct HashData {
+  HASHFUNC Fn;
+  const char* Name;
+};
+
+enum HASHFUNCS {
+  NONE,
+  CONSTANT,
+  REFLEXIVE,
+  SIMPLE,
+  RS,
+  UNIVERSAL,
+  PJW
+};
+
+//! Every hash function, indexed by HASHFUNCS
+extern HashData HashingFuncs[PJW + 1];
+
+//! The name of every HASHFUNCS value, as used on the tools' command lines
+extern const char* const HashingFuncLabels[PJW + 1];
+
+/**
+ * @brief Finds a hash function by the name of its HASHFUNCS value.
+ *
+ * @param Label The name, like "PJW".
+ * @return The HASHFUNCS value, or -1 if there is none with that name.
+ */
+int FindHashingFunc(const char* Label);
+
+#endif
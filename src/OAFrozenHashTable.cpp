@@ -0,0 +1,255 @@
+/**
+ * @file OAFrozenHashTable.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Implementation of the read-only minimal perfect hash table
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "Support.h"
+
+#define OAFROZENHASHTABLE_CPP
+
+#ifndef OAFROZENHASHTABLEH
+  #include "OAFrozenHashTable.h"
+#endif
+
+template<typename T>
+template<typename Instrumentation>
+OAFrozenHashTable<T>::OAFrozenHashTable(
+  const OAHashTable<T, Instrumentation>& Table
+):
+    slots(), pilots(), seed(0), stats() {
+  std::vector<FrozenEntry> entries;
+  entries.reserve(Table.GetStats().Count_);
+
+  // for_each leaves out the expired elements.
+  Table.for_each([&entries](const char* Key, const T& Data) {
+    entries.push_back(FrozenEntry{GetFullHash(Key), Key, &Data});
+  });
+
+  // No pilot can send two keys with the same hash to different slots, every
+  // seed would fail.
+  std::vector<std::uint64_t> hashes(entries.size());
+
+  for (std::size_t i = 0; i < entries.size(); i++) {
+    hashes[i] = entries[i].hash;
+  }
+
+  std::sort(hashes.begin(), hashes.end());
+
+  if (std::adjacent_find(hashes.begin(), hashes.end()) != hashes.end()) {
+    throw OAHashTableException(
+      OAHashTableException::E_DUPLICATE,
+      "Two keys have the same full width hash, they can't be told apart."
+    );
+  }
+
+  slots.resize(entries.size() + entries.size() / KEYS_PER_SPARE);
+  std::vector<std::size_t> positions;
+
+  for (unsigned attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+    seed = mix(attempt + 1);
+
+    if (!build(entries, positions)) {
+      continue;
+    }
+
+    std::vector<char> used(slots.size(), 0);
+
+    for (std::size_t i = 0; i < entries.size(); i++) {
+      OAFHTSlot& slot = slots[positions[i]];
+      strcpy(slot.Key, entries[i].key);
+      slot.Data = *entries[i].data;
+      used[positions[i]] = 1;
+    }
+
+    // An empty key would match the spare slots if they were left empty.
+    for (std::size_t i = 0; i < slots.size(); i++) {
+      if (used[i] == 0) {
+        slots[i] = slots[positions[0]];
+      }
+    }
+
+    stats.Count_ = entries.size();
+    stats.TableSize_ = slots.size();
+    return;
+  }
+
+  throw OAHashTableException(
+    OAHashTableException::E_NO_MEMORY,
+    "Couldn't find a perfect hash for the keys."
+  );
+}
+
+template<typename T>
+auto OAFrozenHashTable<T>::find(const char* Key) const -> const T& {
+  const std::uint64_t hash = get_hash(GetFullHash(Key));
+
+  if (!slots.empty()) {
+    const OAFHTSlot& slot =
+      slots[get_position(hash, pilots[get_bucket(hash)])];
+
+    if (std::strcmp(slot.Key, Key) == 0) {
+      return slot.Data;
+    }
+  }
+
+  throw OAHashTableException(
+    OAHashTableException::E_ITEM_NOT_FOUND,
+    "Item not found in table."
+  );
+}
+
+template<typename T>
+auto OAFrozenHashTable<T>::GetStats() const -> OAHTStats {
+  OAHTStats result = stats;
+  result.Memory_ = memory_usage();
+
+  return result;
+}
+
+template<typename T>
+auto OAFrozenHashTable<T>::memory_usage() const -> OAHTMemory {
+  OAHTMemory memory;
+  const std::size_t slot = sizeof(OAFHTSlot);
+
+  memory.SlotBytes_ = slot;
+  memory.TableBytes_ = slots.size() * slot;
+  memory.PayloadBytes_ = stats.Count_ * (sizeof(OAFHTSlot::Key) + sizeof(T));
+  memory.OverheadBytes_ = stats.Count_ * slot - memory.PayloadBytes_;
+  memory.UnusedBytes_ = (stats.TableSize_ - stats.Count_) * slot;
+  memory.ExtraBytes_ = pilots.capacity() * sizeof(std::uint32_t);
+  memory.TotalBytes_ = memory.TableBytes_ + memory.ExtraBytes_ + sizeof(*this);
+
+  if (stats.Count_ != 0) {
+    memory.BytesPerEntry_ =
+      static_cast<double>(memory.TotalBytes_) / stats.Count_;
+  }
+
+  return memory;
+}
+
+template<typename T>
+auto OAFrozenHashTable<T>::build(
+  const std::vector<FrozenEntry>& entries,
+  std::vector<std::size_t>& positions
+) -> bool {
+  const std::size_t size = entries.size();
+  const std::size_t buckets = size / KEYS_PER_BUCKET + 1;
+  pilots.assign(buckets, 0);
+
+  std::vector<std::uint64_t> hashes(size);
+  std::vector<std::size_t> starts(buckets + 1, 0);
+
+  for (std::size_t i = 0; i < size; i++) {
+    hashes[i] = get_hash(entries[i].hash);
+    starts[get_bucket(hashes[i]) + 1]++;
+  }
+
+  std::partial_sum(starts.begin(), starts.end(), starts.begin());
+
+  // The elements grouped by bucket
+  std::vector<std::size_t> members(size);
+  std::vector<std::size_t> filled(starts.begin(), starts.end() - 1);
+
+  for (std::size_t i = 0; i < size; i++) {
+    members[filled[get_bucket(hashes[i])]++] = i;
+  }
+
+  // The biggest buckets are the hardest to place, they go while it's empty.
+  std::vector<std::size_t> order(buckets);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(
+    order.begin(),
+    order.end(),
+    [&starts](std::size_t left, std::size_t right) {
+      return starts[left + 1] - starts[left]
+        > starts[right + 1] - starts[right];
+    }
+  );
+
+  // Keys with the same seeded hash never split, give up on the seed instead.
+  const std::uint64_t max_pilot = std::min<std::uint64_t>(
+    std::numeric_limits<std::uint32_t>::max(),
+    64 * static_cast<std::uint64_t>(size) + 1024
+  );
+
+  std::vector<char> taken(slots.size(), 0);
+  std::vector<std::size_t> placed;
+  positions.assign(size, 0);
+
+  for (std::size_t bucket : order) {
+    const std::size_t begin = starts[bucket];
+    const std::size_t end = starts[bucket + 1];
+    bool found = false;
+
+    for (std::uint64_t pilot = 0; pilot < max_pilot && !found; pilot++) {
+      placed.clear();
+      found = true;
+
+      for (std::size_t i = begin; i < end && found; i++) {
+        const std::size_t position =
+          get_position(hashes[members[i]], static_cast<std::uint32_t>(pilot));
+
+        found = taken[position] == 0
+          && std::find(placed.begin(), placed.end(), position) == placed.end();
+        placed.push_back(position);
+      }
+
+      if (found) {
+        pilots[bucket] = static_cast<std::uint32_t>(pilot);
+      }
+    }
+
+    if (!found) {
+      return false;
+    }
+
+    for (std::size_t i = begin; i < end; i++) {
+      taken[placed[i - begin]] = 1;
+      positions[members[i]] = placed[i - begin];
+    }
+  }
+
+  return true;
+}
+
+template<typename T>
+auto OAFrozenHashTable<T>::get_hash(std::uint64_t FullHash) const
+  -> std::uint64_t {
+  return mix(FullHash ^ seed);
+}
+
+template<typename T>
+auto OAFrozenHashTable<T>::get_bucket(std::uint64_t hash) const
+  -> std::size_t {
+  return static_cast<std::size_t>((hash >> 32) % pilots.size());
+}
+
+template<typename T>
+auto OAFrozenHashTable<T>::get_position(
+  std::uint64_t hash,
+  std::uint32_t pilot
+) const -> std::size_t {
+  return static_cast<std::size_t>((hash ^ mix(pilot)) % slots.size());
+}
+
+template<typename T>
+auto OAFrozenHashTable<T>::mix(std::uint64_t value) -> std::uint64_t {
+  // splitmix64 finalizer
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31;
+  return value;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file OAFrozenHashTable.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Read-only table built from an OAHashTable with a minimal perfect
+ * hash.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "OAHashTable.h"
+
+#ifndef OAFROZENHASHTABLEH
+  #define OAFROZENHASHTABLEH
+//---------------------------------------------------------------------------
+
+/**
+ * @brief An immutable copy of an OAHashTable for tables that are built once
+ * and then only read. The keys are laid out with a minimal perfect hash
+ * (PTHash style: the keys are split into small buckets and every bucket gets a
+ * pilot that sends all of its keys to free slots), so there are about 1% more
+ * slots than keys. A lookup reads the pilot of its bucket, one slot and
+ * compares one key, there are no probe chains.
+ *
+ * The data is copied, the table never calls the FreeProc_ of the original.
+ */
+template<typename T>
+class OAFrozenHashTable {
+public:
+
+  //! The average amount of keys per bucket, more is smaller but slower to build
+  static const std::size_t KEYS_PER_BUCKET = 3;
+
+  /**
+   * @brief Keys for every spare slot. Without any, the last keys placed have
+   * to try about as many pilots as there are keys to find the free slots.
+   */
+  static const std::size_t KEYS_PER_SPARE = 100;
+
+  //! The seeds tried before giving up on building the table
+  static const unsigned MAX_ATTEMPTS = 16;
+
+  /**
+   * @brief Builds the table from every element of another one, except the
+   * ones that expired already (they would never expire here). Throws
+   * E_DUPLICATE if two keys have the same full width hash (GetFullHash), no
+   * perfect hash can separate them.
+   *
+   * @param Table The table to freeze, it isn't changed.
+   */
+  template<typename Instrumentation>
+  explicit OAFrozenHashTable(const OAHashTable<T, Instrumentation>& Table);
+
+  /**
+   * @brief Find and return data by key. Throws an exception (E_ITEM_NOT_FOUND)
+   * if not found.
+   *
+   * @param Key The key to find if it's present.
+   * @return The Data at Key
+   */
+  const T& find(const char* Key) const;
+
+  /**
+   * @brief Returns the table's statistics. Lookups aren't counted in
+   * `Probes_` (find writes nothing), every one of them is a single probe.
+   *
+   * @return The table's stats.
+   */
+  OAHTStats GetStats() const;
+
+  /**
+   * @brief What the table costs. The pilots are the extra bytes.
+   *
+   * @return The breakdown.
+   */
+  OAHTMemory memory_usage() const;
+
+private:
+
+  /**
+   * @brief A key/data pair. The spare slots hold a copy of some element, no
+   * other key can match it and that element's lookups never land there.
+   */
+  struct OAFHTSlot {
+    char Key[MAX_KEYLEN]{'\0'}; //!< Key is a string
+    T Data{};                   //!< Client data
+  };
+
+  /**
+   * @brief An element of the original table while the layout is searched.
+   */
+  struct FrozenEntry {
+    std::uint64_t hash{0};     //!< Full width hash of the key
+    const char* key{nullptr};  //!< The key in the original table
+    const T* data{nullptr};    //!< The data in the original table
+  };
+
+  /**
+   * @brief Tries to find a pilot for every bucket with the current seed.
+   *
+   * @param entries The elements.
+   * @param positions Set to the slot of every element.
+   * @return Whether every bucket got a pilot.
+   */
+  bool build(
+    const std::vector<FrozenEntry>& entries,
+    std::vector<std::size_t>& positions
+  );
+
+  /**
+   * @brief The hash of a key under the current seed.
+   *
+   * @param FullHash The full width hash of the key (GetFullHash).
+   * @return The seeded hash.
+   */
+  std::uint64_t get_hash(std::uint64_t FullHash) const;
+
+  /**
+   * @brief The bucket of a seeded hash.
+   *
+   * @param hash The seeded hash.
+   * @return The index of the bucket.
+   */
+  std::size_t get_bucket(std::uint64_t hash) const;
+
+  /**
+   * @brief The slot of a seeded hash given the pilot of its bucket.
+   *
+   * @param hash The seeded hash.
+   * @param pilot The pilot of its bucket.
+   * @return The index of the slot.
+   */
+  std::size_t get_position(std::uint64_t hash, std::uint32_t pilot) const;
+
+  /**
+   * @brief splitmix64 finalizer.
+   *
+   * @param value The value to mix.
+   * @return The mixed value.
+   */
+  static std::uint64_t mix(std::uint64_t value);
+
+  /**
+   * @brief The slots, one per element plus the spares.
+   */
+  std::vector<OAFHTSlot> slots{};
+
+  /**
+   * @brief The pilot of every bucket.
+   */
+  std::vector<std::uint32_t> pilots{};
+
+  /**
+   * @brief The seed the pilots were found with.
+   */
+  std::uint64_t seed{0};
+
+  /**
+   * @brief The table's stats.
+   */
+  OAHTStats stats{};
+};
+
+  #ifndef OAFROZENHASHTABLE_CPP
+    #include "OAFrozenHashTable.cpp"
+  #endif
+
+#endif
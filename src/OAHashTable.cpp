@@ -10,10 +10,15 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <csignal>
 #include <cstddef>
 #include <cstring>
+#include <exception>
+#include <limits>
+#include <new>
+#include <thread>
 #include <utility>
 
 #include "Support.h"
@@ -24,30 +29,44 @@
   #include "OAHashTable.h"
 #endif
 
-template<typename T>
-OAHashTable<T>::OAHashTable(const OAHTConfig& Config):
+template<typename T, typename I>
+OAHashTable<T, I>::OAHashTable(const OAHTConfig& Config):
     config(Config),
-    slots(new OAHTSlot[Config.InitialTableSize_]),
+    slots(allocate_slots(get_initial_size(Config))),
+    bloom(Config.BloomBitsPerKey_),
+    occupancy(),
+    referenced(),
+    clock_hand(0),
     first_hash_function(config.PrimaryHashFunc_),
     second_hash_function(config.SecondaryHashFunc_),
     delete_function(config.FreeProc_),
+    expiries(),
+    wheel(),
+    wheel_tick(0),
     stats() {
-  stats.TableSize_ = config.InitialTableSize_;
+  stats.TableSize_ = get_initial_size(config);
   stats.PrimaryHashFunc_ = first_hash_function;
   stats.SecondaryHashFunc_ = second_hash_function;
 
   init_table();
 }
 
-template<typename T>
-OAHashTable<T>::OAHashTable(const OAHashTable& rhs):
+template<typename T, typename I>
+OAHashTable<T, I>::OAHashTable(const OAHashTable& rhs):
     config(rhs.config),
     slots(nullptr),
+    bloom(rhs.bloom),
+    occupancy(rhs.occupancy),
+    referenced(rhs.referenced),
+    clock_hand(rhs.clock_hand),
     first_hash_function(rhs.first_hash_function),
     second_hash_function(rhs.second_hash_function),
     delete_function(rhs.delete_function),
+    expiries(rhs.expiries),
+    wheel(rhs.wheel),
+    wheel_tick(rhs.wheel_tick),
     stats(rhs.stats) {
-  slots = new OAHTSlot[rhs.stats.TableSize_];
+  slots = allocate_slots(rhs.stats.TableSize_);
 
   for (std::size_t i = 0; i < stats.TableSize_; i++) {
     OAHTSlot& self = slots[i];
@@ -59,33 +78,47 @@ OAHashTable<T>::OAHashTable(const OAHashTable& rhs):
   }
 }
 
-template<typename T>
-OAHashTable<T>::OAHashTable(OAHashTable&& rhs):
+template<typename T, typename I>
+OAHashTable<T, I>::OAHashTable(OAHashTable&& rhs):
     config(rhs.config),
     slots(std::exchange(rhs.slots, nullptr)),
+    bloom(std::move(rhs.bloom)),
+    occupancy(std::move(rhs.occupancy)),
+    referenced(std::move(rhs.referenced)),
+    clock_hand(rhs.clock_hand),
     first_hash_function(std::exchange(rhs.first_hash_function, nullptr)),
     second_hash_function(std::exchange(rhs.second_hash_function, nullptr)),
     delete_function(std::exchange(rhs.delete_function, nullptr)),
+    expiries(std::move(rhs.expiries)),
+    wheel(std::move(rhs.wheel)),
+    wheel_tick(rhs.wheel_tick),
     stats(std::exchange(rhs.stats, OAHTStats())) {}
 
-template<typename T>
-auto OAHashTable<T>::operator=(const OAHashTable& rhs) -> OAHashTable& {
+template<typename T, typename I>
+auto OAHashTable<T, I>::operator=(const OAHashTable& rhs) -> OAHashTable& {
   if (this == &rhs) {
     return &this;
   }
 
   // Clearing old contents.
   clear();
-  delete[] slots;
+  free_slots(slots, stats.TableSize_);
 
   // Filling with new contents
   config = rhs.config;
+  bloom = rhs.bloom;
+  occupancy = rhs.occupancy;
+  referenced = rhs.referenced;
+  clock_hand = rhs.clock_hand;
   first_hash_function = rhs.first_hash_function;
   second_hash_function = rhs.second_hash_function;
   delete_function = rhs.delete_function;
+  expiries = rhs.expiries;
+  wheel = rhs.wheel;
+  wheel_tick = rhs.wheel_tick;
   stats = rhs.stats;
 
-  slots = new OAHTSlot[stats.TableSize_];
+  slots = allocate_slots(stats.TableSize_);
 
   for (std::size_t i = 0; i < stats.TableSize_; i++) {
     OAHTSlot& self = slots[i];
@@ -99,40 +132,153 @@ auto OAHashTable<T>::operator=(const OAHashTable& rhs) -> OAHashTable& {
   return *this;
 }
 
-template<typename T>
-auto OAHashTable<T>::operator=(OAHashTable&& rhs) -> OAHashTable& {
+template<typename T, typename I>
+auto OAHashTable<T, I>::operator=(OAHashTable&& rhs) -> OAHashTable& {
   if (this == &rhs) {
     return &this;
   }
 
   // Clearing old contents.
   clear();
-  delete[] slots;
+  free_slots(slots, stats.TableSize_);
 
   // Filling with new contents
   config = rhs.config;
   slots = std::exchange(rhs.slots, nullptr);
+  bloom = std::move(rhs.bloom);
+  occupancy = std::move(rhs.occupancy);
+  referenced = std::move(rhs.referenced);
+  clock_hand = rhs.clock_hand;
   first_hash_function = std::exchange(rhs.first_hash_function, nullptr);
   second_hash_function = std::exchange(rhs.second_hash_function, nullptr);
   delete_function = std::exchange(rhs.delete_function, nullptr);
+  expiries = std::move(rhs.expiries);
+  wheel = std::move(rhs.wheel);
+  wheel_tick = rhs.wheel_tick;
   stats = std::exchange(rhs.stats, OAHTStats());
 
   return *this;
 }
 
-template<typename T>
-OAHashTable<T>::~OAHashTable() {
+template<typename T, typename I>
+OAHashTable<T, I>::~OAHashTable() {
   clear();
-  delete[] slots;
+  free_slots(slots, stats.TableSize_);
 }
 
-template<typename T>
-auto OAHashTable<T>::insert(const char* Key, const T& Data) -> void {
-  insert_inner(Key, Data);
+template<typename T, typename I>
+auto OAHashTable<T, I>::insert(const char* Key, const T& Data) -> void {
+  insert_expiring(get_slot_key(Key), Data, 0);
 }
 
-template<typename T>
-auto OAHashTable<T>::remove(const char* Key) -> void {
+template<typename T, typename I>
+auto OAHashTable<T, I>::insert(
+  const char* Key,
+  const T& Data,
+  std::chrono::nanoseconds Ttl
+) -> void {
+  insert_expiring(get_slot_key(Key), Data, get_expiry(Ttl));
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::insert(const OAHashedKey& Key, const T& Data)
+  -> void {
+  insert_expiring(get_slot_key(Key), Data, 0);
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::insert(
+  const OAHashedKey& Key,
+  const T& Data,
+  std::chrono::nanoseconds Ttl
+) -> void {
+  insert_expiring(get_slot_key(Key), Data, get_expiry(Ttl));
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::expire() -> std::size_t {
+  if (expiries.empty()) {
+    return 0;
+  }
+
+  const std::uint64_t now = get_time();
+  const std::uint64_t now_tick = now / WHEEL_TICK;
+  std::size_t expired = 0;
+  std::vector<WheelTimer> timers;
+
+  // The current tick is swept again next time, it may still get timers. If
+  // more than a turn went by every bucket is swept once.
+  const std::uint64_t last =
+    std::min<std::uint64_t>(now_tick, wheel_tick + WHEEL_BUCKETS - 1);
+
+  for (std::uint64_t tick = wheel_tick; tick <= last; tick++) {
+    std::vector<WheelTimer>& bucket = wheel[tick % WHEEL_BUCKETS];
+    timers.insert(timers.end(), bucket.begin(), bucket.end());
+    bucket.clear();
+  }
+
+  wheel_tick = now_tick;
+
+  while (!timers.empty()) {
+    std::size_t erased = 0;
+
+    for (const WheelTimer& timer : timers) {
+      const std::uint64_t expiry = expiries[timer.index];
+
+      // A stale timer, the element is gone, moved or has a new expiry.
+      if (expiry != timer.expiry) {
+        continue;
+      }
+
+      if (expiry > now) {
+        wheel[expiry / WHEEL_TICK % WHEEL_BUCKETS].push_back(timer);
+        continue;
+      }
+
+      const SlotKey key = get_slot_key(slots[timer.index].Key);
+      erase(timer.index, get_displacement(key, timer.index));
+      erased++;
+    }
+
+    timers.clear();
+
+    // PACK moves due elements onto the current tick, they go in another round.
+    if (erased != 0) {
+      timers.swap(wheel[now_tick % WHEEL_BUCKETS]);
+    }
+
+    expired += erased;
+  }
+
+  stats.Expirations_ += expired;
+
+  return expired;
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::remove(const char* Key) -> void {
+  remove_inner(get_slot_key(Key));
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::remove(const OAHashedKey& Key) -> void {
+  remove_inner(get_slot_key(Key));
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::find(const char* Key) const -> const T& {
+  return find_inner(get_slot_key(Key));
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::find(const OAHashedKey& Key) const -> const T& {
+  return find_inner(get_slot_key(Key));
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::remove_inner(const SlotKey& Key) -> void {
+  expire();
+
   SlotSearch<OAHTSlot> search = find_slot_mut(Key);
 
   if (search.slot == nullptr) {
@@ -142,30 +288,27 @@ auto OAHashTable<T>::remove(const char* Key) -> void {
     );
   }
 
-  delete_slot(*search.slot);
-
-  switch (config.DeletionPolicy_) {
-    case OAHTDeletionPolicy::MARK: adjust_mark(search.index); break;
-    case OAHTDeletionPolicy::PACK: adjust_pack(search.index); break;
-  }
+  erase(search.index, search.probe);
 }
 
-template<typename T>
-auto OAHashTable<T>::find(const char* Key) const -> const T& {
+template<typename T, typename I>
+auto OAHashTable<T, I>::find_inner(const SlotKey& Key) const -> const T& {
   SlotSearch<const OAHTSlot> search{find_slot(Key)};
 
-  if (search.slot == nullptr) {
+  if (search.slot == nullptr || is_expired(search.index)) {
     throw OAHashTableException(
       OAHashTableException::E_ITEM_NOT_FOUND,
       "Item not found in table."
     );
   }
 
+  touch(search.index);
+
   return search.slot->Data;
 }
 
-template<typename T>
-auto OAHashTable<T>::clear() -> void {
+template<typename T, typename I>
+auto OAHashTable<T, I>::clear() -> void {
   for (std::size_t i = 0; i < stats.TableSize_; i++) {
     OAHTSlot& slot = get_slot_mut(i, false).slot;
 
@@ -177,75 +320,593 @@ auto OAHashTable<T>::clear() -> void {
         break;
     }
   }
+
+  stats.Tombstones_ = 0;
+  stats.MaxProbeLength_ = 0;
+  stats.Displacement_ = 0;
+
+  for (std::vector<WheelTimer>& bucket : wheel) {
+    bucket.clear();
+  }
+
+  rebuild_bloom();
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::GetStats() const -> OAHTStats {
+  OAHTStats result = stats;
+  result.Memory_ = memory_usage();
+
+  return result;
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::memory_usage() const -> OAHTMemory {
+  OAHTMemory memory;
+  const std::size_t slot = sizeof(OAHTSlot);
+
+  memory.SlotBytes_ = slot;
+  memory.TableBytes_ = stats.TableSize_ * slot;
+  memory.PayloadBytes_ = stats.Count_ * (sizeof(OAHTSlot::Key) + sizeof(T));
+  memory.OverheadBytes_ = stats.Count_ * slot - memory.PayloadBytes_;
+  memory.UnusedBytes_ = (stats.TableSize_ - stats.Count_) * slot;
+  memory.ExtraBytes_ =
+    (occupancy.capacity() + referenced.capacity() + expiries.capacity())
+      * sizeof(std::uint64_t)
+    + wheel.capacity() * sizeof(std::vector<WheelTimer>)
+    + bloom.bytes();
+
+  for (const std::vector<WheelTimer>& bucket : wheel) {
+    memory.ExtraBytes_ += bucket.capacity() * sizeof(WheelTimer);
+  }
+
+  memory.TotalBytes_ = memory.TableBytes_ + memory.ExtraBytes_ + sizeof(*this);
+
+  if (stats.Count_ != 0) {
+    memory.BytesPerEntry_ =
+      static_cast<double>(memory.TotalBytes_) / stats.Count_;
+  }
+
+  return memory;
 }
 
-template<typename T>
-auto OAHashTable<T>::GetStats() const -> OAHTStats {
-  return stats;
+template<typename T, typename I>
+auto OAHashTable<T, I>::Analyze() const -> OAHTAnalysis {
+  OAHTAnalysis analysis;
+  const std::size_t size = stats.TableSize_;
+  std::size_t displacement = 0;
+  std::size_t empty_slot = size;
+
+  for (std::size_t i = 0; i < size; i++) {
+    const OAHTSlot& slot = slots[i];
+
+    switch (slot.State) {
+      case OAHashTable::OAHTSlot::UNOCCUPIED: empty_slot = i; break;
+      case OAHashTable::OAHTSlot::DELETED: analysis.Tombstones_++; break;
+      case OAHashTable::OAHTSlot::OCCUPIED: {
+        std::size_t steps = get_displacement(get_slot_key(slot.Key), i);
+        displacement += steps;
+        add_to_histogram(analysis.SuccessfulProbes_, steps + 1);
+        break;
+      }
+    }
+  }
+
+  // Walking backwards from an empty slot, every slot of a cluster is one more
+  // probe away from the empty slot that ends a linear miss.
+  if (empty_slot == size) {
+    add_to_histogram(analysis.ClusterLengths_, size);
+  } else {
+    std::size_t cluster = 0;
+
+    for (std::size_t i = 1; i <= size; i++) {
+      const OAHTSlot& slot = slots[(empty_slot + size - i) % size];
+
+      if (slot.State != OAHashTable::OAHTSlot::UNOCCUPIED) {
+        cluster++;
+        continue;
+      }
+
+      if (cluster != 0) {
+        add_to_histogram(analysis.ClusterLengths_, cluster);
+      }
+      cluster = 0;
+    }
+  }
+
+  // Linear misses can start on any slot, bucketized ones only on a bucket.
+  if (second_hash_function == nullptr && get_bucket_slots() == 1) {
+    std::size_t run = 0;
+
+    for (std::size_t i = 1; i <= size && empty_slot != size; i++) {
+      const OAHTSlot& slot = slots[(empty_slot + size - i) % size];
+      run = slot.State == OAHashTable::OAHTSlot::UNOCCUPIED ? 0 : run + 1;
+      add_to_histogram(analysis.UnsuccessfulProbes_, run + 1);
+    }
+
+    if (empty_slot == size) {
+      analysis.UnsuccessfulProbes_.resize(size + 1);
+      analysis.UnsuccessfulProbes_[size] = stats.TableSize_;
+    }
+  } else {
+    for (std::size_t i = 0; i < size; i++) {
+      if (slots[i].State != OAHashTable::OAHTSlot::OCCUPIED) {
+        continue;
+      }
+
+      const SlotKey key = get_slot_key(slots[i].Key);
+      const std::size_t home = get_home(key);
+      const std::size_t stride = get_stride(key);
+      std::size_t probes = 1;
+
+      while (probes < size
+             && slots[get_probe_index(home, stride, probes - 1) % size].State
+                  != OAHashTable::OAHTSlot::UNOCCUPIED) {
+        probes++;
+      }
+
+      add_to_histogram(analysis.UnsuccessfulProbes_, probes);
+    }
+  }
+
+  double successful = 0;
+  double unsuccessful = 0;
+  double misses = 0;
+
+  for (std::size_t i = 0; i < analysis.SuccessfulProbes_.size(); i++) {
+    successful += static_cast<double>(i * analysis.SuccessfulProbes_[i]);
+  }
+
+  for (std::size_t i = 0; i < analysis.UnsuccessfulProbes_.size(); i++) {
+    unsuccessful += static_cast<double>(i * analysis.UnsuccessfulProbes_[i]);
+    misses += analysis.UnsuccessfulProbes_[i];
+  }
+
+  if (!analysis.SuccessfulProbes_.empty()) {
+    analysis.MaxProbeLength_ =
+      static_cast<unsigned>(analysis.SuccessfulProbes_.size() - 1);
+  }
+
+  if (stats.Count_ != 0) {
+    analysis.AverageSuccessfulProbes_ = successful / stats.Count_;
+    analysis.AverageDisplacement_ =
+      static_cast<double>(displacement) / stats.Count_;
+  }
+
+  if (misses != 0) {
+    analysis.AverageUnsuccessfulProbes_ = unsuccessful / misses;
+  }
+
+  return analysis;
 }
 
-template<typename T>
-auto OAHashTable<T>::GetTable() const -> const OAHTSlot* {
+template<typename T, typename I>
+auto OAHashTable<T, I>::GetTable() const -> const OAHTSlot* {
   return slots;
 }
 
-template<typename T>
-auto OAHashTable<T>::init_table(bool reset_probes) -> void {
+template<typename T, typename I>
+auto OAHashTable<T, I>::begin() const -> OAHTIterator {
+  return OAHTIterator(this, find_occupied(0));
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::end() const -> OAHTIterator {
+  return OAHTIterator(this, stats.TableSize_);
+}
+
+template<typename T, typename I>
+template<typename F>
+auto OAHashTable<T, I>::for_each(F fn) const -> void {
+  for_each_in(0, occupancy.size(), fn);
+}
+
+template<typename T, typename I>
+template<typename F>
+auto OAHashTable<T, I>::parallel_for_each(F fn, std::size_t Threads) const
+  -> void {
+  fan_out([&](std::size_t, std::size_t first, std::size_t last) {
+    for_each_in(first, last, fn);
+  }, Threads);
+}
+
+template<typename T, typename I>
+template<typename R, typename M, typename C>
+auto OAHashTable<T, I>::parallel_reduce(
+  R Identity,
+  M Map,
+  C Combine,
+  std::size_t Threads
+) const -> R {
+  // Wrapped so a std::vector<bool> can't pack the results of two chunks.
+  struct Partial {
+    R value;
+  };
+
+  const std::size_t chunks =
+    (occupancy.size() + PARALLEL_CHUNK_WORDS - 1) / PARALLEL_CHUNK_WORDS;
+  std::vector<Partial> partials(chunks, Partial{Identity});
+
+  fan_out([&](std::size_t chunk, std::size_t first, std::size_t last) {
+    R& partial = partials[chunk].value;
+
+    auto fold = [&](const char* Key, const T& Data) {
+      partial = Combine(partial, Map(Key, Data));
+    };
+
+    for_each_in(first, last, fold);
+  }, Threads);
+
+  R result = Identity;
+
+  for (const Partial& partial : partials) {
+    result = Combine(result, partial.value);
+  }
+
+  return result;
+}
+
+template<typename T, typename I>
+template<typename I2, typename F>
+auto OAHashTable<T, I>::merge_from(
+  const OAHashTable<T, I2>& Other,
+  F Resolve,
+  std::size_t Threads
+) -> void {
+  expire();
+
+  const std::vector<SlotPair> pairs = pair_slots(Other, Threads);
+  std::vector<std::uint64_t> merged(Other.occupancy.size(), 0);
+
+  // Only the data changes here, the slots stay where they are.
+  for (const SlotPair& pair : pairs) {
+    resolve_slot(slots[pair.mine], Other.slots[pair.theirs].Data, Resolve);
+
+    merged[pair.theirs / OCCUPANCY_BITS] |=
+      std::uint64_t(1) << pair.theirs % OCCUPANCY_BITS;
+  }
+
+  // What's left of Other, without what expired. Nothing when merging with
+  // itself.
+  const std::uint64_t now = get_time();
+  std::vector<std::size_t> inserted;
+
+  for (std::size_t word = 0; word < Other.occupancy.size(); word++) {
+    std::uint64_t bits = Other.occupancy[word] & ~merged[word];
+
+    while (bits != 0) {
+      const std::size_t index = word * OCCUPANCY_BITS + get_lowest_bit(bits);
+      bits &= bits - 1;
+
+      if (!Other.is_expired(index, now)) {
+        inserted.push_back(index);
+      }
+    }
+  }
+
+  if (inserted.empty()) {
+    return;
+  }
+
+  reserve(stats.Count_ + inserted.size());
+
+  // The elements keep their TTL.
+  for (const std::size_t index : inserted) {
+    const auto& slot = Other.slots[index];
+    const std::uint64_t expiry =
+      Other.expiries.empty() ? 0 : Other.expiries[index];
+
+    insert_expiring(get_slot_key(slot.Key), slot.Data, expiry);
+  }
+}
+
+template<typename T, typename I>
+template<typename I2, typename F>
+auto OAHashTable<T, I>::intersect_with(
+  const OAHashTable<T, I2>& Other,
+  F Resolve,
+  std::size_t Threads
+) -> void {
+  expire();
+
+  const std::vector<SlotPair> pairs = pair_slots(Other, Threads);
+  std::vector<std::uint64_t> kept(occupancy.size(), 0);
+
+  for (const SlotPair& pair : pairs) {
+    resolve_slot(slots[pair.mine], Other.slots[pair.theirs].Data, Resolve);
+
+    kept[pair.mine / OCCUPANCY_BITS] |=
+      std::uint64_t(1) << pair.mine % OCCUPANCY_BITS;
+  }
+
+  remove_marked(kept, false);
+}
+
+template<typename T, typename I>
+template<typename I2>
+auto OAHashTable<T, I>::difference(
+  const OAHashTable<T, I2>& Other,
+  std::size_t Threads
+) -> void {
+  expire();
+
+  const std::vector<SlotPair> pairs = pair_slots(Other, Threads);
+  std::vector<std::uint64_t> removed(occupancy.size(), 0);
+
+  for (const SlotPair& pair : pairs) {
+    removed[pair.mine / OCCUPANCY_BITS] |=
+      std::uint64_t(1) << pair.mine % OCCUPANCY_BITS;
+  }
+
+  remove_marked(removed, true);
+}
+
+template<typename T, typename I>
+template<typename I2, typename F>
+auto OAHashTable<T, I>::union_into(
+  OAHashTable<T, I2>& Destination,
+  F Resolve,
+  std::size_t Threads
+) const -> void {
+  Destination.merge_from(*this, Resolve, Threads);
+}
+
+template<typename T, typename I>
+template<typename F>
+auto OAHashTable<T, I>::resolve_slot(
+  OAHTSlot& slot,
+  const T& Theirs,
+  F& Resolve
+) -> void {
+  T resolved = Resolve(
+    static_cast<const char*>(slot.Key),
+    static_cast<const T&>(slot.Data),
+    Theirs
+  );
+
+  // The data replaced is freed, unless Resolve kept it.
+  if (delete_function != nullptr && !(resolved == slot.Data)) {
+    delete_function(slot.Data);
+  }
+
+  slot.Data = std::move(resolved);
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_initial_size(const OAHTConfig& Config)
+  -> std::size_t {
+  if (Config.Capacity_ == 0) {
+    return get_bucketed_size(Config.InitialTableSize_, Config.BucketSlots_);
+  }
+
+  const double size =
+    std::ceil(Config.Capacity_ / std::min(Config.MaxLoadFactor_, 1.0));
+
+  return get_bucketed_size(
+    std::max(
+      Config.InitialTableSize_,
+      static_cast<std::size_t>(
+        GetClosestPrime64(static_cast<unsigned long long>(size))
+      )
+    ),
+    Config.BucketSlots_
+  );
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::allocate_slots(std::size_t size) const -> OAHTSlot* {
+  if (config.NumaPolicy_ == NUMA_DEFAULT) {
+    return new OAHTSlot[size];
+  }
+
+  OAHTSlot* memory = static_cast<OAHTSlot*>(AllocateNumaMemory(
+    size * sizeof(OAHTSlot),
+    config.NumaPolicy_ == NUMA_INTERLEAVE
+      ? -1
+      : static_cast<int>(config.NumaNode_)
+  ));
+
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  for (std::size_t i = 0; i < size; i++) {
+    new (memory + i) OAHTSlot();
+  }
+
+  return memory;
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::free_slots(OAHTSlot* memory, std::size_t size) const
+  -> void {
+  if (config.NumaPolicy_ == NUMA_DEFAULT) {
+    delete[] memory;
+    return;
+  }
+
+  if (memory == nullptr) {
+    return;
+  }
+
+  for (std::size_t i = 0; i < size; i++) {
+    memory[i].~OAHTSlot();
+  }
+
+  FreeNumaMemory(memory, size * sizeof(OAHTSlot));
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::init_table(bool reset_probes) -> void {
+  const std::size_t words =
+    (stats.TableSize_ + OCCUPANCY_BITS - 1) / OCCUPANCY_BITS;
+
+  occupancy.assign(words, 0);
+  referenced.assign(config.Capacity_ != 0 ? words : 0, 0);
+  clock_hand = 0;
+
+  if (!expiries.empty()) {
+    expiries.assign(stats.TableSize_, 0);
+
+    for (std::vector<WheelTimer>& bucket : wheel) {
+      bucket.clear();
+    }
+  }
+
   for (std::size_t i = 0; i < stats.TableSize_; i++) {
     slots[i].Key[0] = '\0';
     slots[i].Data = T();
     slots[i].State = OAHashTable::OAHTSlot::UNOCCUPIED;
 
     if (reset_probes) {
-      slots[i].probes = 0;
+      I::reset(slots[i]);
+    }
+  }
+
+  rebuild_bloom();
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::try_grow_table() -> void {
+  const double load_factor = static_cast<double>(stats.Count_ + 1)
+    / static_cast<double>(stats.TableSize_);
+
+  std::size_t new_size = stats.TableSize_;
+
+  if (config.Capacity_ != 0) {
+    if (stats.Tombstones_ * 2 <= stats.TableSize_ - stats.Count_) {
+      return;
+    }
+  } else if (load_factor <= config.MaxLoadFactor_) {
+    return;
+  } else {
+    // The size saturates instead of wrapping, so it can be checked here.
+    const unsigned long long grown =
+      GetGrownTableSize(stats.TableSize_, config.GrowthFactor_);
+    const unsigned long long max_size =
+      std::numeric_limits<std::size_t>::max() / sizeof(OAHTSlot);
+
+    if (grown > max_size) {
+      throw OAHashTableException(
+        OAHashTableException::E_NO_MEMORY,
+        "The table can't grow any further."
+      );
     }
+
+    new_size =
+      get_bucketed_size(static_cast<std::size_t>(grown), config.BucketSlots_);
   }
+
+  rehash(new_size);
 }
 
-template<typename T>
-auto OAHashTable<T>::try_grow_table() -> void {
-  const float load_factor =
-    static_cast<float>(stats.Count_ + 1) / static_cast<float>(stats.TableSize_);
+template<typename T, typename I>
+auto OAHashTable<T, I>::reserve(std::size_t count) -> void {
+  if (config.Capacity_ != 0) {
+    return;
+  }
+
+  const double size =
+    std::ceil(static_cast<double>(count) / config.MaxLoadFactor_);
 
-  if (load_factor <= config.MaxLoadFactor_) {
+  if (size <= static_cast<double>(stats.TableSize_)) {
     return;
   }
 
-  double new_factor = std::ceil(stats.TableSize_ * config.GrowthFactor_);
-  unsigned new_size = GetClosestPrime(static_cast<unsigned>(new_factor));
+  const double max_size = static_cast<double>(
+    std::numeric_limits<std::size_t>::max() / sizeof(OAHTSlot)
+  );
+
+  if (size > max_size) {
+    throw OAHashTableException(
+      OAHashTableException::E_NO_MEMORY,
+      "The table can't grow any further."
+    );
+  }
+
+  rehash(get_bucketed_size(
+    static_cast<std::size_t>(
+      GetClosestPrime64(static_cast<unsigned long long>(size))
+    ),
+    config.BucketSlots_
+  ));
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::rehash(std::size_t new_size) -> void {
+  // Allocate first, so the table is still intact if it fails.
+  OAHTSlot* new_slots = nullptr;
+
+  try {
+    new_slots = allocate_slots(new_size);
+  } catch (const std::bad_alloc&) {
+    throw OAHashTableException(
+      OAHashTableException::E_NO_MEMORY,
+      "The table can't grow any further."
+    );
+  }
 
-  size_t old_size = stats.TableSize_;
+  std::size_t old_size = stats.TableSize_;
   stats.TableSize_ = new_size;
   stats.Count_ = 0;
+  stats.Tombstones_ = 0;
+  stats.MaxProbeLength_ = 0;
+  stats.Displacement_ = 0;
 
   OAHTSlot* old_slots = slots;
-  slots = new OAHTSlot[new_size];
+  const std::vector<std::uint64_t> old_referenced = std::move(referenced);
+  const std::vector<std::uint64_t> old_expiries = expiries;
+  slots = new_slots;
   init_table(true);
 
   for (std::size_t i = 0; i < old_size; i++) {
-    if (old_slots[i].State == OAHashTable::OAHTSlot::OCCUPIED) {
-      insert(old_slots[i].Key, old_slots[i].Data);
+    const OAHTSlot& old_slot = old_slots[i];
+
+    if (old_slot.State == OAHashTable::OAHTSlot::OCCUPIED) {
+      const std::size_t index =
+        insert_inner(get_slot_key(old_slot.Key), old_slot.Data);
+
+      if (test_bit(old_referenced, i)) {
+        touch(index);
+      }
+
+      if (!old_expiries.empty()) {
+        set_expiry(index, old_expiries[i]);
+      }
     }
   }
 
-  delete[] old_slots;
+  free_slots(old_slots, old_size);
 
-  stats.Expansions_++;
+  if (new_size != old_size) {
+    stats.Expansions_++;
+  }
 }
 
-template<typename T>
-auto OAHashTable<T>::insert_inner(const char* Key, const T& Data, bool probe)
-  -> void {
+template<typename T, typename I>
+auto OAHashTable<T, I>::insert_inner(
+  const SlotKey& Key,
+  const T& Data,
+  bool probe
+) -> std::size_t {
   try_grow_table();
 
-  std::size_t index = first_hash_function(Key, stats.TableSize_);
+  // Growing past the sizes a HASHFUNC can address places the keys by their
+  // full width hash, which a key made before that doesn't have yet.
+  const SlotKey key =
+    Key.hash == 0 && use_full_width() ? get_slot_key(Key.key) : Key;
+
+  const std::size_t index = get_home(key);
+  const std::size_t stride = get_stride(key);
+  std::size_t displacement = 0;
   OAHTSlot* slot = nullptr;
 
   for (std::size_t i = 0; i < stats.TableSize_; i++) {
-    slot = &get_next_slot_mut(Key, index, i, probe);
+    slot = &get_next_slot_mut(index, stride, i, probe);
+    displacement = i;
 
     if (slot->State == OAHashTable::OAHTSlot::OCCUPIED) {
-      if (strcmp(slot->Key, Key) == 0) {
+      if (strcmp(slot->Key, key.key) == 0) {
         throw OAHashTableException(
           OAHashTableException::E_DUPLICATE,
           "There is a duplicate item in the list."
@@ -259,13 +920,15 @@ auto OAHashTable<T>::insert_inner(const char* Key, const T& Data, bool probe)
     }
 
     for (std::size_t j = i + 1; j < stats.TableSize_; j++) {
-      const OAHTSlot& next_slot = get_next_slot(Key, index, j, probe);
+      const OAHTSlot& next_slot = get_next_slot(index, stride, j, probe);
 
       if (next_slot.State == OAHashTable::OAHTSlot::UNOCCUPIED) {
         break;
       }
 
-      if (strcmp(next_slot.Key, Key) == 0) {
+      // A tombstone keeps the key it had, it isn't a duplicate.
+      if (next_slot.State == OAHashTable::OAHTSlot::OCCUPIED
+          && strcmp(next_slot.Key, key.key) == 0) {
         throw OAHashTableException(
           OAHashTableException::E_DUPLICATE,
           "There is a duplicate item in the list."
@@ -283,183 +946,532 @@ auto OAHashTable<T>::insert_inner(const char* Key, const T& Data, bool probe)
     );
   }
 
+  if (slot->State == OAHashTable::OAHTSlot::DELETED) {
+    stats.Tombstones_--;
+  }
+
   slot->State = OAHashTable::OAHTSlot::OCCUPIED;
-  strcpy(slot->Key, Key);
+  set_occupied(*slot, true);
+  strcpy(slot->Key, key.key);
   slot->Data = Data;
+  bloom.add(key.hash);
 
   stats.Count_++;
+  stats.Displacement_ += displacement;
+  stats.MaxProbeLength_ = std::max(
+    stats.MaxProbeLength_,
+    static_cast<unsigned>(displacement + 1)
+  );
+
+  return static_cast<std::size_t>(slot - slots);
 }
 
-template<typename T>
-auto OAHashTable<T>::find_slot(const char* Key) const
+template<typename T, typename I>
+auto OAHashTable<T, I>::find_slot(const SlotKey& Key, bool probe) const
   -> const SlotSearch<const OAHTSlot> {
-  std::size_t index = first_hash_function(Key, stats.TableSize_);
+  if (!bloom.may_contain(Key.hash)) {
+    if (probe) {
+      I::count_filtered(stats);
+    }
+
+    return SlotSearch<const OAHTSlot>{};
+  }
+
+  const std::size_t index = get_home(Key);
+  const std::size_t stride = get_stride(Key);
 
   for (std::size_t i = 0; i < stats.TableSize_; i++) {
-    const OAHTSlot& slot = get_next_slot(Key, index, i);
+    SlotProbe<const OAHTSlot> query =
+      get_next_slot_with_index(index, stride, i, probe);
+    const OAHTSlot& slot = query.slot;
 
     if (slot.State == OAHashTable::OAHTSlot::UNOCCUPIED) {
       break;
     }
 
-    if (strcmp(slot.Key, Key) == 0) {
-      std::size_t wrapped_index = (index + i) % stats.TableSize_;
-      return SlotSearch<const OAHTSlot>{wrapped_index, &slot};
+    if (slot.State == OAHashTable::OAHTSlot::OCCUPIED
+        && strcmp(slot.Key, Key.key) == 0) {
+      return SlotSearch<const OAHTSlot>{query.index, i, &slot};
     }
   }
 
   return SlotSearch<const OAHTSlot>{};
 }
 
-template<typename T>
-auto OAHashTable<T>::find_slot_mut(const char* Key)
+template<typename T, typename I>
+auto OAHashTable<T, I>::find_slot_mut(const SlotKey& Key)
   -> const SlotSearch<OAHTSlot> {
-  std::size_t index = first_hash_function(Key, stats.TableSize_);
+  if (!bloom.may_contain(Key.hash)) {
+    I::count_filtered(stats);
+    return SlotSearch<OAHTSlot>{};
+  }
 
-  for (std::size_t i = 0; i < stats.TableSize_; i++) {
-    SlotProbe<OAHTSlot> query = get_next_slot_mut_with_index(Key, index, i);
+  const std::size_t index = get_home(Key);
+  const std::size_t stride = get_stride(Key);
+  std::size_t i = 0;
+
+  while (i < stats.TableSize_) {
+    SlotProbe<OAHTSlot> query = get_next_slot_mut_with_index(index, stride, i);
     OAHTSlot& slot = query.slot;
 
     if (slot.State == OAHashTable::OAHTSlot::UNOCCUPIED) {
       break;
     }
 
-    if (strcmp(slot.Key, Key) == 0) {
-      return SlotSearch<OAHTSlot>{query.index, &slot};
+    // An expired element on the way is reclaimed and the slot looked at
+    // again, PACK may have moved another element there.
+    if (slot.State == OAHashTable::OAHTSlot::OCCUPIED
+        && is_expired(query.index)) {
+      erase(query.index, get_displacement(get_slot_key(slot.Key), query.index));
+      stats.Expirations_++;
+      continue;
+    }
+
+    if (slot.State == OAHashTable::OAHTSlot::OCCUPIED
+        && strcmp(slot.Key, Key.key) == 0) {
+      return SlotSearch<OAHTSlot>{query.index, i, &slot};
     }
+
+    i++;
   }
 
   return SlotSearch<OAHTSlot>{};
 }
 
-template<typename T>
+template<typename T, typename I>
 template<typename S>
-OAHashTable<T>::SlotProbe<S>::SlotProbe(std::size_t index, S& slot):
+OAHashTable<T, I>::SlotProbe<S>::SlotProbe(std::size_t index, S& slot):
     index(index), slot(slot) {}
 
-template<typename T>
-auto OAHashTable<T>::get_slot(std::size_t index, bool probe) const
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_slot(std::size_t index, bool probe) const
   -> const SlotProbe<const OAHTSlot> {
   std::size_t wrapped_index = index % stats.TableSize_;
   OAHTSlot& slot = slots[wrapped_index];
 
   if (probe) {
-    slot.probes++;
-    stats.Probes_++;
+    I::count_probe(slot, wrapped_index, stats);
   }
 
   return SlotProbe<const OAHTSlot>(wrapped_index, slot);
 }
 
-template<typename T>
-auto OAHashTable<T>::get_slot_mut(std::size_t index, bool probe)
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_slot_mut(std::size_t index, bool probe)
   -> const SlotProbe<OAHTSlot> {
   std::size_t wrapped_index = index % stats.TableSize_;
   OAHTSlot& slot = slots[wrapped_index];
 
   if (probe) {
-    slot.probes++;
-    stats.Probes_++;
+    I::count_probe(slot, wrapped_index, stats);
   }
 
   return SlotProbe<OAHTSlot>(wrapped_index, slot);
 }
 
-template<typename T>
-auto OAHashTable<T>::use_secondary_hash(const char* Key) const -> std::size_t {
-  if (second_hash_function == nullptr) {
-    return 0;
-  }
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_slot_key(const char* Key) const -> SlotKey {
+  const bool hashed = use_full_width() || bloom.enabled();
 
-  return second_hash_function(Key, stats.TableSize_ - 1) + 1;
+  return SlotKey{Key, hashed ? GetFullHash(Key) : 0};
 }
 
-template<typename T>
-auto OAHashTable<T>::get_next_slot_with_index(
-  const char* Key,
-  std::size_t index,
-  std::size_t offset,
-  bool probe
-) const -> const SlotProbe<const OAHTSlot> {
-  std::size_t next = index;
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_slot_key(const OAHashedKey& Key) -> SlotKey {
+  return SlotKey{Key.Key_, Key.Hash_};
+}
 
-  if (second_hash_function != nullptr) {
+template<typename T, typename I>
+auto OAHashTable<T, I>::use_full_width() const -> bool {
+  return config.FullWidthHash_
+    || stats.TableSize_ > std::numeric_limits<unsigned>::max();
+}
 
-    if (offset != 0) {
-      next += offset * use_secondary_hash(Key);
-    }
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_bucket_slots() const -> std::size_t {
+  return std::max<std::size_t>(config.BucketSlots_, 1);
+}
 
-  } else {
-    next += offset;
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_bucket_count() const -> std::size_t {
+  return stats.TableSize_ / get_bucket_slots();
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_bucketed_size(
+  std::size_t size,
+  std::size_t bucket_slots
+) -> std::size_t {
+  if (bucket_slots <= 1) {
+    return size;
   }
 
-  return get_slot(next, probe);
+  // A prime amount of buckets, so the stride between them visits them all.
+  // There are at least 2, the stride is taken modulo one less.
+  const unsigned long long buckets = GetClosestPrime64(
+    std::max<std::size_t>((size + bucket_slots - 1) / bucket_slots, 2)
+  );
+
+  return static_cast<std::size_t>(buckets * bucket_slots);
 }
 
-template<typename T>
-auto OAHashTable<T>::get_next_slot_mut_with_index(
-  const char* Key,
-  std::size_t index,
-  std::size_t offset,
-  bool probe
-) -> const SlotProbe<OAHTSlot> {
-  std::size_t next = index;
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_home(const SlotKey& Key) const -> std::size_t {
+  if (use_full_width()) {
+    return static_cast<std::size_t>(Key.hash % stats.TableSize_);
+  }
 
-  if (second_hash_function != nullptr) {
+  return first_hash_function(
+    Key.key,
+    static_cast<unsigned>(stats.TableSize_)
+  );
+}
 
-    if (offset != 0) {
-      next += offset * use_secondary_hash(Key);
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_stride(const SlotKey& Key) const -> std::size_t {
+  if (second_hash_function == nullptr) {
+    return 1;
+  }
+
+  // The home took the hash modulo the size, the stride starts from the high
+  // bits (rotated, so sizes past 32 bits still get every stride).
+  if (use_full_width()) {
+    const std::uint64_t rotated = Key.hash >> 32 | Key.hash << 32;
+    return static_cast<std::size_t>(rotated % (get_bucket_count() - 1)) + 1;
+  }
+
+  return second_hash_function(
+    Key.key,
+    static_cast<unsigned>(get_bucket_count() - 1)
+  ) + 1;
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_probe_index(
+  std::size_t index,
+  std::size_t stride,
+  std::size_t offset
+) const -> std::size_t {
+  const std::size_t bucket_slots = get_bucket_slots();
+
+  // Every bucket is scanned, starting from the lane of the home slot, before
+  // taking a stride to the next one.
+  if (bucket_slots > 1) {
+    const std::size_t buckets = get_bucket_count();
+    const std::size_t home = index / bucket_slots;
+    const std::size_t steps = offset / bucket_slots;
+    std::size_t lane =
+      (index - home * bucket_slots) + (offset - steps * bucket_slots);
+    const std::size_t bucket =
+      steps == 0 || stride <= (~std::size_t(0) - home) / steps
+        ? (home + steps * stride) % buckets
+        : static_cast<std::size_t>(
+            (home + MulMod(steps, stride, buckets)) % buckets
+          );
+
+    if (lane >= bucket_slots) {
+      lane -= bucket_slots;
     }
 
-  } else {
-    next += offset;
+    return bucket * bucket_slots + lane;
+  }
+
+  // offset * stride only passes 64 bits on tables past 4 billion slots.
+  if (offset == 0 || stride <= (~std::size_t(0) - index) / offset) {
+    return index + offset * stride;
   }
 
-  return get_slot_mut(next, probe);
+  return static_cast<std::size_t>(
+    (index + MulMod(offset, stride, stats.TableSize_)) % stats.TableSize_
+  );
 }
 
-template<typename T>
-auto OAHashTable<T>::get_next_slot(
-  const char* Key,
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_next_slot_with_index(
+  std::size_t index,
+  std::size_t stride,
+  std::size_t offset,
+  bool probe
+) const -> const SlotProbe<const OAHTSlot> {
+  return get_slot(get_probe_index(index, stride, offset), probe);
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_next_slot_mut_with_index(
   std::size_t index,
+  std::size_t stride,
+  std::size_t offset,
+  bool probe
+) -> const SlotProbe<OAHTSlot> {
+  return get_slot_mut(get_probe_index(index, stride, offset), probe);
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_next_slot(
+  std::size_t index,
+  std::size_t stride,
   std::size_t offset,
   bool probe
 ) const -> const OAHTSlot& {
-  return get_next_slot_with_index(Key, index, offset, probe).slot;
+  return get_next_slot_with_index(index, stride, offset, probe).slot;
 }
 
-template<typename T>
-auto OAHashTable<T>::get_next_slot_mut(
-  const char* Key,
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_next_slot_mut(
   std::size_t index,
+  std::size_t stride,
   std::size_t offset,
   bool probe
 ) -> OAHTSlot& {
-  return get_next_slot_mut_with_index(Key, index, offset, probe).slot;
+  return get_next_slot_mut_with_index(index, stride, offset, probe).slot;
 }
 
-template<typename T>
-auto OAHashTable<T>::adjust_mark(std::size_t index) -> void {
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_displacement(
+  const SlotKey& Key,
+  std::size_t index
+) const -> std::size_t {
+  const std::size_t bucket_slots = get_bucket_slots();
+  const std::size_t size = get_bucket_count();
+  const std::size_t home_slot = get_home(Key);
+  const std::size_t home = home_slot / bucket_slots;
+  const std::size_t bucket = index / bucket_slots;
+  const std::size_t lane =
+    (index % bucket_slots + bucket_slots - home_slot % bucket_slots)
+    % bucket_slots;
+
+  if (second_hash_function == nullptr) {
+    return (bucket + size - home) % size * bucket_slots + lane;
+  }
+
+  std::size_t stride = get_stride(Key);
+  std::size_t position = home % size;
+
+  for (std::size_t steps = 0; steps < size; steps++) {
+    if (position == bucket) {
+      return steps * bucket_slots + lane;
+    }
+
+    position = (position + stride) % size;
+  }
+
+  return 0;
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::add_to_histogram(
+  std::vector<std::size_t>& histogram,
+  std::size_t value
+) -> void {
+  if (histogram.size() <= value) {
+    histogram.resize(value + 1);
+  }
+
+  histogram[value]++;
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::adjust_mark(std::size_t index) -> void {
   slots[index].State = OAHashTable::OAHTSlot::DELETED;
+  stats.Tombstones_++;
 }
 
-template<typename T>
-auto OAHashTable<T>::adjust_pack(std::size_t index) -> void {
+template<typename T, typename I>
+auto OAHashTable<T, I>::adjust_pack(std::size_t index) -> void {
+  std::size_t moved = 0;
+
   for (std::size_t i = 1; i < stats.TableSize_; i++) {
-    OAHTSlot& slot = get_slot_mut(index + i, false).slot;
+    SlotProbe<OAHTSlot> query = get_slot_mut(index + i, false);
+    OAHTSlot& slot = query.slot;
 
     if (slot.State != OAHashTable::OAHTSlot::OCCUPIED) {
       break;
     }
 
+    const SlotKey key = get_slot_key(slot.Key);
+    stats.Displacement_ -= get_displacement(key, query.index);
+    const bool referenced_slot = test_bit(referenced, query.index);
+    const std::uint64_t expiry =
+      expiries.empty() ? 0 : expiries[query.index];
     slot.State = OAHashTable::OAHTSlot::UNOCCUPIED;
+    set_occupied(slot, false);
     stats.Count_--;
-    insert_inner(slot.Key, slot.Data);
+
+    // Moving an element doesn't cost it its second chance or its expiry.
+    const std::size_t moved_to = insert_inner(key, slot.Data);
+    set_expiry(moved_to, expiry);
+
+    if (referenced_slot) {
+      touch(moved_to);
+    }
+
+    moved++;
+  }
+
+  if (moved != 0) {
+    stats.Compactions_++;
+    stats.Repacked_ += moved;
+  }
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::erase(std::size_t index, std::size_t displacement)
+  -> void {
+  stats.Displacement_ -= displacement;
+  delete_slot(slots[index]);
+
+  // PACK only knows how to close gaps in linear runs of slots.
+  const OAHTDeletionPolicy policy =
+    get_bucket_slots() > 1 ? OAHTDeletionPolicy::MARK : config.DeletionPolicy_;
+
+  switch (policy) {
+    case OAHTDeletionPolicy::MARK: adjust_mark(index); break;
+    case OAHTDeletionPolicy::PACK: adjust_pack(index); break;
+  }
+
+  bloom.remove();
+
+  if (bloom.needs_rebuild(stats.Count_)) {
+    rebuild_bloom();
+    stats.Rebuilds_++;
+  }
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::evict() -> void {
+  if (stats.Count_ == 0) {
+    return;
+  }
+
+  std::size_t hand = clock_hand;
+
+  // Two turns at most, the first one clears every reference bit.
+  for (std::size_t step = 0; step <= 2 * occupancy.size(); step++) {
+    const std::size_t word = hand / OCCUPANCY_BITS;
+    const std::uint64_t ahead = ~std::uint64_t(0) << hand % OCCUPANCY_BITS;
+    const std::uint64_t victims = occupancy[word] & ~referenced[word] & ahead;
+
+    if (victims == 0) {
+      referenced[word] &= ~ahead;
+      hand = (word + 1) * OCCUPANCY_BITS;
+      hand = hand < stats.TableSize_ ? hand : 0;
+      continue;
+    }
+
+    const std::size_t bit = get_lowest_bit(victims);
+    const std::size_t victim = word * OCCUPANCY_BITS + bit;
+
+    // The ones the hand went past get a second chance.
+    referenced[word] &= ~(ahead & ((std::uint64_t(1) << bit) - 1));
+    clock_hand = (victim + 1) % stats.TableSize_;
+
+    erase(victim, get_displacement(get_slot_key(slots[victim].Key), victim));
+    stats.Evictions_++;
+    return;
+  }
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::insert_expiring(
+  const SlotKey& Key,
+  const T& Data,
+  std::uint64_t expiry
+) -> void {
+  if (!expiries.empty()) {
+    expire();
+
+    // Reclaims the expired pairs on the way, so insert_inner reuses their
+    // slots. An expired pair with the same key is gone too.
+    find_slot_mut(Key);
+  }
+
+  // A duplicate throws in insert_inner, it shouldn't cost an element first.
+  if (config.Capacity_ != 0 && stats.Count_ >= config.Capacity_
+      && find_slot(Key, false).slot == nullptr) {
+    evict();
+  }
+
+  set_expiry(insert_inner(Key, Data), expiry);
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_expiry(std::chrono::nanoseconds Ttl)
+  -> std::uint64_t {
+  const std::uint64_t now = get_time();
+
+  if (expiries.empty()) {
+    expiries.assign(stats.TableSize_, 0);
+    wheel.assign(WHEEL_BUCKETS, std::vector<WheelTimer>());
+    wheel_tick = now / WHEEL_TICK;
+  }
+
+  const std::int64_t ttl = std::max<std::int64_t>(Ttl.count(), 0);
+
+  return now + static_cast<std::uint64_t>(ttl);
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::set_expiry(std::size_t index, std::uint64_t expiry)
+  -> void {
+  if (expiries.empty()) {
+    return;
   }
+
+  expiries[index] = expiry;
+
+  if (expiry != 0) {
+    // Never behind the wheel, or it would take a whole turn to get there.
+    const std::uint64_t tick = std::max(expiry / WHEEL_TICK, wheel_tick);
+    wheel[tick % WHEEL_BUCKETS].push_back(WheelTimer{index, expiry});
+  }
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::is_expired(std::size_t index) const -> bool {
+  if (expiries.empty() || expiries[index] == 0) {
+    return false;
+  }
+
+  return expiries[index] <= get_time();
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::is_expired(std::size_t index, std::uint64_t now) const
+  -> bool {
+  return !expiries.empty() && expiries[index] != 0 && expiries[index] <= now;
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_time() -> std::uint64_t {
+  return static_cast<std::uint64_t>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()
+    ).count()
+  );
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::touch(std::size_t index) const -> void {
+  if (!referenced.empty()) {
+    referenced[index / OCCUPANCY_BITS] |=
+      std::uint64_t(1) << index % OCCUPANCY_BITS;
+  }
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::test_bit(
+  const std::vector<std::uint64_t>& bits,
+  std::size_t index
+) -> bool {
+  if (bits.empty()) {
+    return false;
+  }
+
+  return (bits[index / OCCUPANCY_BITS] >> index % OCCUPANCY_BITS & 1) != 0;
 }
 
-template<typename T>
-auto OAHashTable<T>::delete_slot(OAHTSlot& slot) -> void {
+template<typename T, typename I>
+auto OAHashTable<T, I>::delete_slot(OAHTSlot& slot) -> void {
   if (slot.State != OAHashTable::OAHTSlot::OCCUPIED) {
     return;
   }
@@ -469,9 +1481,311 @@ auto OAHashTable<T>::delete_slot(OAHTSlot& slot) -> void {
   }
 
   slot.State = OAHashTable::OAHTSlot::UNOCCUPIED;
+  set_occupied(slot, false);
   stats.Count_--;
 }
 
+template<typename T, typename I>
+template<typename F>
+auto OAHashTable<T, I>::for_each_in(std::size_t first, std::size_t last, F& fn)
+  const -> void {
+  const std::uint64_t now = expiries.empty() ? 0 : get_time();
+
+  for (std::size_t word = first; word < last; word++) {
+    std::uint64_t bits = occupancy[word];
+
+    while (bits != 0) {
+      const std::size_t index = word * OCCUPANCY_BITS + get_lowest_bit(bits);
+      bits &= bits - 1;
+
+      if (is_expired(index, now)) {
+        continue;
+      }
+
+      fn(static_cast<const char*>(slots[index].Key), slots[index].Data);
+    }
+  }
+}
+
+template<typename T, typename I>
+template<typename F>
+auto OAHashTable<T, I>::fan_out(F work, std::size_t Threads) const -> void {
+  const std::size_t words = occupancy.size();
+  const std::size_t chunks =
+    (words + PARALLEL_CHUNK_WORDS - 1) / PARALLEL_CHUNK_WORDS;
+  const std::size_t workers = std::min<std::size_t>(
+    chunks,
+    Threads != 0 ? Threads : std::max(std::thread::hardware_concurrency(), 1u)
+  );
+
+  std::atomic<std::size_t> next_chunk{0};
+  std::vector<std::exception_ptr> failures(workers);
+  std::vector<std::thread> threads;
+
+  auto worker = [&](std::size_t id) {
+    for (std::size_t chunk = next_chunk++; chunk < chunks;
+         chunk = next_chunk++) {
+      const std::size_t first = chunk * PARALLEL_CHUNK_WORDS;
+
+      try {
+        work(chunk, first, std::min(first + PARALLEL_CHUNK_WORDS, words));
+      } catch (...) {
+        if (!failures[id]) {
+          failures[id] = std::current_exception();
+        }
+      }
+    }
+  };
+
+  for (std::size_t id = 1; id < workers; id++) {
+    threads.emplace_back(worker, id);
+  }
+
+  if (workers != 0) {
+    worker(0);
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (std::exception_ptr& failure : failures) {
+    if (failure) {
+      std::rethrow_exception(failure);
+    }
+  }
+}
+
+template<typename T, typename I>
+template<typename I2>
+auto OAHashTable<T, I>::pair_slots(
+  const OAHashTable<T, I2>& Other,
+  std::size_t Threads
+) const -> std::vector<SlotPair> {
+  if (stats.Count_ <= Other.stats.Count_) {
+    return match_slots(*this, Other, Threads);
+  }
+
+  std::vector<SlotPair> pairs = match_slots(Other, *this, Threads);
+
+  for (SlotPair& pair : pairs) {
+    std::swap(pair.mine, pair.theirs);
+  }
+
+  return pairs;
+}
+
+template<typename T, typename I>
+template<typename W, typename P>
+auto OAHashTable<T, I>::match_slots(
+  const W& Walked,
+  const P& Probed,
+  std::size_t Threads
+) -> std::vector<SlotPair> {
+  const std::size_t chunks =
+    (Walked.occupancy.size() + PARALLEL_CHUNK_WORDS - 1)
+    / PARALLEL_CHUNK_WORDS;
+  std::vector<std::vector<SlotPair>> found(chunks);
+
+  // Expired elements of either table are left out, against one reading of
+  // the clock.
+  const std::uint64_t now = get_time();
+
+  Walked.fan_out([&](std::size_t chunk, std::size_t first, std::size_t last) {
+    for (std::size_t word = first; word < last; word++) {
+      std::uint64_t bits = Walked.occupancy[word];
+
+      while (bits != 0) {
+        const std::size_t index = word * OCCUPANCY_BITS + get_lowest_bit(bits);
+        bits &= bits - 1;
+
+        if (Walked.is_expired(index, now)) {
+          continue;
+        }
+
+        const char* key = Walked.slots[index].Key;
+        const auto search = Probed.find_slot(Probed.get_slot_key(key), false);
+
+        if (search.slot != nullptr && !Probed.is_expired(search.index, now)) {
+          found[chunk].push_back(SlotPair{index, search.index});
+        }
+      }
+    }
+  }, Threads);
+
+  std::vector<SlotPair> pairs;
+
+  for (const std::vector<SlotPair>& chunk : found) {
+    pairs.insert(pairs.end(), chunk.begin(), chunk.end());
+  }
+
+  return pairs;
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::remove_marked(
+  const std::vector<std::uint64_t>& marks,
+  bool marked
+) -> void {
+  std::vector<std::string> keys;
+
+  for (std::size_t word = 0; word < occupancy.size(); word++) {
+    const std::uint64_t mark = marked ? marks[word] : ~marks[word];
+    std::uint64_t bits = occupancy[word] & mark;
+
+    while (bits != 0) {
+      const std::size_t index = word * OCCUPANCY_BITS + get_lowest_bit(bits);
+      keys.emplace_back(slots[index].Key);
+      bits &= bits - 1;
+    }
+  }
+
+  for (const std::string& key : keys) {
+    const SlotSearch<OAHTSlot> search =
+      find_slot_mut(get_slot_key(key.c_str()));
+
+    if (search.slot != nullptr) {
+      erase(search.index, search.probe);
+    }
+  }
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::rebuild_bloom() -> void {
+  if (!bloom.enabled()) {
+    return;
+  }
+
+  // Sized for the most elements before the table grows.
+  const double capacity =
+    std::min(config.MaxLoadFactor_, 1.0) * stats.TableSize_ + 1;
+  bloom.reset(static_cast<std::size_t>(capacity));
+
+  // Expired elements too, the probes that reclaim them must not be filtered.
+  for (std::size_t word = 0; word < occupancy.size(); word++) {
+    std::uint64_t bits = occupancy[word];
+
+    while (bits != 0) {
+      const std::size_t index = word * OCCUPANCY_BITS + get_lowest_bit(bits);
+      bits &= bits - 1;
+
+      bloom.add(GetFullHash(slots[index].Key));
+    }
+  }
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::set_occupied(const OAHTSlot& slot, bool occupied)
+  -> void {
+  const std::size_t index = static_cast<std::size_t>(&slot - slots);
+  const std::uint64_t bit = std::uint64_t(1) << index % OCCUPANCY_BITS;
+
+  if (occupied) {
+    occupancy[index / OCCUPANCY_BITS] |= bit;
+  } else {
+    occupancy[index / OCCUPANCY_BITS] &= ~bit;
+  }
+
+  // Elements start unreferenced, so the ones never found go first.
+  if (!referenced.empty()) {
+    referenced[index / OCCUPANCY_BITS] &= ~bit;
+  }
+
+  if (!expiries.empty()) {
+    expiries[index] = 0;
+  }
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::find_occupied(std::size_t index) const
+  -> std::size_t {
+  if (index >= stats.TableSize_) {
+    return stats.TableSize_;
+  }
+
+  std::size_t word = index / OCCUPANCY_BITS;
+  std::uint64_t bits =
+    occupancy[word] & ~std::uint64_t(0) << index % OCCUPANCY_BITS;
+
+  for (;;) {
+    while (bits == 0) {
+      if (++word == occupancy.size()) {
+        return stats.TableSize_;
+      }
+
+      bits = occupancy[word];
+    }
+
+    const std::size_t found = word * OCCUPANCY_BITS + get_lowest_bit(bits);
+
+    if (!is_expired(found)) {
+      return found;
+    }
+
+    bits &= bits - 1;
+  }
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::get_lowest_bit(std::uint64_t word) -> std::size_t {
+#if defined(__GNUC__)
+  return static_cast<std::size_t>(__builtin_ctzll(word));
+#else
+  std::size_t bit = 0;
+
+  while ((word & 1) == 0) {
+    word >>= 1;
+    bit++;
+  }
+
+  return bit;
+#endif
+}
+
+// Iterator stuff
+
+template<typename T, typename I>
+OAHashTable<T, I>::OAHTIterator::OAHTIterator(
+  const OAHashTable* table,
+  std::size_t index
+):
+    table(table), index(index) {}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::OAHTIterator::operator*() const -> reference {
+  return table->slots[index];
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::OAHTIterator::operator->() const -> pointer {
+  return &table->slots[index];
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::OAHTIterator::operator++() -> OAHTIterator& {
+  index = table->find_occupied(index + 1);
+  return *this;
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::OAHTIterator::operator++(int) -> OAHTIterator {
+  OAHTIterator previous = *this;
+  ++*this;
+  return previous;
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::OAHTIterator::operator==(const OAHTIterator& rhs) const
+  -> bool {
+  return table == rhs.table && index == rhs.index;
+}
+
+template<typename T, typename I>
+auto OAHashTable<T, I>::OAHTIterator::operator!=(const OAHTIterator& rhs) const
+  -> bool {
+  return !(*this == rhs);
+}
+
 // Stats stuff
 
 OAHTStats::OAHTStats():
@@ -480,19 +1794,255 @@ OAHTStats::OAHTStats():
     Probes_(0),
     Expansions_(0),
     PrimaryHashFunc_(0),
-    SecondaryHashFunc_(0) {}
+    SecondaryHashFunc_(0),
+    Tombstones_(0),
+    MaxProbeLength_(0),
+    Displacement_(0),
+    Compactions_(0),
+    Repacked_(0),
+    Filtered_(0),
+    Rebuilds_(0),
+    Evictions_(0),
+    Expirations_(0),
+    Memory_() {}
+
+OAHashedKey::OAHashedKey(const char* Key):
+    Key_(Key), Hash_(GetFullHash(Key)) {}
+
+OAHTMemory::OAHTMemory():
+    SlotBytes_(0),
+    TableBytes_(0),
+    PayloadBytes_(0),
+    OverheadBytes_(0),
+    UnusedBytes_(0),
+    ExtraBytes_(0),
+    TotalBytes_(0),
+    BytesPerEntry_(0) {}
+
+OAHTAnalysis::OAHTAnalysis():
+    SuccessfulProbes_(),
+    UnsuccessfulProbes_(),
+    ClusterLengths_(),
+    MaxProbeLength_(0),
+    Tombstones_(0),
+    AverageSuccessfulProbes_(0),
+    AverageUnsuccessfulProbes_(0),
+    AverageDisplacement_(0) {}
+
+// Bloom stuff
+
+OABloomFilter::OABloomFilter(unsigned BitsPerKey):
+    bits_per_key(BitsPerKey),
+    // k = ln(2) * bits per key gives the fewest false positives.
+    hashes(std::min(16u, std::max(1u, static_cast<unsigned>(
+      BitsPerKey * 0.693 + 0.5
+    )))) {}
+
+OABloomFilter::OABloomFilter(const OABloomFilter& rhs):
+    bits_per_key(rhs.bits_per_key),
+    hashes(rhs.hashes),
+    block_count(rhs.block_count),
+    removed(rhs.removed),
+    words(rhs.words.size(), 0) {
+  copy_blocks(rhs);
+}
+
+OABloomFilter& OABloomFilter::operator=(const OABloomFilter& rhs) {
+  if (this == &rhs) {
+    return *this;
+  }
+
+  bits_per_key = rhs.bits_per_key;
+  hashes = rhs.hashes;
+  block_count = rhs.block_count;
+  removed = rhs.removed;
+  words.assign(rhs.words.size(), 0);
+  copy_blocks(rhs);
+
+  return *this;
+}
+
+bool OABloomFilter::enabled() const {
+  return bits_per_key != 0;
+}
+
+void OABloomFilter::reset(std::size_t Keys) {
+  removed = 0;
+
+  if (!enabled()) {
+    return;
+  }
+
+  const std::size_t bits = std::max<std::size_t>(Keys, 1) * bits_per_key;
+  block_count = (bits + BLOCK_BITS - 1) / BLOCK_BITS;
+
+  // A block more than needed so the first one can start on a cache line.
+  words.assign((block_count + 1) * BLOCK_WORDS, 0);
+}
+
+void OABloomFilter::add(std::uint64_t FullHash) {
+  if (!enabled()) {
+    return;
+  }
+
+  const std::uint64_t hash = get_hash(FullHash);
+
+  for (unsigned i = 0; i < hashes; i++) {
+    std::size_t word = 0;
+    const std::uint64_t bit = get_bit(hash, i, word);
+    words[word] |= bit;
+  }
+}
+
+void OABloomFilter::remove() {
+  if (enabled()) {
+    removed++;
+  }
+}
+
+bool OABloomFilter::may_contain(std::uint64_t FullHash) const {
+  if (!enabled()) {
+    return true;
+  }
+
+  const std::uint64_t hash = get_hash(FullHash);
+
+  for (unsigned i = 0; i < hashes; i++) {
+    std::size_t word = 0;
+    const std::uint64_t bit = get_bit(hash, i, word);
+
+    if ((words[word] & bit) == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool OABloomFilter::needs_rebuild(std::size_t Count) const {
+  return enabled() && removed * 4 > Count;
+}
+
+std::size_t OABloomFilter::bytes() const {
+  return words.capacity() * sizeof(std::uint64_t);
+}
+
+void OABloomFilter::copy_blocks(const OABloomFilter& rhs) {
+  // The copy may be aligned differently, so the blocks move with it.
+  const std::vector<std::uint64_t>::const_iterator first =
+    rhs.words.begin() + static_cast<std::ptrdiff_t>(rhs.get_offset());
+
+  std::copy(
+    first,
+    first + static_cast<std::ptrdiff_t>(block_count * BLOCK_WORDS),
+    words.begin() + static_cast<std::ptrdiff_t>(get_offset())
+  );
+}
+
+std::size_t OABloomFilter::get_offset() const {
+  const std::size_t line = BLOCK_BITS / 8;
+  const std::size_t misalignment =
+    reinterpret_cast<std::uintptr_t>(words.data()) % line;
+
+  if (misalignment == 0) {
+    return 0;
+  }
+
+  return (line - misalignment) / sizeof(std::uint64_t);
+}
+
+std::uint64_t OABloomFilter::get_bit(
+  std::uint64_t hash,
+  unsigned which,
+  std::size_t& word
+) const {
+  // The low half picks the block, the high half the bits in it.
+  const std::uint64_t low = hash & 0xFFFFFFFFu;
+  const std::uint64_t high = hash >> 32;
+  const std::size_t block = static_cast<std::size_t>(low * block_count >> 32);
+  const std::size_t bit =
+    static_cast<std::size_t>(high + which * (high >> 16 | 1)) % BLOCK_BITS;
+
+  word = get_offset() + block * BLOCK_WORDS + bit / 64;
+  return std::uint64_t(1) << bit % 64;
+}
+
+std::uint64_t OABloomFilter::get_hash(std::uint64_t FullHash) {
+  // The finalizer of MurmurHash3, FNV-1a leaves the low bits weak.
+  std::uint64_t hash = FullHash;
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ULL;
+  hash ^= hash >> 33;
+
+  return hash;
+}
+
+// Instrumentation stuff
+
+template<typename S>
+void OAFullInstrumentation::count_probe(
+  S& slot,
+  std::size_t,
+  OAHTStats& stats
+) {
+  slot.probes++;
+  stats.Probes_++;
+}
+
+template<typename S>
+void OAFullInstrumentation::reset(S& slot) {
+  slot.probes = 0;
+}
+
+void OAFullInstrumentation::count_filtered(OAHTStats& stats) {
+  stats.Filtered_++;
+}
+
+template<typename S>
+void OASampledInstrumentation::count_probe(
+  S&,
+  std::size_t index,
+  OAHTStats& stats
+) {
+  if (index % SAMPLE_RATE == 0) {
+    stats.Probes_ += SAMPLE_RATE;
+  }
+}
+
+template<typename S>
+void OASampledInstrumentation::reset(S&) {}
+
+void OASampledInstrumentation::count_filtered(OAHTStats& stats) {
+  stats.Filtered_++;
+}
+
+template<typename S>
+void OANoInstrumentation::count_probe(S&, std::size_t, OAHTStats&) {}
+
+template<typename S>
+void OANoInstrumentation::reset(S&) {}
+
+void OANoInstrumentation::count_filtered(OAHTStats&) {}
 
 // Config stuff
 
-template<typename T>
-OAHashTable<T>::OAHTConfig::OAHTConfig(
-  unsigned InitialTableSize,
+template<typename T, typename I>
+OAHashTable<T, I>::OAHTConfig::OAHTConfig(
+  std::size_t InitialTableSize,
   HASHFUNC PrimaryHashFunc,
   HASHFUNC SecondaryHashFunc,
   double MaxLoadFactor,
   double GrowthFactor,
   OAHTDeletionPolicy Policy,
-  FREEPROC FreeProc
+  FREEPROC FreeProc,
+  unsigned BloomBitsPerKey,
+  std::size_t Capacity,
+  bool FullWidthHash,
+  OAHTNumaPolicy NumaPolicy,
+  unsigned NumaNode,
+  std::size_t BucketSlots
 ):
     InitialTableSize_(InitialTableSize),
     PrimaryHashFunc_(PrimaryHashFunc),
@@ -500,7 +2050,13 @@ OAHashTable<T>::OAHTConfig::OAHTConfig(
     MaxLoadFactor_(MaxLoadFactor),
     GrowthFactor_(GrowthFactor),
     DeletionPolicy_(Policy),
-    FreeProc_(FreeProc) {}
+    FreeProc_(FreeProc),
+    BloomBitsPerKey_(BloomBitsPerKey),
+    Capacity_(Capacity),
+    FullWidthHash_(FullWidthHash),
+    NumaPolicy_(NumaPolicy),
+    NumaNode_(NumaNode),
+    BucketSlots_(BucketSlots) {}
 
 // Exception functions
 
@@ -10,7 +10,12 @@
 #pragma once
 
 //---------------------------------------------------------------------------
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <string>
+#include <vector>
 
 #ifndef OAHASHTABLEH
   #define OAHASHTABLEH
@@ -44,7 +49,7 @@ public:
     Retrieves exception code
 
     \return
-      One of: E_ITEM_NOT_FOUND, E_DUPLICATE, E_NO_MEMORY
+      One of: E_ITEM_NOT_FOUND, E_DUPLICATE, E_NO_MEMORY, E_RESERVED
   */
   virtual int code() const;
 
@@ -60,7 +65,8 @@ public:
   enum OAHASHTABLE_EXCEPTION {
     E_ITEM_NOT_FOUND,
     E_DUPLICATE,
-    E_NO_MEMORY
+    E_NO_MEMORY,
+    E_RESERVED //!< The key or data is a value the table uses internally
   };
 };
 
@@ -70,25 +76,357 @@ enum OAHTDeletionPolicy {
   PACK
 };
 
-//! OAHashTable statistical info
+//! Where the pages of the slot array are placed on NUMA machines
+enum OAHTNumaPolicy {
+  NUMA_DEFAULT,    //!< Wherever the thread that first touches them runs
+  NUMA_INTERLEAVE, //!< Spread round robin over every node
+  NUMA_NODE        //!< On NumaNode_, if it has room
+};
+
+/**
+ * @brief What a table costs in memory. The slot array is split in the keys and
+ * data of the elements, the rest of their slots (state, counters and padding)
+ * and the slots without an element, so the three add up to `TableBytes_`.
+ * Memory owned by the data itself can't be seen and isn't counted.
+ */
+struct OAHTMemory {
+  //! Default constructor
+  OAHTMemory();
+  std::size_t SlotBytes_;     //!< Size of a single slot
+  std::size_t TableBytes_;    //!< The whole slot array
+  std::size_t PayloadBytes_;  //!< Keys and data of the elements
+  std::size_t OverheadBytes_; //!< The rest of the slots of the elements
+  std::size_t UnusedBytes_;   //!< Slots that are empty or deleted
+  std::size_t ExtraBytes_;    //!< Other allocations (occupancy bitmap)
+  std::size_t TotalBytes_;    //!< Everything, with the table object itself
+  double BytesPerEntry_;      //!< TotalBytes_ over the amount of elements
+};
+
+/**
+ * @brief OAHashTable statistical info. Sizes are std::size_t and the running
+ * counters are 64 bit, so neither wraps on tables past 4 billion slots.
+ */
 struct OAHTStats {
   //! Default constructor
   OAHTStats();
-  unsigned Count_;             //!< Number of elements in the table
-  unsigned TableSize_;         //!< Size of the table (total slots)
-  unsigned Probes_;            //!< Number of probes performed
+  std::size_t Count_;          //!< Number of elements in the table
+  std::size_t TableSize_;      //!< Size of the table (total slots)
+  std::uint64_t Probes_;       //!< Number of probes performed
   unsigned Expansions_;        //!< Number of times the table grew
   HASHFUNC PrimaryHashFunc_;   //!< Pointer to primary hash function
   HASHFUNC SecondaryHashFunc_; //!< Pointer to secondary hash function
+  std::size_t Tombstones_;     //!< Number of slots marked as deleted
+  unsigned MaxProbeLength_;    //!< Longest insertion since the last growth
+  std::uint64_t Displacement_; //!< Probe steps from home of all elements
+  std::uint64_t Compactions_;  //!< Number of PACK removals that moved items
+  std::uint64_t Repacked_;     //!< Number of items moved by PACK removals
+  std::uint64_t Filtered_;     //!< Lookups the prefilter answered as misses
+  std::uint64_t Rebuilds_;     //!< Rebuilds of the prefilter after removals
+  std::uint64_t Evictions_;    //!< Elements a full cache got rid of
+  std::uint64_t Expirations_;  //!< Elements reclaimed after their TTL
+  OAHTMemory Memory_;          //!< What the table costs
+};
+
+/**
+ * @brief A full picture of how the elements are laid out in the table. The
+ * histograms are indexed by length, so `SuccessfulProbes_[3]` is the amount of
+ * elements that take 3 probes to find.
+ */
+struct OAHTAnalysis {
+  //! Default constructor
+  OAHTAnalysis();
+  std::vector<std::size_t> SuccessfulProbes_;   //!< Probes to find each one
+  std::vector<std::size_t> UnsuccessfulProbes_; //!< Probes for a miss
+  std::vector<std::size_t> ClusterLengths_;     //!< Runs of non-empty slots
+  unsigned MaxProbeLength_;                     //!< Longest successful search
+  std::size_t Tombstones_;                      //!< Slots marked as deleted
+  double AverageSuccessfulProbes_;           //!< Mean of SuccessfulProbes_
+  double AverageUnsuccessfulProbes_;         //!< Mean of UnsuccessfulProbes_
+  double AverageDisplacement_;               //!< Mean probe steps from home
+};
+
+/**
+ * @brief A key hashed once, for looking it up many times or in many tables.
+ * The key isn't copied, so it has to outlive the handle. The full width hash
+ * doesn't depend on the table size, so with `FullWidthHash_` in the config a
+ * lookup never runs a hash function and the handle stays valid when the table
+ * grows. Without it only the prefilter uses the hash, and the hash functions
+ * run once per operation instead of once per probe.
+ */
+struct OAHashedKey {
+  /**
+   * @brief Hashes a key.
+   *
+   * @param Key The key.
+   */
+  explicit OAHashedKey(const char* Key);
+
+  const char* Key_;     //!< The key
+  std::uint64_t Hash_;  //!< GetFullHash of the key
+};
+
+/**
+ * @brief Blocked Bloom filter over the keys of a table. Every key sets and
+ * tests a few bits of a single 512 bit block (one cache line), so a lookup of
+ * a key that was never added reads one line. Keys can't be taken out, the
+ * filter counts the removals instead and asks to be rebuilt once they are more
+ * than a quarter of the elements left.
+ */
+class OABloomFilter {
+public:
+
+  //! Bits in every block (a cache line)
+  static const std::size_t BLOCK_BITS = 512;
+
+  /**
+   * @brief Constructor for an empty filter that holds nothing.
+   *
+   * @param BitsPerKey Bits for every key it's sized for (0 to disable it).
+   */
+  explicit OABloomFilter(unsigned BitsPerKey = 0);
+
+  /**
+   * @brief Copy constructor, the blocks are realigned in the copy.
+   *
+   * @param rhs The filter to copy from.
+   */
+  OABloomFilter(const OABloomFilter& rhs);
+
+  /**
+   * @brief Move constructor.
+   *
+   * @param rhs The filter being moved.
+   */
+  OABloomFilter(OABloomFilter&& rhs) = default;
+
+  /**
+   * @brief Copy assignment, the blocks are realigned in the copy.
+   *
+   * @param rhs The filter to copy from.
+   */
+  OABloomFilter& operator=(const OABloomFilter& rhs);
+
+  /**
+   * @brief Move assignment.
+   *
+   * @param rhs The filter being moved.
+   */
+  OABloomFilter& operator=(OABloomFilter&& rhs) = default;
+
+  /**
+   * @brief Whether the filter is in use.
+   *
+   * @return Whether it was given bits per key.
+   */
+  bool enabled() const;
+
+  /**
+   * @brief Empties the filter and sizes it for some amount of keys.
+   *
+   * @param Keys The most keys it will hold.
+   */
+  void reset(std::size_t Keys);
+
+  /**
+   * @brief Adds a key.
+   *
+   * @param FullHash The full width hash of the key (GetFullHash).
+   */
+  void add(std::uint64_t FullHash);
+
+  /**
+   * @brief Counts a key that was taken out of the table.
+   */
+  void remove();
+
+  /**
+   * @brief Tests a key.
+   *
+   * @param FullHash The full width hash of the key (GetFullHash).
+   * @return False if the key was never added, true if it may have been.
+   */
+  bool may_contain(std::uint64_t FullHash) const;
+
+  /**
+   * @brief Whether enough keys were removed that it should be rebuilt.
+   *
+   * @param Count The amount of elements left in the table.
+   * @return Whether to rebuild.
+   */
+  bool needs_rebuild(std::size_t Count) const;
+
+  /**
+   * @brief The memory the filter allocated.
+   *
+   * @return The bytes.
+   */
+  std::size_t bytes() const;
+
+private:
+
+  //! 64 bit words in every block
+  static const std::size_t BLOCK_WORDS = BLOCK_BITS / 64;
+
+  /**
+   * @brief Where the first block starts in words, so it's aligned to a cache
+   * line.
+   *
+   * @return The index of the first word of the first block.
+   */
+  std::size_t get_offset() const;
+
+  /**
+   * @brief Copies the blocks of another filter of the same size.
+   *
+   * @param rhs The filter to copy from.
+   */
+  void copy_blocks(const OABloomFilter& rhs);
+
+  /**
+   * @brief Finds the word and the bit a key uses for one of its hashes.
+   *
+   * @param hash The mixed hash of the key.
+   * @param which Which of its hashes.
+   * @param word Set to the index into words.
+   * @return The bit in the word.
+   */
+  std::uint64_t get_bit(std::uint64_t hash, unsigned which, std::size_t& word)
+    const;
+
+  /**
+   * @brief Mixes the hash of a key, so every bit of it is usable.
+   *
+   * @param FullHash The full width hash of the key.
+   * @return The mixed hash.
+   */
+  static std::uint64_t get_hash(std::uint64_t FullHash);
+
+  unsigned bits_per_key{0};           //!< 0 if the filter is off
+  unsigned hashes{0};                 //!< Bits set per key
+  std::size_t block_count{0};         //!< Amount of blocks
+  std::size_t removed{0};             //!< Removals since the last reset
+  std::vector<std::uint64_t> words{}; //!< The blocks, with room to align
+};
+
+/**
+ * @brief Instrumentation policy that keeps every counter: the probes of each
+ * slot and `Probes_`. This is what the drivers test against.
+ */
+struct OAFullInstrumentation {
+  //! Counters stored in every slot
+  struct SlotCounters {
+    int probes{0}; //!< For testing
+  };
+
+  /**
+   * @brief Counts an access to a slot.
+   *
+   * @param slot The slot accessed.
+   * @param index The index of the slot.
+   * @param stats The table's stats.
+   */
+  template<typename S>
+  static void count_probe(S& slot, std::size_t index, OAHTStats& stats);
+
+  /**
+   * @brief Counts a lookup the prefilter answered as a miss.
+   *
+   * @param stats The table's stats.
+   */
+  static void count_filtered(OAHTStats& stats);
+
+  /**
+   * @brief Resets the counters of a slot.
+   *
+   * @param slot The slot to reset.
+   */
+  template<typename S>
+  static void reset(S& slot);
+};
+
+/**
+ * @brief Instrumentation policy that only counts the probes that land on one
+ * out of every SAMPLE_RATE slots and scales them, so `Probes_` is an estimate
+ * and the slots carry no counters.
+ */
+struct OASampledInstrumentation {
+  //! Only probes to indices that are a multiple of this are counted
+  static const std::size_t SAMPLE_RATE = 64;
+
+  //! Counters stored in every slot
+  struct SlotCounters {};
+
+  /**
+   * @brief Counts an access to a slot, if it's part of the sample.
+   *
+   * @param slot The slot accessed.
+   * @param index The index of the slot.
+   * @param stats The table's stats.
+   */
+  template<typename S>
+  static void count_probe(S& slot, std::size_t index, OAHTStats& stats);
+
+  /**
+   * @brief Counts a lookup the prefilter answered as a miss. Those are rare
+   * enough to count them all.
+   *
+   * @param stats The table's stats.
+   */
+  static void count_filtered(OAHTStats& stats);
+
+  /**
+   * @brief Resets the counters of a slot.
+   *
+   * @param slot The slot to reset.
+   */
+  template<typename S>
+  static void reset(S& slot);
+};
+
+/**
+ * @brief Instrumentation policy that counts nothing. The slots carry no
+ * counters and `find` doesn't write anything, so it can be called from many
+ * threads at once.
+ */
+struct OANoInstrumentation {
+  //! Counters stored in every slot
+  struct SlotCounters {};
+
+  /**
+   * @brief Does nothing.
+   *
+   * @param slot The slot accessed.
+   * @param index The index of the slot.
+   * @param stats The table's stats.
+   */
+  template<typename S>
+  static void count_probe(S& slot, std::size_t index, OAHTStats& stats);
+
+  /**
+   * @brief Does nothing.
+   *
+   * @param stats The table's stats.
+   */
+  static void count_filtered(OAHTStats& stats);
+
+  /**
+   * @brief Does nothing.
+   *
+   * @param slot The slot to reset.
+   */
+  template<typename S>
+  static void reset(S& slot);
 };
 
 /**
  * @brief This is a Hash table for type trivially copiable T. It will function
  * according given to the provided OAConfig instance and keep track of its stats
  * in an OAStats instance. The hash table will own all the data that it
- * contains.
+ * contains. What gets counted is decided at compile time by the
+ * Instrumentation policy (OAFullInstrumentation, OASampledInstrumentation or
+ * OANoInstrumentation).
  */
-template<typename T>
+template<typename T, typename Instrumentation = OAFullInstrumentation>
 class OAHashTable {
 public:
 
@@ -101,28 +439,59 @@ public:
   struct OAHTConfig {
     //! Non-default constructor
     OAHTConfig(
-      unsigned InitialTableSize,
+      std::size_t InitialTableSize,
       HASHFUNC PrimaryHashFunc,
       HASHFUNC SecondaryHashFunc = 0,
       double MaxLoadFactor = 0.5,
       double GrowthFactor = 2.0,
       OAHTDeletionPolicy Policy = PACK,
-      FREEPROC FreeProc = 0
+      FREEPROC FreeProc = 0,
+      unsigned BloomBitsPerKey = 0,
+      std::size_t Capacity = 0,
+      bool FullWidthHash = false,
+      OAHTNumaPolicy NumaPolicy = NUMA_DEFAULT,
+      unsigned NumaNode = 0,
+      std::size_t BucketSlots = 0
     );
 
-    unsigned InitialTableSize_;         //!< The starting table size
+    std::size_t InitialTableSize_;      //!< The starting table size
     HASHFUNC PrimaryHashFunc_;          //!< First hash function
     HASHFUNC SecondaryHashFunc_;        //!< Hash function to resolve collisions
     double MaxLoadFactor_;              //!< Maximum LF before growing
     double GrowthFactor_;               //!< The amount to grow the table
     OAHTDeletionPolicy DeletionPolicy_; //!< MARK or PACK
     FREEPROC FreeProc_;                 //!< Client-provided free function
+    unsigned BloomBitsPerKey_;          //!< Prefilter bits per key, 0 for none
+    std::size_t Capacity_;              //!< Cache capacity, 0 to grow instead
+
+    /**
+     * @brief Place keys by their GetFullHash instead of the hash functions:
+     * the home is the hash modulo the table size and, with a secondary hash
+     * function, the stride comes from its high bits (the function itself
+     * isn't called). OAHashedKey lookups then never hash. A HASHFUNC can
+     * only address 32 bit sizes, so tables with more slots always do this.
+     */
+    bool FullWidthHash_;
+
+    OAHTNumaPolicy NumaPolicy_;         //!< Placement of the slot array
+    unsigned NumaNode_;                 //!< The node for NUMA_NODE
+
+    /**
+     * @brief Slots per bucket, 0 or 1 for none. The slots are split in
+     * buckets of consecutive slots and a probe step scans a whole bucket
+     * (from the home slot's lane, wrapping around) before the stride takes
+     * it to another one, so a step reads adjacent cache lines instead of a
+     * new random one for every slot. The secondary hash function picks the
+     * stride in buckets, and the table size is rounded to a prime amount of
+     * buckets. Removals always MARK, PACK can't close the gaps.
+     */
+    std::size_t BucketSlots_;
   };
 
   /**
    * @brief Slots that will hold the key/data pairs.
    */
-  struct OAHTSlot {
+  struct OAHTSlot : Instrumentation::SlotCounters {
     /**
      * @brief The 3 possible states the slot can be in:
      * - `OCCUPIED` means that this slot is currently filled with data.
@@ -139,7 +508,78 @@ public:
     char Key[MAX_KEYLEN]{'\0'};       //!< Key is a string
     T Data{};                         //!< Client data
     OAHTSlot_State State{UNOCCUPIED}; //!< The state of the slot
-    int probes{0};                    //!< For testing
+  };
+
+  /**
+   * @brief Forward iterator over the occupied slots. Empty and deleted slots
+   * are skipped a whole word of the occupancy bitmap at a time. Inserting,
+   * removing or clearing invalidates it.
+   */
+  class OAHTIterator {
+  public:
+
+    typedef std::forward_iterator_tag iterator_category; //!< Forward only
+    typedef OAHTSlot value_type;                         //!< The slots
+    typedef std::ptrdiff_t difference_type;              //!< Distances
+    typedef const OAHTSlot* pointer;                     //!< Read-only
+    typedef const OAHTSlot& reference;                   //!< Read-only
+
+    /**
+     * @brief Points at a slot, which must be occupied or the end.
+     *
+     * @param table The table iterated.
+     * @param index The index of the slot (TableSize_ for the end).
+     */
+    OAHTIterator(const OAHashTable* table, std::size_t index);
+
+    /**
+     * @brief The slot pointed at.
+     *
+     * @return The slot.
+     */
+    reference operator*() const;
+
+    /**
+     * @brief The slot pointed at.
+     *
+     * @return The slot.
+     */
+    pointer operator->() const;
+
+    /**
+     * @brief Moves to the next occupied slot.
+     *
+     * @return This iterator.
+     */
+    OAHTIterator& operator++();
+
+    /**
+     * @brief Moves to the next occupied slot.
+     *
+     * @return The iterator before moving.
+     */
+    OAHTIterator operator++(int);
+
+    /**
+     * @brief Whether both point at the same slot.
+     *
+     * @param rhs The other iterator.
+     * @return Whether they're equal.
+     */
+    bool operator==(const OAHTIterator& rhs) const;
+
+    /**
+     * @brief Whether they point at different slots.
+     *
+     * @param rhs The other iterator.
+     * @return Whether they're different.
+     */
+    bool operator!=(const OAHTIterator& rhs) const;
+
+  private:
+
+    const OAHashTable* table; //!< The table iterated
+    std::size_t index;        //!< The slot pointed at
   };
 
   /**
@@ -187,13 +627,60 @@ public:
 
   /**
    * @brief Insert a key/data pair into table. Throws an exception if the
-   * insertion is unsuccessful.
+   * insertion is unsuccessful. In cache mode (a Capacity_ in the config) a
+   * full table evicts an element with CLOCK instead of growing: the hand
+   * sweeps the occupied slots clearing their reference bits and evicts the
+   * first one that has it clear. Evictions call FreeProc_ and are counted in
+   * `Evictions_`.
    *
    * @param Key The key to try insert in the table.
    * @param Data The data to insert into the table.
    */
   void insert(const char* Key, const T& Data);
 
+  /**
+   * @brief Inserts a key/data pair that expires after some time. From then on
+   * find and remove treat it as absent. It's reclaimed (calling FreeProc_ and
+   * counting in `Expirations_`) when remove or insert walk past it, or when
+   * the timing wheel gets to it. The wheel is swept a bit on every insert
+   * and remove and by expire(). Until it's reclaimed it's still in `Count_`,
+   * but for_each and the iterators skip it.
+   *
+   * @param Key The key to try insert in the table.
+   * @param Data The data to insert into the table.
+   * @param Ttl How long the pair lives.
+   */
+  void insert(const char* Key, const T& Data, std::chrono::nanoseconds Ttl);
+
+  /**
+   * @brief insert with a key that was hashed already.
+   *
+   * @param Key The key to try insert in the table.
+   * @param Data The data to insert into the table.
+   */
+  void insert(const OAHashedKey& Key, const T& Data);
+
+  /**
+   * @brief insert with a TTL and a key that was hashed already.
+   *
+   * @param Key The key to try insert in the table.
+   * @param Data The data to insert into the table.
+   * @param Ttl How long the pair lives.
+   */
+  void insert(
+    const OAHashedKey& Key,
+    const T& Data,
+    std::chrono::nanoseconds Ttl
+  );
+
+  /**
+   * @brief Reclaims every expired element the timing wheel has reached, only
+   * visiting the buckets of the time that went by since the last sweep.
+   *
+   * @return The amount of elements reclaimed.
+   */
+  std::size_t expire();
+
   /**
    * @brief Delete an item by key. Throws an exception if the key doesn't exist.
    * Compacts the table by moving key/data pairs, if the deletion policy is
@@ -203,27 +690,63 @@ public:
    */
   void remove(const char* Key);
 
+  /**
+   * @brief remove with a key that was hashed already.
+   *
+   * @param Key The key to erase if it's present.
+   */
+  void remove(const OAHashedKey& Key);
+
   /**
    * @brief Find and return data by key. Throws an exception (E_ITEM_NOT_FOUND)
-   * if not found.
+   * if not found. In cache mode it sets the reference bit of the element, so
+   * it isn't safe to call from many threads at once.
    *
    * @param Key The key to find if it's present.
    * @return The Data at Key
    */
   const T& find(const char* Key) const;
 
+  /**
+   * @brief find with a key that was hashed already.
+   *
+   * @param Key The key to find if it's present.
+   * @return The Data at Key
+   */
+  const T& find(const OAHashedKey& Key) const;
+
   /**
    * @brief Removes all items from the table (Doesn't deallocate table)
    */
   void clear();
 
   /**
-   * @brief Returns the table's statistics (used for testing purposes).
+   * @brief Returns the table's statistics (used for testing purposes), with
+   * the memory_usage() of the table.
    *
    * @return The table's stats.
    */
   OAHTStats GetStats() const;
 
+  /**
+   * @brief Works out how much memory the table uses and what for.
+   *
+   * @return The breakdown.
+   */
+  OAHTMemory memory_usage() const;
+
+  /**
+   * @brief Goes over the whole table measuring how long the searches are and
+   * how the elements cluster. Successful searches and clusters are measured in
+   * a single pass over the slots. Unsuccessful searches are measured for every
+   * home slot with linear probing, with double hashing they're measured along
+   * the probe sequence of every element instead (the stride depends on the
+   * key). No probes are counted.
+   *
+   * @return The analysis.
+   */
+  OAHTAnalysis Analyze() const;
+
   /**
    * @brief Returns the table's first element.
    *
@@ -231,8 +754,271 @@ public:
    */
   const OAHTSlot* GetTable() const;
 
+  /**
+   * @brief The first occupied slot. The iterators skip expired elements, like
+   * find does.
+   *
+   * @return An iterator to it, or end() if the table is empty.
+   */
+  OAHTIterator begin() const;
+
+  /**
+   * @brief Past the last slot.
+   *
+   * @return The end iterator.
+   */
+  OAHTIterator end() const;
+
+  /**
+   * @brief Calls a function with the key and data of every element, in slot
+   * order. Empty and deleted slots are skipped a word of the occupancy bitmap
+   * at a time, and expired elements are skipped too. The function must not
+   * change the table.
+   *
+   * @param fn Called as `fn(const char* Key, const T& Data)`.
+   */
+  template<typename F>
+  void for_each(F fn) const;
+
+  /**
+   * @brief Like for_each, but the slots are split in ranges of
+   * PARALLEL_CHUNK_WORDS words of the occupancy bitmap that a few threads
+   * take in turns. The function is called from many threads at once and must
+   * not change the table. The first exception it throws is rethrown once
+   * every thread is done.
+   *
+   * @param fn Called as `fn(const char* Key, const T& Data)`.
+   * @param Threads The amount of threads (0 for one per core).
+   */
+  template<typename F>
+  void parallel_for_each(F fn, std::size_t Threads = 0) const;
+
+  /**
+   * @brief Maps every element to a value and combines them all. Every range
+   * is combined in slot order and the ranges are then combined in order, so
+   * the result is the same as a serial walk as long as Combine is
+   * associative, whatever the amount of threads.
+   *
+   * @param Identity The value combining doesn't change (the result of an
+   * empty table).
+   * @param Map Called as `Map(const char* Key, const T& Data)`, from many
+   * threads at once.
+   * @param Combine Called as `Combine(R Left, R Right)`.
+   * @param Threads The amount of threads (0 for one per core).
+   * @return Everything combined.
+   */
+  template<typename R, typename M, typename C>
+  R parallel_reduce(R Identity, M Map, C Combine, std::size_t Threads = 0)
+    const;
+
+  /**
+   * @brief Inserts every element of another table (the union of both). The
+   * keys of the smaller table are looked up in the larger one over a few
+   * threads, and the table grows once to fit what's new before inserting it.
+   * If it throws (E_NO_MEMORY) part of Other may be merged already.
+   * Expired elements of either table are left out, the rest keep their TTL.
+   *
+   * @param Other The table to merge, it can be this one.
+   * @param Resolve Called for every key in both as
+   * `T Resolve(const char* Key, const T& Mine, const T& Theirs)`, its result
+   * is kept. With a FreeProc_ Mine is freed if the result isn't Mine (by
+   * `==`), Theirs isn't copied, that's up to Resolve.
+   * @param Threads The amount of threads (0 for one per core).
+   */
+  template<typename I2, typename F>
+  void merge_from(
+    const OAHashTable<T, I2>& Other,
+    F Resolve,
+    std::size_t Threads = 0
+  );
+
+  /**
+   * @brief Removes every element whose key isn't in another table (the
+   * intersection of both). The keys of the smaller table are looked up in the
+   * larger one over a few threads. Expired elements of either table count as
+   * missing.
+   *
+   * @param Other The table to intersect with, it can be this one.
+   * @param Resolve Called for every key in both as
+   * `T Resolve(const char* Key, const T& Mine, const T& Theirs)`, its result
+   * is kept. With a FreeProc_ Mine is freed if the result isn't Mine (by
+   * `==`).
+   * @param Threads The amount of threads (0 for one per core).
+   */
+  template<typename I2, typename F>
+  void intersect_with(
+    const OAHashTable<T, I2>& Other,
+    F Resolve,
+    std::size_t Threads = 0
+  );
+
+  /**
+   * @brief Removes every element whose key is in another table (this minus
+   * Other). The keys of the smaller table are looked up in the larger one
+   * over a few threads. Expired elements of Other don't remove anything.
+   *
+   * @param Other The table with the keys to remove, it can be this one.
+   * @param Threads The amount of threads (0 for one per core).
+   */
+  template<typename I2>
+  void difference(const OAHashTable<T, I2>& Other, std::size_t Threads = 0);
+
+  /**
+   * @brief Inserts every element into another table, like
+   * `Destination.merge_from(*this, Resolve, Threads)`. For merging tables
+   * filled separately (say one per thread) into the one that's kept.
+   *
+   * @param Destination The table that gets the union of both.
+   * @param Resolve Called for every key in both as
+   * `T Resolve(const char* Key, const T& Mine, const T& Theirs)`, where Mine
+   * is the data in Destination. Its result is kept.
+   * @param Threads The amount of threads (0 for one per core).
+   */
+  template<typename I2, typename F>
+  void union_into(
+    OAHashTable<T, I2>& Destination,
+    F Resolve,
+    std::size_t Threads = 0
+  ) const;
+
 private:
 
+  // The set operations work with tables of any instrumentation.
+  template<typename, typename>
+  friend class OAHashTable;
+
+  //! Slots per word of the occupancy bitmap
+  static const std::size_t OCCUPANCY_BITS = 64;
+
+  //! Buckets in the timing wheel
+  static const std::size_t WHEEL_BUCKETS = 256;
+
+  //! Nanoseconds in a tick of the timing wheel
+  static const std::uint64_t WHEEL_TICK = 1000000;
+
+  /**
+   * @brief A slot to check once the wheel gets to some time. If the element
+   * moved the timer is stale, its new slot has its own timer.
+   */
+  struct WheelTimer {
+    std::size_t index{0};    //!< The slot
+    std::uint64_t expiry{0}; //!< When the element there expires
+  };
+
+  /**
+   * @brief Words of the occupancy bitmap each thread of the parallel walks
+   * takes at a time. A multiple of a cache line of words, so no two threads
+   * read the same line of the bitmap.
+   */
+  static const std::size_t PARALLEL_CHUNK_WORDS = 256;
+
+  /**
+   * @brief Calls a function with the key and data of the elements in a range
+   * of words of the occupancy bitmap, except the expired ones.
+   *
+   * @param first The first word.
+   * @param last Past the last word.
+   * @param fn Called as `fn(const char* Key, const T& Data)`.
+   */
+  template<typename F>
+  void for_each_in(std::size_t first, std::size_t last, F& fn) const;
+
+  /**
+   * @brief Runs some work for every chunk of PARALLEL_CHUNK_WORDS words of the
+   * occupancy bitmap over a few threads. The first exception thrown by the
+   * work is rethrown once every thread is done.
+   *
+   * @param work Called as `work(chunk, first word, past the last word)`.
+   * @param Threads The amount of threads (0 for one per core).
+   */
+  template<typename F>
+  void fan_out(F work, std::size_t Threads) const;
+
+  //! Where a key is in this table and in another one
+  struct SlotPair {
+    std::size_t mine{0};   //!< The slot in this table
+    std::size_t theirs{0}; //!< The slot in the other table
+  };
+
+  /**
+   * @brief Finds the keys in both this table and another. The elements of the
+   * smaller one are looked up in the larger one, over a few threads and
+   * without counting probes. Expired elements of the larger one don't count.
+   *
+   * @param Other The other table.
+   * @param Threads The amount of threads (0 for one per core).
+   * @return The slots of every key in both, in the slot order of the smaller
+   * table.
+   */
+  template<typename I2>
+  std::vector<SlotPair> pair_slots(
+    const OAHashTable<T, I2>& Other,
+    std::size_t Threads
+  ) const;
+
+  /**
+   * @brief Looks up every element of one table in another (see pair_slots).
+   *
+   * @param Walked The table whose elements are looked up.
+   * @param Probed The table they are looked up in.
+   * @param Threads The amount of threads (0 for one per core).
+   * @return The slots of every key in both that hasn't expired in either, as
+   * `{walked, probed}`.
+   */
+  template<typename W, typename P>
+  static std::vector<SlotPair> match_slots(
+    const W& Walked,
+    const P& Probed,
+    std::size_t Threads
+  );
+
+  /**
+   * @brief Replaces the data of a slot with what Resolve makes of it and the
+   * data of another table, freeing the old data if it isn't kept.
+   *
+   * @param slot The slot.
+   * @param Theirs The data of the other table.
+   * @param Resolve Called as `T Resolve(const char* Key, const T& Mine,
+   * const T& Theirs)`.
+   */
+  template<typename F>
+  void resolve_slot(OAHTSlot& slot, const T& Theirs, F& Resolve);
+
+  /**
+   * @brief Removes the elements whose bit in a bitmap of the slots has some
+   * value. Their keys are copied first, since erasing may move elements.
+   *
+   * @param marks The bitmap, with a bit per slot.
+   * @param marked Whether the marked or the unmarked elements are removed.
+   */
+  void remove_marked(const std::vector<std::uint64_t>& marks, bool marked);
+
+  /**
+   * @brief The size of a new table. A cache starts with room for its capacity
+   * at the maximum load factor, since it never grows.
+   *
+   * @param Config The configuration of the table.
+   * @return The amount of slots.
+   */
+  static std::size_t get_initial_size(const OAHTConfig& Config);
+
+  /**
+   * @brief Allocates default constructed slots following the NUMA policy.
+   * Throws std::bad_alloc if there is no memory.
+   *
+   * @param size The amount of slots.
+   * @return The slots.
+   */
+  OAHTSlot* allocate_slots(std::size_t size) const;
+
+  /**
+   * @brief Frees slots from allocate_slots, under the same config.
+   *
+   * @param memory The slots, it can be null.
+   * @param size The amount of slots.
+   */
+  void free_slots(OAHTSlot* memory, std::size_t size) const;
+
   /**
    * @brief Initialize the table after an allocation
    *
@@ -243,10 +1029,123 @@ private:
   /**
    * @brief Expands the table when the load factor reaches a certain point
    * (greater than MaxLoadFactor) Grows the table by GrowthFactor,
-   * making sure the new size is prime by calling GetClosestPrime
+   * making sure the new size is prime by calling GetGrownTableSize. A cache
+   * never grows, it rehashes in place once tombstones take half of the slots
+   * without an element. Throws an exception (E_NO_MEMORY) if the new size
+   * can't be allocated.
    */
   void try_grow_table();
 
+  /**
+   * @brief Grows the table once so some amount of elements fit under the
+   * maximum load factor. A cache never grows. Throws an exception
+   * (E_NO_MEMORY) if the new size can't be allocated.
+   *
+   * @param count The amount of elements.
+   */
+  void reserve(std::size_t count);
+
+  /**
+   * @brief Moves every element to a new array of slots. Throws an exception
+   * (E_NO_MEMORY) if it can't be allocated, and then nothing changed.
+   *
+   * @param new_size The amount of slots.
+   */
+  void rehash(std::size_t new_size);
+
+  /**
+   * @brief A key being worked with. The hash is only there when something
+   * uses it (the prefilter or `FullWidthHash_`), it's 0 otherwise.
+   */
+  struct SlotKey {
+    const char* key{nullptr}; //!< The key
+    std::uint64_t hash{0};    //!< GetFullHash of the key, if needed
+  };
+
+  /**
+   * @brief Hashes a key, if anything needs the hash.
+   *
+   * @param Key The key.
+   * @return The key to work with.
+   */
+  SlotKey get_slot_key(const char* Key) const;
+
+  /**
+   * @brief Takes the hash of a key that was hashed already.
+   *
+   * @param Key The hashed key.
+   * @return The key to work with.
+   */
+  static SlotKey get_slot_key(const OAHashedKey& Key);
+
+  /**
+   * @brief Whether keys are placed by their full width hash, which is always
+   * the case past the sizes a HASHFUNC can address.
+   *
+   * @return Whether get_home and get_stride use the hash.
+   */
+  bool use_full_width() const;
+
+  /**
+   * @brief The amount of slots per bucket.
+   *
+   * @return BucketSlots_, or 1 without buckets.
+   */
+  std::size_t get_bucket_slots() const;
+
+  /**
+   * @brief The amount of buckets, which is what the hash functions map to.
+   *
+   * @return The amount of buckets, TableSize_ without buckets.
+   */
+  std::size_t get_bucket_count() const;
+
+  /**
+   * @brief Rounds a table size to a prime amount of buckets.
+   *
+   * @param size The size wanted.
+   * @param bucket_slots The slots per bucket.
+   * @return The size, unchanged without buckets.
+   */
+  static std::size_t get_bucketed_size(
+    std::size_t size,
+    std::size_t bucket_slots
+  );
+
+  /**
+   * @brief The slot a key probes first.
+   *
+   * @param Key The key.
+   * @return Its index.
+   */
+  std::size_t get_home(const SlotKey& Key) const;
+
+  /**
+   * @brief The distance between two consecutive probes for a key: 1 with
+   * linear probing, otherwise the secondary hash mapped to the range of
+   * (1, TableSize - 1). With buckets it's in buckets, between two scans.
+   *
+   * @param Key The key.
+   * @return The stride.
+   */
+  std::size_t get_stride(const SlotKey& Key) const;
+
+  /**
+   * @brief The index of a probe, `index + offset * stride`, without
+   * overflowing on huge tables. With buckets the offset is split in the
+   * strides taken and the slot of the bucket.
+   *
+   * @param index The home of the key.
+   * @param stride The stride of the key.
+   * @param offset The amount of probes taken.
+   * @return The index, get_slot maps it to the table's range.
+   */
+  std::size_t get_probe_index(
+    std::size_t index,
+    std::size_t stride,
+    std::size_t offset
+  ) const;
+
   /**
    * @brief This is the real insert function, it's an abstraction used for
    * internal debugging and testing.
@@ -254,8 +1153,28 @@ private:
    * @param Key The key to insert
    * @param Data The data to insert
    * @param probe Whether to count the accesses to the table as probes
+   * @return The index of the slot the pair went to.
    */
-  void insert_inner(const char* Key, const T& Data, bool probe = true);
+  std::size_t insert_inner(
+    const SlotKey& Key,
+    const T& Data,
+    bool probe = true
+  );
+
+  /**
+   * @brief The real remove function.
+   *
+   * @param Key The key to erase if it's present.
+   */
+  void remove_inner(const SlotKey& Key);
+
+  /**
+   * @brief The real find function.
+   *
+   * @param Key The key to find if it's present.
+   * @return The Data at Key
+   */
+  const T& find_inner(const SlotKey& Key) const;
 
   /**
    * @brief This struct represents a search inside the table. If the S* is null
@@ -263,25 +1182,32 @@ private:
    */
   template<typename S>
   struct SlotSearch {
-    std::size_t index{0};
-    S* slot{nullptr};
+    std::size_t index{0}; //!< Where the slot is in the table
+    std::size_t probe{0}; //!< How many probe steps from the key's home
+    S* slot{nullptr};     //!< The slot found
   };
 
   /**
    * @brief This will try to find a slot in the table.
    *
    * @param Key The key to look for in the table.
+   * @param probe Whether it counts in the stats. If not, nothing is written
+   * and many threads can search at once.
    * @return A SlotSearch instance with the result of the search.
    */
-  const SlotSearch<const OAHTSlot> find_slot(const char* Key) const;
+  const SlotSearch<const OAHTSlot> find_slot(
+    const SlotKey& Key,
+    bool probe = true
+  ) const;
 
   /**
-   * @brief This will try to find a slot in the table.
+   * @brief This will try to find a slot in the table. Expired elements on the
+   * probe path are reclaimed along the way, the key itself too.
    *
    * @param Key The key to look for in the table.
    * @return A SlotSearch instance with the result of the search.
    */
-  const SlotSearch<OAHTSlot> find_slot_mut(const char* Key);
+  const SlotSearch<OAHTSlot> find_slot_mut(const SlotKey& Key);
 
   /**
    * @brief This struct represents a probe inside the table. This is a
@@ -320,27 +1246,19 @@ private:
    */
   const SlotProbe<OAHTSlot> get_slot_mut(std::size_t index, bool probe = true);
 
-  /**
-   * @brief This will use the secondary hash mapping the function parameters to
-   * the required range of (1, TableSize - 1).
-   *
-   * @param Key The key to hash.
-   * @return The output from the secondary hash function.
-   */
-  std::size_t use_secondary_hash(const char* Key) const;
-
   /**
    * @brief This will get the next slot using the proper stride (if required).
    *
    * @param index The index location to offset from.
+   * @param stride The stride of the key (get_stride).
    * @param offset The offset to apply.
    * @param probe Whether this access counts as a probe.
    *
    * @return A SlotProbe instance.
    */
   const SlotProbe<const OAHTSlot> get_next_slot_with_index(
-    const char* Key,
     std::size_t index,
+    std::size_t stride,
     std::size_t offset,
     bool probe = true
   ) const;
@@ -349,14 +1267,15 @@ private:
    * @brief This will get the next slot using the proper stride (if required).
    *
    * @param index The index location to offset from.
+   * @param stride The stride of the key (get_stride).
    * @param offset The offset to apply.
    * @param probe Whether this access counts as a probe.
    *
    * @return A SlotProbe instance.
    */
   const SlotProbe<OAHTSlot> get_next_slot_mut_with_index(
-    const char* Key,
     std::size_t index,
+    std::size_t stride,
     std::size_t offset,
     bool probe = true
   );
@@ -365,14 +1284,15 @@ private:
    * @brief This will get the next slot using the proper stride (if required).
    *
    * @param index The index location to offset from.
+   * @param stride The stride of the key (get_stride).
    * @param offset The offset to apply.
    * @param probe Whether this access counts as a probe.
    *
    * @return The next slot found with the given offset.
    */
   const OAHTSlot& get_next_slot(
-    const char* Key,
     std::size_t index,
+    std::size_t stride,
     std::size_t offset,
     bool probe = true
   ) const;
@@ -381,18 +1301,40 @@ private:
    * @brief This will get the next slot using the proper stride (if required).
    *
    * @param index The index location to offset from.
+   * @param stride The stride of the key (get_stride).
    * @param offset The offset to apply.
    * @param probe Whether this access counts as a probe.
    *
    * @return The next slot found with the given offset.
    */
   OAHTSlot& get_next_slot_mut(
-    const char* Key,
     std::size_t index,
+    std::size_t stride,
     std::size_t offset,
     bool probe = true
   );
 
+  /**
+   * @brief Finds how many probe steps away from its home a key is, without
+   * counting any probes.
+   *
+   * @param Key The key.
+   * @param index The index where the key is stored.
+   * @return The amount of probe steps from the key's home to index.
+   */
+  std::size_t get_displacement(const SlotKey& Key, std::size_t index) const;
+
+  /**
+   * @brief Counts a value in a histogram, growing it if needed.
+   *
+   * @param histogram The histogram.
+   * @param value The value to count.
+   */
+  static void add_to_histogram(
+    std::vector<std::size_t>& histogram,
+    std::size_t value
+  );
+
   /**
    * @brief To adjust the table with the deletion policy `MARK`.
    *
@@ -407,6 +1349,96 @@ private:
    */
   void adjust_pack(std::size_t index);
 
+  /**
+   * @brief Removes the element in a slot, adjusting the table with the deletion
+   * policy.
+   *
+   * @param index The slot of the element.
+   * @param displacement How many probe steps from its home the element is.
+   */
+  void erase(std::size_t index, std::size_t displacement);
+
+  /**
+   * @brief Evicts the element the CLOCK hand lands on.
+   */
+  void evict();
+
+  /**
+   * @brief Inserts a key/data pair with an expiry time, after reclaiming the
+   * key if it expired and sweeping the wheel.
+   *
+   * @param Key The key to insert.
+   * @param Data The data to insert.
+   * @param expiry When it expires (0 for never).
+   */
+  void insert_expiring(
+    const SlotKey& Key,
+    const T& Data,
+    std::uint64_t expiry
+  );
+
+  /**
+   * @brief When an element inserted now with a TTL expires. Turns the
+   * expiries on the first time.
+   *
+   * @param Ttl How long the element lives.
+   * @return Its expiry time.
+   */
+  std::uint64_t get_expiry(std::chrono::nanoseconds Ttl);
+
+  /**
+   * @brief Sets when the element in a slot expires and schedules it on the
+   * wheel. Nothing happens until an element with a TTL was inserted.
+   *
+   * @param index The slot.
+   * @param expiry When it expires (0 for never).
+   */
+  void set_expiry(std::size_t index, std::uint64_t expiry);
+
+  /**
+   * @brief Whether the element in a slot has expired.
+   *
+   * @param index The slot.
+   * @return Whether it expired.
+   */
+  bool is_expired(std::size_t index) const;
+
+  /**
+   * @brief Whether the element in a slot had expired at some time, to check
+   * many slots against one reading of the clock.
+   *
+   * @param index The slot.
+   * @param now The time, in nanoseconds of the steady clock.
+   * @return Whether it expired.
+   */
+  bool is_expired(std::size_t index, std::uint64_t now) const;
+
+  /**
+   * @brief The time the expiries are measured in.
+   *
+   * @return Nanoseconds of the steady clock.
+   */
+  static std::uint64_t get_time();
+
+  /**
+   * @brief Sets the reference bit of a slot, in cache mode.
+   *
+   * @param index The slot.
+   */
+  void touch(std::size_t index) const;
+
+  /**
+   * @brief Reads the bit of a slot in a bitmap like occupancy.
+   *
+   * @param bits The bitmap (may be empty).
+   * @param index The slot.
+   * @return Whether the bit is set.
+   */
+  static bool test_bit(
+    const std::vector<std::uint64_t>& bits,
+    std::size_t index
+  );
+
   /**
    * @brief Call the deletion function for the data in the slot and set the slot
    * to the right state.
@@ -415,6 +1447,37 @@ private:
    */
   void delete_slot(OAHTSlot& slot);
 
+  /**
+   * @brief Empties the prefilter and adds every element again, sized for the
+   * current table.
+   */
+  void rebuild_bloom();
+
+  /**
+   * @brief Updates the bit of a slot in the occupancy bitmap.
+   *
+   * @param slot The slot, which must be in the table.
+   * @param occupied Whether the slot is now occupied.
+   */
+  void set_occupied(const OAHTSlot& slot, bool occupied);
+
+  /**
+   * @brief Finds the first occupied slot at or after an index whose element
+   * hasn't expired.
+   *
+   * @param index Where to start looking.
+   * @return The index of the slot, or TableSize_ if there is none.
+   */
+  std::size_t find_occupied(std::size_t index) const;
+
+  /**
+   * @brief The position of the lowest set bit of a word.
+   *
+   * @param word The word, it can't be 0.
+   * @return The amount of trailing zeros.
+   */
+  static std::size_t get_lowest_bit(std::uint64_t word);
+
   /**
    * @brief The table's configuration
    */
@@ -425,6 +1488,30 @@ private:
    */
   OAHTSlot* slots{nullptr};
 
+  /**
+   * @brief Prefilter that answers most lookups of missing keys before the
+   * slots are touched. Sized for the elements the table can hold before
+   * growing.
+   */
+  OABloomFilter bloom{};
+
+  /**
+   * @brief One bit per slot, set if the slot is OCCUPIED. This is what the
+   * iterators scan.
+   */
+  std::vector<std::uint64_t> occupancy{};
+
+  /**
+   * @brief The CLOCK reference bits, one per slot like occupancy. Only used
+   * in cache mode, empty otherwise.
+   */
+  mutable std::vector<std::uint64_t> referenced{};
+
+  /**
+   * @brief The slot the CLOCK hand points at.
+   */
+  std::size_t clock_hand{0};
+
   /**
    * @brief The first hash function to use, it should map to the range
    * (0,TableSize - 1)
@@ -442,6 +1529,23 @@ private:
    */
   FREEPROC delete_function{nullptr};
 
+  /**
+   * @brief When each slot expires, in nanoseconds of the steady clock (0 if
+   * never). Empty until the first insertion with a TTL.
+   */
+  std::vector<std::uint64_t> expiries{};
+
+  /**
+   * @brief The buckets of the timing wheel, each one the timers of the ticks
+   * that map to it.
+   */
+  std::vector<std::vector<WheelTimer>> wheel{};
+
+  /**
+   * @brief The first tick the wheel hasn't swept past.
+   */
+  std::uint64_t wheel_tick{0};
+
   /**
    * @brief The table's stats.
    */
@@ -0,0 +1,592 @@
+/**
+ * @file OALockFreeHashTable.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Implementation of the lock-free table
+ */
+
+#pragma once
+
+#include <algorithm>
+
+#include "Support.h"
+
+#define OALOCKFREEHASHTABLE_CPP
+
+#ifndef OALOCKFREEHASHTABLEH
+  #include "OALockFreeHashTable.h"
+#endif
+
+template<typename T>
+OALockFreeHashTable<T>::OALockFreeHashTable(const OALFConfig& Config):
+    config(Config), items() {
+  current.store(new SlotArray(config.InitialTableSize_));
+}
+
+template<typename T>
+OALockFreeHashTable<T>::~OALockFreeHashTable() {
+  SlotArray* array = current.load();
+
+  while (array != nullptr) {
+    SlotArray* next = array->next.load();
+    delete array;
+    array = next;
+  }
+
+  reclaim();
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::insert(KEY Key, T Data) -> void {
+  const std::uint64_t value = encode(Data);
+
+  update(Key, true, [value](std::uint64_t old) {
+    if (is_live(old)) {
+      throw OAHashTableException(
+        OAHashTableException::E_DUPLICATE,
+        "There is a duplicate item in the list."
+      );
+    }
+
+    return value;
+  });
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::assign(KEY Key, T Data) -> void {
+  const std::uint64_t value = encode(Data);
+
+  update(Key, true, [value](std::uint64_t) { return value; });
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::add(KEY Key, T Delta) -> T {
+  T result{};
+
+  update(Key, true, [Delta, &result](std::uint64_t old) {
+    T start = is_live(old) ? decode(old) : T();
+    result = static_cast<T>(start + Delta);
+    return encode(result);
+  });
+
+  return result;
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::remove(KEY Key) -> void {
+  update(Key, false, [](std::uint64_t old) {
+    if (!is_live(old)) {
+      throw OAHashTableException(
+        OAHashTableException::E_ITEM_NOT_FOUND,
+        "Key not in table."
+      );
+    }
+
+    return TOMBSTONE;
+  });
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::find(KEY Key) const -> T {
+  std::uint64_t value = TOMBSTONE;
+
+  if (Key != 0 && Key != MOVED_KEY) {
+    lookup(*current.load(), Key, hash(Key), value);
+  }
+
+  if (!is_live(value)) {
+    throw OAHashTableException(
+      OAHashTableException::E_ITEM_NOT_FOUND,
+      "Item not found in table."
+    );
+  }
+
+  return decode(value);
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::GetStats() const -> OAHTStats {
+  std::int64_t count = 0;
+
+  for (const Stripe& stripe : items) {
+    count += stripe.value.load(std::memory_order_relaxed);
+  }
+
+  OAHTStats stats;
+  stats.Count_ = static_cast<std::size_t>(std::max<std::int64_t>(count, 0));
+  stats.TableSize_ = current.load()->size;
+  stats.Expansions_ = expansions.load();
+  return stats;
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::reclaim() -> void {
+  SlotArray* array = retired.exchange(nullptr);
+
+  while (array != nullptr) {
+    SlotArray* next = array->retired_next;
+    delete array;
+    array = next;
+  }
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::hash(KEY Key) -> std::uint64_t {
+  // splitmix64 finalizer
+  Key ^= Key >> 30;
+  Key *= 0xbf58476d1ce4e5b9ULL;
+  Key ^= Key >> 27;
+  Key *= 0x94d049bb133111ebULL;
+  Key ^= Key >> 31;
+  return Key;
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::encode(T Data) -> std::uint64_t {
+  typedef typename std::make_unsigned<T>::type U;
+  std::uint64_t value = static_cast<std::uint64_t>(static_cast<U>(Data));
+
+  if (value >= EMPTY_VALUE) {
+    throw OAHashTableException(
+      OAHashTableException::E_RESERVED,
+      "The data is reserved by the table."
+    );
+  }
+
+  return value;
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::decode(std::uint64_t Value) -> T {
+  typedef typename std::make_unsigned<T>::type U;
+  return static_cast<T>(static_cast<U>(Value));
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::is_live(std::uint64_t Value) -> bool {
+  return Value != TOMBSTONE && Value != EMPTY_VALUE;
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::probe(
+  SlotArray& array,
+  KEY Key,
+  std::uint64_t Hash,
+  bool claim
+) const -> SlotSearch {
+  const std::size_t size = array.size;
+  std::size_t index = Hash % size;
+  std::size_t stride = 1;
+
+  if (config.DoubleHashing_ && size > 1) {
+    stride = (Hash >> 32) % (size - 1) + 1;
+  }
+
+  for (std::size_t i = 0; i < size; i++) {
+    OALFSlot& slot = array.slots[index];
+    KEY key = slot.Key.load(std::memory_order_acquire);
+
+    if (key == 0 && claim && slot.Key.compare_exchange_strong(key, Key)) {
+      SlotSearch search;
+      search.slot = &slot;
+      search.claimed = true;
+      return search;
+    }
+
+    if (key == Key) {
+      SlotSearch search;
+      search.slot = &slot;
+      return search;
+    }
+
+    if (key == MOVED_KEY) {
+      SlotSearch search;
+      search.moved = true;
+      return search;
+    }
+
+    if (key == 0) {
+      SlotSearch search;
+      search.empty = &slot;
+      return search;
+    }
+
+    index = (index + stride) % size;
+  }
+
+  return SlotSearch();
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::lookup(
+  SlotArray& array,
+  KEY Key,
+  std::uint64_t Hash,
+  std::uint64_t& Value
+) const -> bool {
+  SlotSearch search = probe(array, Key, Hash, false);
+
+  // The next array is only read once the probe says it's needed, since growth
+  // may start at any point of the probe. A full array may have had to send
+  // the key further during a migration.
+  if (search.moved || (search.slot == nullptr && search.empty == nullptr)) {
+    SlotArray* next = array.next.load(std::memory_order_acquire);
+    return next != nullptr && lookup(*next, Key, Hash, Value);
+  }
+
+  if (search.slot == nullptr) {
+    return false;
+  }
+
+  std::uint64_t value = search.slot->Data.load(std::memory_order_acquire);
+
+  // A frozen slot may have newer data in the next array. If the key isn't
+  // there yet, the frozen data is still the latest.
+  if (value & MOVED_BIT) {
+    SlotArray* next = array.next.load(std::memory_order_acquire);
+
+    if (next != nullptr && lookup(*next, Key, Hash, Value)) {
+      return true;
+    }
+
+    value &= ~MOVED_BIT;
+  }
+
+  if (value == EMPTY_VALUE) {
+    return false;
+  }
+
+  Value = value;
+  return true;
+}
+
+template<typename T>
+template<typename F>
+auto OALockFreeHashTable<T>::update(KEY Key, bool claim, F update)
+  -> std::uint64_t {
+  if (Key == 0 || Key == MOVED_KEY) {
+    throw OAHashTableException(
+      OAHashTableException::E_RESERVED,
+      "The key is reserved by the table."
+    );
+  }
+
+  const std::uint64_t hashed = hash(Key);
+  SlotArray* array = current.load();
+
+  for (;;) {
+    // Once the array is growing all the work happens in the next one.
+    if (array->next.load(std::memory_order_acquire) != nullptr) {
+      array = advance(*array, Key, hashed);
+      continue;
+    }
+
+    SlotSearch search = probe(*array, Key, hashed, claim);
+
+    if (search.claimed) {
+      note_claim(*array, hashed);
+    }
+
+    if (search.moved) {
+      array = advance(*array, Key, hashed);
+      continue;
+    }
+
+    if (search.slot == nullptr) {
+      // A full array may have sent the key to the next one.
+      if (array->next.load(std::memory_order_acquire) != nullptr) {
+        array = advance(*array, Key, hashed);
+        continue;
+      }
+
+      if (!claim) {
+        throw OAHashTableException(
+          OAHashTableException::E_ITEM_NOT_FOUND,
+          "Key not in table."
+        );
+      }
+
+      array = make_room(*array, Key, hashed);
+      continue;
+    }
+
+    std::uint64_t old = search.slot->Data.load(std::memory_order_acquire);
+
+    while (!(old & MOVED_BIT)) {
+      std::uint64_t value = update(old);
+
+      if (search.slot->Data.compare_exchange_weak(old, value)) {
+        Stripe& stripe = items[hashed % COUNTER_STRIPES];
+
+        if (!is_live(old) && is_live(value)) {
+          stripe.value.fetch_add(1, std::memory_order_relaxed);
+        } else if (is_live(old) && !is_live(value)) {
+          stripe.value.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        return old;
+      }
+    }
+
+    array = advance(*array, Key, hashed);
+  }
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::advance(
+  SlotArray& array,
+  KEY Key,
+  std::uint64_t Hash
+) -> SlotArray* {
+  // The key has to be in the next array before anyone works on it there, or
+  // its probe sequence has to be frozen so it can't show up here anymore.
+  for (;;) {
+    SlotSearch search = probe(array, Key, Hash, false);
+
+    if (search.slot != nullptr) {
+      migrate_slot(array, *search.slot);
+      break;
+    }
+
+    if (search.moved || search.empty == nullptr) {
+      break;
+    }
+
+    migrate_slot(array, *search.empty);
+  }
+
+  help_migrate(array);
+  return array.next.load();
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::make_room(
+  SlotArray& array,
+  KEY Key,
+  std::uint64_t Hash
+) -> SlotArray* {
+  start_growth(array);
+
+  // Only the current array can grow, any other one is being migrated into and
+  // the current one has to be finished first.
+  if (array.next.load() == nullptr) {
+    return current.load();
+  }
+
+  return advance(array, Key, Hash);
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::note_claim(SlotArray& array, std::uint64_t Hash)
+  -> void {
+  Stripe& stripe = array.keys[Hash % COUNTER_STRIPES];
+  std::int64_t claimed = stripe.value.fetch_add(1, std::memory_order_relaxed);
+
+  // Adding up the stripes is only worth it every so often on big arrays.
+  if (array.size > 1024 && (claimed & 7) != 0) {
+    return;
+  }
+
+  std::int64_t total = 0;
+
+  for (const Stripe& keys : array.keys) {
+    total += keys.value.load(std::memory_order_relaxed);
+  }
+
+  if (static_cast<double>(total) > array.size * config.MaxLoadFactor_) {
+    start_growth(array);
+  }
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::start_growth(SlotArray& array) -> void {
+  if (current.load() != &array || array.next.load() != nullptr) {
+    return;
+  }
+
+  std::int64_t count = 0;
+
+  for (const Stripe& stripe : items) {
+    count += stripe.value.load(std::memory_order_relaxed);
+  }
+
+  // Mostly tombstones, rebuilding at the same size is enough to clean them up.
+  unsigned size = GetClosestPrime(array.size);
+
+  if (static_cast<double>(count) * 2 > array.size * config.MaxLoadFactor_) {
+    size = GetGrownTableSize(array.size, config.GrowthFactor_);
+  }
+
+  attach_next(array, size);
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::attach_next(SlotArray& array, unsigned size)
+  -> SlotArray* {
+  SlotArray* next = array.next.load();
+
+  if (next != nullptr) {
+    return next;
+  }
+
+  SlotArray* bigger = new SlotArray(size);
+
+  if (!array.next.compare_exchange_strong(next, bigger)) {
+    delete bigger;
+    return next;
+  }
+
+  expansions.fetch_add(1);
+  return bigger;
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::help_migrate(SlotArray& array) -> void {
+  const std::size_t start = array.claimed.fetch_add(MIGRATION_CHUNK);
+
+  if (start >= array.size) {
+    return;
+  }
+
+  const std::size_t end = std::min<std::size_t>(
+    start + MIGRATION_CHUNK,
+    array.size
+  );
+
+  for (std::size_t i = start; i < end; i++) {
+    migrate_slot(array, array.slots[i]);
+  }
+
+  const std::size_t done = end - start;
+
+  if (array.copied.fetch_add(done) + done != array.size) {
+    return;
+  }
+
+  // An array that filled up while being migrated into may finish before the
+  // one migrating into it. The current array only moves past finished ones,
+  // and whoever moves it retires the one it moved past.
+  SlotArray* head = current.load();
+
+  while (head->copied.load() == head->size) {
+    SlotArray* next = head->next.load();
+
+    if (current.compare_exchange_strong(head, next)) {
+      head->retired_next = retired.load();
+      while (!retired.compare_exchange_weak(head->retired_next, head)) {}
+
+      head = next;
+    }
+  }
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::migrate_slot(SlotArray& array, OALFSlot& slot)
+  -> void {
+  KEY key = slot.Key.load();
+
+  if (key == 0 && slot.Key.compare_exchange_strong(key, MOVED_KEY)) {
+    return;
+  }
+
+  if (key == MOVED_KEY) {
+    return;
+  }
+
+  std::uint64_t value = slot.Data.load();
+
+  while (!(value & MOVED_BIT)) {
+    if (slot.Data.compare_exchange_weak(value, value | MOVED_BIT)) {
+      break;
+    }
+  }
+
+  value &= ~MOVED_BIT;
+
+  if (is_live(value)) {
+    copy_into(*array.next.load(), key, value);
+  }
+}
+
+template<typename T>
+auto OALockFreeHashTable<T>::copy_into(
+  SlotArray& array,
+  KEY Key,
+  std::uint64_t Value
+) -> void {
+  const std::uint64_t hashed = hash(Key);
+  SlotArray* target = &array;
+
+  for (;;) {
+    SlotSearch search = probe(*target, Key, hashed, true);
+
+    if (search.claimed) {
+      target->keys[hashed % COUNTER_STRIPES].value.fetch_add(1);
+    }
+
+    if (search.moved) {
+      target = target->next.load();
+      continue;
+    }
+
+    // The array filled up while it was being migrated into. Throwing would
+    // leave the slot frozen and never copied, so it goes to a bigger array.
+    if (search.slot == nullptr) {
+      target = attach_next(
+        *target,
+        static_cast<unsigned>(
+          GetGrownTableSize(target->size, config.GrowthFactor_)
+        )
+      );
+      continue;
+    }
+
+    std::uint64_t expected = EMPTY_VALUE;
+
+    if (search.slot->Data.compare_exchange_strong(expected, Value)) {
+      return;
+    }
+
+    // Frozen before anything was written, the copy goes one array further.
+    if (expected == (EMPTY_VALUE | MOVED_BIT)) {
+      target = target->next.load();
+      continue;
+    }
+
+    // Somebody already wrote newer data for the key.
+    return;
+  }
+}
+
+// Slot array stuff
+
+template<typename T>
+OALockFreeHashTable<T>::SlotArray::SlotArray(unsigned Size):
+    size(Size),
+    slots(new OALFSlot[Size]),
+    next(nullptr),
+    claimed(0),
+    copied(0),
+    keys(),
+    retired_next(nullptr) {}
+
+template<typename T>
+OALockFreeHashTable<T>::SlotArray::~SlotArray() {
+  delete[] slots;
+}
+
+// Config stuff
+
+template<typename T>
+OALockFreeHashTable<T>::OALFConfig::OALFConfig(
+  unsigned InitialTableSize,
+  double MaxLoadFactor,
+  double GrowthFactor,
+  bool DoubleHashing
+):
+    InitialTableSize_(InitialTableSize),
+    MaxLoadFactor_(MaxLoadFactor),
+    GrowthFactor_(GrowthFactor),
+    DoubleHashing_(DoubleHashing) {}
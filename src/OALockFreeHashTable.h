@@ -0,0 +1,399 @@
+/**
+ * @file OALockFreeHashTable.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Lock-free open addressing table for integer keys and values.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "OAHashTable.h"
+
+#ifndef OALOCKFREEHASHTABLEH
+  #define OALOCKFREEHASHTABLEH
+//---------------------------------------------------------------------------
+
+/**
+ * @brief An open addressing table where every operation is lock-free, meant
+ * for many threads hammering on integer keyed counters.
+ *
+ * - Keys are claimed with a CAS and never change afterwards, so a slot is
+ * `UNOCCUPIED` until its key is set and from there on its state is carried by
+ * the value word (`OCCUPIED`, or `DELETED` for a tombstone).
+ * - Values are updated with CAS loops, so `add` can be used as an atomic
+ * counter.
+ * - Growth is cooperative: the thread that notices the table is too full
+ * attaches a bigger array, and every thread that runs into a frozen slot
+ * helps migrating a chunk of the old array before moving on.
+ *
+ * Sizes, growth and probing (linear or double hashing) follow OAHashTable.
+ * The key 0 and the key ~0 are reserved, and so are data values whose top
+ * bit is set or that are one of the two largest values below it (only
+ * possible for 64 bit T). Using them throws E_RESERVED.
+ */
+template<typename T>
+class OALockFreeHashTable {
+  static_assert(
+    std::is_integral<T>::value && !std::is_same<T, bool>::value
+      && sizeof(T) <= sizeof(std::uint64_t),
+    "The data must fit in a machine word."
+  );
+
+public:
+
+  //! The type of the keys
+  typedef std::uint64_t KEY;
+
+  //! Configuration for the hash table
+  struct OALFConfig {
+    //! Non-default constructor
+    OALFConfig(
+      unsigned InitialTableSize,
+      double MaxLoadFactor = 0.5,
+      double GrowthFactor = 2.0,
+      bool DoubleHashing = false
+    );
+
+    unsigned InitialTableSize_; //!< The starting table size
+    double MaxLoadFactor_;      //!< Maximum LF (including tombstones)
+    double GrowthFactor_;       //!< The amount to grow the table
+    bool DoubleHashing_;        //!< Double hashing instead of linear probing
+  };
+
+  /**
+   * @brief Constructor for a Hash Table of type T
+   *
+   * @param Config The config that describes the table's behavior
+   */
+  OALockFreeHashTable(const OALFConfig& Config);
+
+  OALockFreeHashTable(const OALockFreeHashTable&) = delete;
+  OALockFreeHashTable& operator=(const OALockFreeHashTable&) = delete;
+
+  /**
+   * @brief Destructor for the table. No other thread may be using it.
+   */
+  ~OALockFreeHashTable();
+
+  /**
+   * @brief Insert a key/data pair into table. Throws an exception
+   * (E_DUPLICATE) if the key is already present.
+   *
+   * @param Key The key to try insert in the table.
+   * @param Data The data to insert into the table.
+   */
+  void insert(KEY Key, T Data);
+
+  /**
+   * @brief Insert a key/data pair or overwrite the data if the key is already
+   * present.
+   *
+   * @param Key The key to set.
+   * @param Data The data to store.
+   */
+  void assign(KEY Key, T Data);
+
+  /**
+   * @brief Atomically adds to the data at Key. Missing keys start at 0.
+   *
+   * @param Key The key to add to.
+   * @param Delta The amount to add.
+   * @return The data after the addition.
+   */
+  T add(KEY Key, T Delta);
+
+  /**
+   * @brief Delete an item by key. Throws an exception (E_ITEM_NOT_FOUND) if
+   * the key doesn't exist. Leaves a tombstone behind.
+   *
+   * @param Key The key to erase if it's present.
+   */
+  void remove(KEY Key);
+
+  /**
+   * @brief Find and return data by key. Throws an exception (E_ITEM_NOT_FOUND)
+   * if not found. It doesn't write to the table at all.
+   *
+   * @param Key The key to find if it's present.
+   * @return The Data at Key
+   */
+  T find(KEY Key) const;
+
+  /**
+   * @brief Returns the table's statistics. Probes are not counted since that
+   * would mean every thread writing to the same counter.
+   *
+   * @return The table's stats.
+   */
+  OAHTStats GetStats() const;
+
+  /**
+   * @brief Frees the arrays left behind by growth. Threads that were in the
+   * middle of an operation may still be looking at them, so this must only be
+   * called when no other thread is using the table.
+   */
+  void reclaim();
+
+private:
+
+  //! Key of a slot nobody claimed before it was frozen
+  static const KEY MOVED_KEY = ~KEY(0);
+
+  //! Set on the value once the slot has been frozen for migration
+  static const std::uint64_t MOVED_BIT = std::uint64_t(1) << 63;
+
+  //! Value of a deleted slot
+  static const std::uint64_t TOMBSTONE = MOVED_BIT - 1;
+
+  //! Value of a claimed slot whose data isn't written yet
+  static const std::uint64_t EMPTY_VALUE = MOVED_BIT - 2;
+
+  //! Amount of slots a thread migrates at a time
+  static const std::size_t MIGRATION_CHUNK = 1024;
+
+  //! Amount of counters the claim and item counts are spread over
+  static const std::size_t COUNTER_STRIPES = 16;
+
+  /**
+   * @brief A counter on its own cache line.
+   */
+  struct Stripe {
+    std::atomic<std::int64_t> value{0}; //!< The count
+    char padding[64 - sizeof(std::atomic<std::int64_t>)]; //!< Padding
+  };
+
+  /**
+   * @brief Slots that will hold the key/data pairs.
+   */
+  struct OALFSlot {
+    std::atomic<std::uint64_t> Key{0};            //!< 0 while unoccupied
+    std::atomic<std::uint64_t> Data{EMPTY_VALUE}; //!< Data or a sentinel
+  };
+
+  /**
+   * @brief One generation of the slot array.
+   */
+  struct SlotArray {
+    /**
+     * @brief Allocates the given amount of unoccupied slots.
+     *
+     * @param Size The amount of slots.
+     */
+    SlotArray(unsigned Size);
+
+    /**
+     * @brief Frees the slots.
+     */
+    ~SlotArray();
+
+    SlotArray(const SlotArray&) = delete;
+    SlotArray& operator=(const SlotArray&) = delete;
+
+    unsigned size;                    //!< Amount of slots
+    OALFSlot* slots;                  //!< The slots themselves
+    std::atomic<SlotArray*> next;     //!< Array being migrated into
+    std::atomic<std::size_t> claimed; //!< Next chunk to migrate
+    std::atomic<std::size_t> copied;  //!< Slots already migrated
+    Stripe keys[COUNTER_STRIPES];     //!< Keys claimed in this array
+    SlotArray* retired_next;          //!< Next array in the retired list
+  };
+
+  /**
+   * @brief The result of probing for a key.
+   */
+  struct SlotSearch {
+    OALFSlot* slot{nullptr};  //!< The slot with the key (if any)
+    OALFSlot* empty{nullptr}; //!< The unoccupied slot that ended the search
+    bool moved{false};        //!< Found a frozen slot before the key
+    bool claimed{false};      //!< The slot was claimed by this search
+  };
+
+  /**
+   * @brief Full width hash for a key.
+   *
+   * @param Key The key to hash.
+   * @return The hash.
+   */
+  static std::uint64_t hash(KEY Key);
+
+  /**
+   * @brief Encodes the data into a value word, throwing E_RESERVED if it
+   * clashes with a sentinel.
+   *
+   * @param Data The data to encode.
+   * @return The value word.
+   */
+  static std::uint64_t encode(T Data);
+
+  /**
+   * @brief Decodes a value word.
+   *
+   * @param Value The value word.
+   * @return The data.
+   */
+  static T decode(std::uint64_t Value);
+
+  /**
+   * @brief Whether a value word holds data.
+   *
+   * @param Value The value word, without the moved bit.
+   * @return Whether the slot is occupied.
+   */
+  static bool is_live(std::uint64_t Value);
+
+  /**
+   * @brief Probes an array for a key, optionally claiming an unoccupied slot.
+   *
+   * @param array The array to probe.
+   * @param Key The key to look for.
+   * @param Hash The key's hash.
+   * @param claim Whether to claim a slot for the key if it's not there.
+   * @return The slot with the key, or why it couldn't be found.
+   */
+  SlotSearch probe(
+    SlotArray& array,
+    KEY Key,
+    std::uint64_t Hash,
+    bool claim
+  ) const;
+
+  /**
+   * @brief The read only lookup, following the migration chain.
+   *
+   * @param array The array to look into.
+   * @param Key The key to look for.
+   * @param Hash The key's hash.
+   * @param Value Where to write the value word if found.
+   * @return Whether the key was found.
+   */
+  bool lookup(
+    SlotArray& array,
+    KEY Key,
+    std::uint64_t Hash,
+    std::uint64_t& Value
+  ) const;
+
+  /**
+   * @brief The shared loop of every writing operation. The update is given the
+   * current value word and returns the one to store.
+   *
+   * @param Key The key to update.
+   * @param claim Whether to claim a slot if the key is missing.
+   * @param update How to compute the new value word.
+   * @return The value word that was replaced.
+   */
+  template<typename F>
+  std::uint64_t update(KEY Key, bool claim, F update);
+
+  /**
+   * @brief Moves a key's slot to the next array (freezing the slot where it
+   * would be claimed if it's missing), helps the migration and returns the
+   * next array.
+   *
+   * @param array The array being migrated.
+   * @param Key The key being worked on.
+   * @param Hash The key's hash.
+   * @return The array to continue in.
+   */
+  SlotArray* advance(SlotArray& array, KEY Key, std::uint64_t Hash);
+
+  /**
+   * @brief Called when an array is full (or too full), starts the migration if
+   * nobody did yet.
+   *
+   * @param array The full array.
+   * @param Key The key being worked on.
+   * @param Hash The key's hash.
+   * @return The array to continue in.
+   */
+  SlotArray* make_room(SlotArray& array, KEY Key, std::uint64_t Hash);
+
+  /**
+   * @brief Counts a claimed key and starts growing once the array is too full.
+   *
+   * @param array The array the key was claimed in.
+   * @param Hash The key's hash.
+   */
+  void note_claim(SlotArray& array, std::uint64_t Hash);
+
+  /**
+   * @brief Attaches a new array to the current one, if nobody did yet.
+   *
+   * @param array The array to grow.
+   */
+  void start_growth(SlotArray& array);
+
+  /**
+   * @brief Attaches a new array to any array, if nobody did yet.
+   *
+   * @param array The array to grow.
+   * @param size The amount of slots of the new array.
+   * @return The array attached, by this thread or another one.
+   */
+  SlotArray* attach_next(SlotArray& array, unsigned size);
+
+  /**
+   * @brief Migrates the next chunk of slots (if any are left) and publishes
+   * the new array when every chunk is done.
+   *
+   * @param array The array being migrated.
+   */
+  void help_migrate(SlotArray& array);
+
+  /**
+   * @brief Freezes a slot and copies its data into the next array.
+   *
+   * @param array The array being migrated.
+   * @param slot The slot to migrate.
+   */
+  void migrate_slot(SlotArray& array, OALFSlot& slot);
+
+  /**
+   * @brief Puts migrated data into an array, unless the key is already there.
+   * If the array is full the data goes to a newer one.
+   *
+   * @param array The array to copy into.
+   * @param Key The key.
+   * @param Value The value word.
+   */
+  void copy_into(SlotArray& array, KEY Key, std::uint64_t Value);
+
+  /**
+   * @brief The table's configuration
+   */
+  OALFConfig config;
+
+  /**
+   * @brief The array every operation starts at.
+   */
+  std::atomic<SlotArray*> current{nullptr};
+
+  /**
+   * @brief Arrays that were fully migrated.
+   */
+  std::atomic<SlotArray*> retired{nullptr};
+
+  /**
+   * @brief The amount of items, spread over a few cache lines.
+   */
+  Stripe items[COUNTER_STRIPES];
+
+  /**
+   * @brief The amount of times the table grew.
+   */
+  std::atomic<unsigned> expansions{0};
+};
+
+  #ifndef OALOCKFREEHASHTABLE_CPP
+    #include "OALockFreeHashTable.cpp"
+  #endif
+
+#endif
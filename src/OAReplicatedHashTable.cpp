@@ -0,0 +1,189 @@
+/**
+ * @file OAReplicatedHashTable.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Implementation of the per node replicated hash table
+ */
+
+#pragma once
+
+#include <algorithm>
+
+#include "Support.h"
+
+#define OAREPLICATEDHASHTABLE_CPP
+
+#ifndef OAREPLICATEDHASHTABLEH
+  #include "OAReplicatedHashTable.h"
+#endif
+
+template<typename T, typename I>
+OAReplicatedHashTable<T, I>::OAReplicatedHashTable(const OAHTConfig& Config):
+    OAReplicatedHashTable(Config, GetNumaNodes()) {}
+
+template<typename T, typename I>
+OAReplicatedHashTable<T, I>::OAReplicatedHashTable(
+  const OAHTConfig& Config,
+  const std::vector<unsigned>& Nodes
+):
+    write_lock(), replicas(), node_replicas() {
+  // Readers touch the reference bits of their own replica only, so each one
+  // would pick different victims once full.
+  if (Config.Capacity_ != 0) {
+    throw OAHashTableException(
+      OAHashTableException::E_NO_MEMORY,
+      "A replicated table can't have a capacity, its replicas would diverge."
+    );
+  }
+
+  const std::vector<unsigned> nodes =
+    Nodes.empty() ? std::vector<unsigned>{GetNumaNodes().front()} : Nodes;
+
+  replicas.reserve(nodes.size());
+  node_replicas.assign(*std::max_element(nodes.begin(), nodes.end()) + 1, 0);
+
+  for (std::size_t i = 0; i < nodes.size(); i++) {
+    OAHTConfig replica_config(Config);
+    replica_config.NumaPolicy_ = NUMA_NODE;
+    replica_config.NumaNode_ = nodes[i];
+
+    // The data is copied into every replica, it must only be freed once, by
+    // the replica that removes it last.
+    if (i + 1 != nodes.size()) {
+      replica_config.FreeProc_ = nullptr;
+    }
+
+    replicas.emplace_back(new Replica(replica_config, nodes[i]));
+    node_replicas[nodes[i]] = i;
+  }
+}
+
+template<typename T, typename I>
+auto OAReplicatedHashTable<T, I>::insert(const char* Key, const T& Data)
+  -> void {
+  std::lock_guard<std::mutex> writer(write_lock);
+
+  for (std::size_t i = 0; i < replicas.size(); i++) {
+    Replica& replica = *replicas[i];
+
+    try {
+      std::lock_guard<std::mutex> guard(replica.lock);
+      replica.table.insert(Key, Data);
+    } catch (...) {
+      // The replicas are the same, only running out of memory gets here
+      // after the first one. Undo it so they stay the same, the last replica
+      // never got it so nothing is freed: the caller still owns the data.
+      for (std::size_t j = 0; j < i; j++) {
+        std::lock_guard<std::mutex> guard(replicas[j]->lock);
+        replicas[j]->table.remove(Key);
+      }
+
+      throw;
+    }
+  }
+}
+
+template<typename T, typename I>
+auto OAReplicatedHashTable<T, I>::remove(const char* Key) -> void {
+  std::lock_guard<std::mutex> writer(write_lock);
+
+  // A missing key throws from the first replica, before anything changed.
+  // The last one frees the data, once no reader can find it anywhere else.
+  for (const std::unique_ptr<Replica>& replica : replicas) {
+    std::lock_guard<std::mutex> guard(replica->lock);
+    replica->table.remove(Key);
+  }
+}
+
+template<typename T, typename I>
+auto OAReplicatedHashTable<T, I>::find(const char* Key) const -> T {
+  const Replica& replica = *replicas[get_local_replica()];
+  std::lock_guard<std::mutex> guard(replica.lock);
+
+  return replica.table.find(Key);
+}
+
+template<typename T, typename I>
+auto OAReplicatedHashTable<T, I>::clear() -> void {
+  std::lock_guard<std::mutex> writer(write_lock);
+
+  // The last one frees the data, like remove.
+  for (const std::unique_ptr<Replica>& replica : replicas) {
+    std::lock_guard<std::mutex> guard(replica->lock);
+    replica->table.clear();
+  }
+}
+
+template<typename T, typename I>
+auto OAReplicatedHashTable<T, I>::GetStats() const -> OAHTStats {
+  OAHTStats total = GetReplicaStats(0);
+
+  for (std::size_t i = 1; i < replicas.size(); i++) {
+    const OAHTStats stats = GetReplicaStats(i);
+
+    total.Probes_ += stats.Probes_;
+    total.Filtered_ += stats.Filtered_;
+
+    OAHTMemory& memory = total.Memory_;
+    memory.TableBytes_ += stats.Memory_.TableBytes_;
+    memory.PayloadBytes_ += stats.Memory_.PayloadBytes_;
+    memory.OverheadBytes_ += stats.Memory_.OverheadBytes_;
+    memory.UnusedBytes_ += stats.Memory_.UnusedBytes_;
+    memory.ExtraBytes_ += stats.Memory_.ExtraBytes_;
+  }
+
+  // Every replica is its own allocation, with the table object in it.
+  OAHTMemory& memory = total.Memory_;
+  memory.ExtraBytes_ += replicas.size() * sizeof(Replica)
+                      + replicas.capacity() * sizeof(std::unique_ptr<Replica>)
+                      + node_replicas.capacity() * sizeof(std::size_t);
+  memory.TotalBytes_ = memory.TableBytes_ + memory.ExtraBytes_ + sizeof(*this);
+
+  if (total.Count_ != 0) {
+    memory.BytesPerEntry_ =
+      static_cast<double>(memory.TotalBytes_) / total.Count_;
+  }
+
+  return total;
+}
+
+template<typename T, typename I>
+auto OAReplicatedHashTable<T, I>::GetReplicaStats(std::size_t Replica) const
+  -> OAHTStats {
+  std::lock_guard<std::mutex> guard(replicas[Replica]->lock);
+
+  return replicas[Replica]->table.GetStats();
+}
+
+template<typename T, typename I>
+auto OAReplicatedHashTable<T, I>::GetReplicaCount() const -> std::size_t {
+  return replicas.size();
+}
+
+template<typename T, typename I>
+auto OAReplicatedHashTable<T, I>::GetReplicaNode(std::size_t Replica) const
+  -> unsigned {
+  return replicas[Replica]->node;
+}
+
+template<typename T, typename I>
+OAReplicatedHashTable<T, I>::Replica::Replica(
+  const OAHTConfig& Config,
+  unsigned Node
+):
+    lock(), table(Config), node(Node) {}
+
+template<typename T, typename I>
+auto OAReplicatedHashTable<T, I>::get_local_replica() const -> std::size_t {
+  // Asking for the node is a system call, and threads rarely change nodes.
+  thread_local unsigned node = 0;
+  thread_local unsigned lookups = 0;
+
+  if (lookups++ % NODE_REFRESH == 0) {
+    node = GetCurrentNumaNode();
+  }
+
+  return node < node_replicas.size() ? node_replicas[node] : 0;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file OAReplicatedHashTable.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief A read-mostly hash table with one OAHashTable replica per NUMA node.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "OAHashTable.h"
+
+#ifndef OAREPLICATEDHASHTABLEH
+  #define OAREPLICATEDHASHTABLEH
+//---------------------------------------------------------------------------
+
+/**
+ * @brief A hash table for read-mostly data on NUMA machines. Every node gets a
+ * full copy with its slots placed on that node (NUMA_NODE), readers use the
+ * copy of the node they run on, and writes are applied to every copy. Reads
+ * from different nodes never touch the same memory or lock, at the cost of one
+ * copy of the data per node. On a single node it's a locked OAHashTable.
+ *
+ * Writes go to one replica at a time, so while one is running a reader may
+ * see it on its node before or after the other nodes. Only the last replica
+ * calls the FreeProc_ of the config, the data is the same in all of them.
+ * Writes get to it last, so the data is freed once no other replica has it.
+ */
+template<typename T, typename Instrumentation = OAFullInstrumentation>
+class OAReplicatedHashTable {
+public:
+
+  /**
+   * @brief The configuration is shared with OAHashTable. The NUMA policy is
+   * replaced for every replica.
+   */
+  typedef typename OAHashTable<T, Instrumentation>::OAHTConfig OAHTConfig;
+
+  //! Lookups between two checks of the node a thread runs on
+  static const unsigned NODE_REFRESH = 1024;
+
+  /**
+   * @brief Constructor for a replicated Hash Table of type T, with a replica
+   * on every node the process may allocate on. Throws an exception
+   * (E_NO_MEMORY) if the config sets a `Capacity_`: every replica would evict
+   * by its own reference bits, and they would end up with different keys.
+   *
+   * @param Config The config that describes every replica's behavior
+   */
+  explicit OAReplicatedHashTable(const OAHTConfig& Config);
+
+  /**
+   * @brief Constructor for a replicated Hash Table of type T, with a replica
+   * on every given node. Throws an exception (E_NO_MEMORY) if the config sets
+   * a `Capacity_`, like the other constructor.
+   *
+   * @param Config The config that describes every replica's behavior
+   * @param Nodes The nodes to keep a replica on, the first one if it's empty.
+   */
+  OAReplicatedHashTable(
+    const OAHTConfig& Config,
+    const std::vector<unsigned>& Nodes
+  );
+
+  OAReplicatedHashTable(const OAReplicatedHashTable&) = delete;
+  OAReplicatedHashTable& operator=(const OAReplicatedHashTable&) = delete;
+
+  /**
+   * @brief Insert a key/data pair into every replica. Throws an exception if
+   * the insertion is unsuccessful, and then no replica has it.
+   *
+   * @param Key The key to try insert in the table.
+   * @param Data The data to insert into the table.
+   */
+  void insert(const char* Key, const T& Data);
+
+  /**
+   * @brief Delete an item by key from every replica. Throws an exception if
+   * the key doesn't exist.
+   *
+   * @param Key The key to erase if it's present.
+   */
+  void remove(const char* Key);
+
+  /**
+   * @brief Find and return data by key in the replica of the calling thread's
+   * node. Throws an exception (E_ITEM_NOT_FOUND) if not found.
+   *
+   * @param Key The key to find if it's present.
+   * @return A copy of the Data at Key (the replica may change once unlocked)
+   */
+  T find(const char* Key) const;
+
+  /**
+   * @brief Removes all items from every replica.
+   */
+  void clear();
+
+  /**
+   * @brief Returns the statistics of the first replica, with the probes and
+   * the memory of every replica added together.
+   *
+   * @return The table's stats.
+   */
+  OAHTStats GetStats() const;
+
+  /**
+   * @brief Returns the statistics of a single replica.
+   *
+   * @param Replica The index of the replica.
+   * @return The replica's stats.
+   */
+  OAHTStats GetReplicaStats(std::size_t Replica) const;
+
+  /**
+   * @brief The amount of replicas.
+   *
+   * @return The amount of replicas.
+   */
+  std::size_t GetReplicaCount() const;
+
+  /**
+   * @brief The node a replica is placed on.
+   *
+   * @param Replica The index of the replica.
+   * @return The node.
+   */
+  unsigned GetReplicaNode(std::size_t Replica) const;
+
+private:
+
+  /**
+   * @brief A table, the lock that guards it and where it lives. Even `find`
+   * needs the lock since it updates the probe counts.
+   */
+  struct Replica {
+    /**
+     * @brief Creates an empty replica.
+     *
+     * @param Config The replica's configuration.
+     * @param Node The node its slots are on.
+     */
+    Replica(const OAHTConfig& Config, unsigned Node);
+
+    mutable std::mutex lock;               //!< Guards the table
+    OAHashTable<T, Instrumentation> table; //!< The replica's data
+    unsigned node;                         //!< Where the slots are
+  };
+
+  /**
+   * @brief Picks the replica for the calling thread.
+   *
+   * @return The index of the replica on its node, or 0 if there is none.
+   */
+  std::size_t get_local_replica() const;
+
+  /**
+   * @brief Serializes the writers, so every replica sees them in order.
+   */
+  std::mutex write_lock{};
+
+  /**
+   * @brief The replicas.
+   */
+  std::vector<std::unique_ptr<Replica>> replicas{};
+
+  /**
+   * @brief The replica of every node, indexed by node.
+   */
+  std::vector<std::size_t> node_replicas{};
+};
+
+  #ifndef OAREPLICATEDHASHTABLE_CPP
+    #include "OAReplicatedHashTable.cpp"
+  #endif
+
+#endif
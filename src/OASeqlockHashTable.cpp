@@ -0,0 +1,420 @@
+/**
+ * @file OASeqlockHashTable.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Implementation of the single writer / many readers table
+ */
+
+#pragma once
+
+#include <cstring>
+#include <thread>
+#include <utility>
+
+#include "Support.h"
+
+#define OASEQLOCKHASHTABLE_CPP
+
+#ifndef OASEQLOCKHASHTABLEH
+  #include "OASeqlockHashTable.h"
+#endif
+
+template<typename T>
+OASeqlockHashTable<T>::OASeqlockHashTable(const OAHTConfig& Config):
+    config(Config), readers(), stats() {
+  current.store(new SlotArray(config.InitialTableSize_));
+
+  stats.TableSize_ = config.InitialTableSize_;
+  stats.PrimaryHashFunc_ = config.PrimaryHashFunc_;
+  stats.SecondaryHashFunc_ = config.SecondaryHashFunc_;
+}
+
+template<typename T>
+OASeqlockHashTable<T>::~OASeqlockHashTable() {
+  clear();
+  delete current.load();
+
+  while (retired != nullptr) {
+    delete std::exchange(retired, retired->next);
+  }
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::insert(const char* Key, const T& Data) -> void {
+  reclaim();
+  try_grow_table();
+
+  SlotArray& array = *current.load(std::memory_order_relaxed);
+  std::size_t index = config.PrimaryHashFunc_(Key, array.size);
+  std::size_t stride = get_stride(Key, array.size);
+  OAHTSlot* target = nullptr;
+
+  for (std::size_t i = 0; i < array.size; i++) {
+    OAHTSlot& slot = array.slots[(index + i * stride) % array.size];
+    stats.Probes_++;
+
+    if (slot.State == OAHashTable<T>::OAHTSlot::UNOCCUPIED) {
+      if (target == nullptr) {
+        target = &slot;
+      }
+      break;
+    }
+
+    if (slot.State == OAHashTable<T>::OAHTSlot::DELETED) {
+      if (target == nullptr) {
+        target = &slot;
+      }
+      continue;
+    }
+
+    if (strcmp(slot.Key, Key) == 0) {
+      throw OAHashTableException(
+        OAHashTableException::E_DUPLICATE,
+        "There is a duplicate item in the list."
+      );
+    }
+  }
+
+  if (target == nullptr) {
+    throw OAHashTableException(
+      OAHashTableException::E_NO_MEMORY,
+      "There is not slot available."
+    );
+  }
+
+  if (target->State == OAHashTable<T>::OAHTSlot::DELETED) {
+    stats.Tombstones_--;
+  }
+
+  write_slot(*target, OAHashTable<T>::OAHTSlot::OCCUPIED, Key, &Data);
+  stats.Count_++;
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::remove(const char* Key) -> void {
+  reclaim();
+
+  OAHTSlot* slot = find_slot(Key);
+
+  if (slot == nullptr) {
+    throw OAHashTableException(
+      OAHashTableException::E_ITEM_NOT_FOUND,
+      "Key not in table."
+    );
+  }
+
+  delete_data(*slot);
+  write_slot(*slot, OAHashTable<T>::OAHTSlot::DELETED, nullptr, nullptr);
+  stats.Count_--;
+  stats.Tombstones_++;
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::find(const char* Key) const -> const T& {
+  const OAHTSlot* slot = find_slot(Key);
+
+  if (slot == nullptr) {
+    throw OAHashTableException(
+      OAHashTableException::E_ITEM_NOT_FOUND,
+      "Item not found in table."
+    );
+  }
+
+  return slot->Data;
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::clear() -> void {
+  SlotArray& array = *current.load(std::memory_order_relaxed);
+
+  for (std::size_t i = 0; i < array.size; i++) {
+    OAHTSlot& slot = array.slots[i];
+
+    if (slot.State == OAHashTable<T>::OAHTSlot::UNOCCUPIED) {
+      continue;
+    }
+
+    delete_data(slot);
+    write_slot(slot, OAHashTable<T>::OAHTSlot::UNOCCUPIED, nullptr, nullptr);
+  }
+
+  stats.Count_ = 0;
+  stats.Tombstones_ = 0;
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::GetStats() const -> OAHTStats {
+  return stats;
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::find_in(
+  const SlotArray& array,
+  const char* Key,
+  T& Data
+) const -> bool {
+  std::size_t index = config.PrimaryHashFunc_(Key, array.size);
+  std::size_t stride = get_stride(Key, array.size);
+
+  for (std::size_t i = 0; i < array.size; i++) {
+    const OAHTSlot& slot = array.slots[(index + i * stride) % array.size];
+
+    typename OAHTSlot::OAHTSlot_State state =
+      OAHashTable<T>::OAHTSlot::DELETED;
+    bool matches = false;
+    unsigned before = 0;
+
+    do {
+      before = slot.Version.load(std::memory_order_acquire);
+
+      if (before & 1) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      state = slot.State;
+      matches = state == OAHashTable<T>::OAHTSlot::OCCUPIED
+             && strncmp(slot.Key, Key, MAX_KEYLEN) == 0;
+
+      if (matches) {
+        memcpy(&Data, &slot.Data, sizeof(T));
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1)
+             || before != slot.Version.load(std::memory_order_relaxed));
+
+    if (state == OAHashTable<T>::OAHTSlot::UNOCCUPIED) {
+      return false;
+    }
+
+    if (matches) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::find_slot(const char* Key) const -> OAHTSlot* {
+  SlotArray& array = *current.load(std::memory_order_relaxed);
+  std::size_t index = config.PrimaryHashFunc_(Key, array.size);
+  std::size_t stride = get_stride(Key, array.size);
+
+  for (std::size_t i = 0; i < array.size; i++) {
+    OAHTSlot& slot = array.slots[(index + i * stride) % array.size];
+
+    if (slot.State == OAHashTable<T>::OAHTSlot::UNOCCUPIED) {
+      break;
+    }
+
+    if (slot.State == OAHashTable<T>::OAHTSlot::OCCUPIED
+        && strcmp(slot.Key, Key) == 0) {
+      return &slot;
+    }
+  }
+
+  return nullptr;
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::get_stride(const char* Key, unsigned size) const
+  -> std::size_t {
+  if (config.SecondaryHashFunc_ == nullptr) {
+    return 1;
+  }
+
+  return config.SecondaryHashFunc_(Key, size - 1) + 1;
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::write_slot(
+  OAHTSlot& slot,
+  typename OAHTSlot::OAHTSlot_State State,
+  const char* Key,
+  const T* Data
+) -> void {
+  unsigned version = slot.Version.load(std::memory_order_relaxed);
+  slot.Version.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.State = State;
+
+  if (Key != nullptr) {
+    strncpy(slot.Key, Key, MAX_KEYLEN - 1);
+    slot.Key[MAX_KEYLEN - 1] = '\0';
+  }
+
+  if (Data != nullptr) {
+    slot.Data = *Data;
+  }
+
+  slot.Version.store(version + 2, std::memory_order_release);
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::try_grow_table() -> void {
+  SlotArray* old_array = current.load(std::memory_order_relaxed);
+
+  const float size = static_cast<float>(old_array->size);
+  const float load_factor =
+    static_cast<float>(stats.Count_ + stats.Tombstones_ + 1) / size;
+
+  if (load_factor <= config.MaxLoadFactor_) {
+    return;
+  }
+
+  // Only the tombstones are over the limit, the same size gets rid of them.
+  const bool grow =
+    static_cast<float>(stats.Count_ + 1) / size > config.MaxLoadFactor_;
+
+  // The new array isn't visible to readers yet, so it can be filled in
+  // without going through the versions.
+  SlotArray* new_array = new SlotArray(
+    grow
+      ? static_cast<unsigned>(
+          GetGrownTableSize(old_array->size, config.GrowthFactor_)
+        )
+      : old_array->size
+  );
+
+  for (std::size_t i = 0; i < old_array->size; i++) {
+    const OAHTSlot& old_slot = old_array->slots[i];
+
+    if (old_slot.State != OAHashTable<T>::OAHTSlot::OCCUPIED) {
+      continue;
+    }
+
+    unsigned size = new_array->size;
+    std::size_t index = config.PrimaryHashFunc_(old_slot.Key, size);
+    std::size_t stride = get_stride(old_slot.Key, size);
+
+    for (std::size_t j = 0; j < size; j++) {
+      OAHTSlot& slot = new_array->slots[(index + j * stride) % size];
+      stats.Probes_++;
+
+      if (slot.State == OAHashTable<T>::OAHTSlot::UNOCCUPIED) {
+        slot.State = OAHashTable<T>::OAHTSlot::OCCUPIED;
+        strcpy(slot.Key, old_slot.Key);
+        slot.Data = old_slot.Data;
+        break;
+      }
+    }
+  }
+
+  current.store(new_array);
+
+  old_array->retired_epoch = epoch.fetch_add(1) + 1;
+  old_array->next = retired;
+  retired = old_array;
+
+  stats.TableSize_ = new_array->size;
+  stats.Tombstones_ = 0;
+
+  if (grow) {
+    stats.Expansions_++;
+  }
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::reclaim() -> void {
+  if (retired == nullptr) {
+    return;
+  }
+
+  // The oldest epoch any reader is still in. A retired array can go once
+  // every reader entered after it was replaced.
+  std::uint64_t oldest = epoch.load();
+
+  for (const ReaderRecord& reader : readers) {
+    std::uint64_t seen = reader.epoch.load();
+
+    if (seen != 0 && seen < oldest) {
+      oldest = seen;
+    }
+  }
+
+  SlotArray** link = &retired;
+
+  while (*link != nullptr) {
+    if ((*link)->retired_epoch <= oldest) {
+      delete std::exchange(*link, (*link)->next);
+    } else {
+      link = &(*link)->next;
+    }
+  }
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::delete_data(OAHTSlot& slot) -> void {
+  if (slot.State != OAHashTable<T>::OAHTSlot::OCCUPIED) {
+    return;
+  }
+
+  if (config.FreeProc_ != nullptr) {
+    config.FreeProc_(slot.Data);
+  }
+}
+
+// Slot array stuff
+
+template<typename T>
+OASeqlockHashTable<T>::SlotArray::SlotArray(unsigned Size):
+    size(Size), slots(new OAHTSlot[Size]), next(nullptr), retired_epoch(0) {}
+
+template<typename T>
+OASeqlockHashTable<T>::SlotArray::~SlotArray() {
+  delete[] slots;
+}
+
+// Reader stuff
+
+template<typename T>
+OASeqlockHashTable<T>::Reader::Reader(const OASeqlockHashTable& Table):
+    table(Table), record(MAX_READERS) {
+  for (std::size_t i = 0; i < MAX_READERS; i++) {
+    bool expected = false;
+
+    if (table.readers[i].in_use.compare_exchange_strong(expected, true)) {
+      record = i;
+      return;
+    }
+  }
+
+  throw OAHashTableException(
+    OAHashTableException::E_NO_MEMORY,
+    "There are too many readers."
+  );
+}
+
+template<typename T>
+OASeqlockHashTable<T>::Reader::~Reader() {
+  table.readers[record].epoch.store(0);
+  table.readers[record].in_use.store(false);
+}
+
+template<typename T>
+auto OASeqlockHashTable<T>::Reader::find(const char* Key) const -> T {
+  ReaderRecord& announcement = table.readers[record];
+
+  // Announce before looking at the array so the writer won't free it under us.
+  announcement.epoch.store(table.epoch.load());
+  const SlotArray* array = table.current.load();
+
+  T data{};
+  bool found = table.find_in(*array, Key, data);
+
+  announcement.epoch.store(0, std::memory_order_release);
+
+  if (!found) {
+    throw OAHashTableException(
+      OAHashTableException::E_ITEM_NOT_FOUND,
+      "Item not found in table."
+    );
+  }
+
+  return data;
+}
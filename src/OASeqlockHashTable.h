@@ -0,0 +1,313 @@
+/**
+ * @file OASeqlockHashTable.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Single writer / many readers variant of the open addressing table.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "OAHashTable.h"
+
+#ifndef OASEQLOCKHASHTABLEH
+  #define OASEQLOCKHASHTABLEH
+//---------------------------------------------------------------------------
+
+/**
+ * @brief An open addressing table meant for one writer thread and many reader
+ * threads. Readers never take a lock and never write to memory shared with
+ * other threads: every slot carries a version counter (a seqlock) and readers
+ * validate what they copied out of it. Growth publishes a brand new slot array
+ * and the old one is only freed once every reader that could still see it has
+ * left (epoch based reclamation).
+ *
+ * The probing and sizing are the same as OAHashTable, but deletions always
+ * leave a tombstone (the `MARK` policy) since moving keys around would make
+ * optimistic readers miss them. Tombstones are cleaned up when the table
+ * grows, or when it's rebuilt at the same size once they'd push it over
+ * MaxLoadFactor.
+ */
+template<typename T>
+class OASeqlockHashTable {
+  static_assert(
+    std::is_trivially_copyable<T>::value,
+    "Readers copy the data out of slots that may be changing."
+  );
+
+public:
+
+  /**
+   * @brief Client-provided free function.
+   */
+  typedef void (*FREEPROC)(T);
+
+  /**
+   * @brief The configuration is shared with OAHashTable. `DeletionPolicy_` is
+   * ignored (see the class description).
+   */
+  typedef typename OAHashTable<T>::OAHTConfig OAHTConfig;
+
+  //! The max amount of Reader instances that can exist at the same time.
+  static const std::size_t MAX_READERS = 64;
+
+  /**
+   * @brief A registered reader. Every thread that wants to look up keys while
+   * the writer keeps working needs its own Reader. It must be destroyed before
+   * the table.
+   */
+  class Reader {
+  public:
+
+    /**
+     * @brief Registers a new reader in the table. Throws an exception
+     * (E_NO_MEMORY) if there are already MAX_READERS readers.
+     *
+     * @param Table The table to read from.
+     */
+    Reader(const OASeqlockHashTable& Table);
+
+    /**
+     * @brief Unregisters the reader.
+     */
+    ~Reader();
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    /**
+     * @brief Find and return a copy of the data by key. Throws an exception
+     * (E_ITEM_NOT_FOUND) if not found. Never blocks the writer.
+     *
+     * @param Key The key to find if it's present.
+     * @return A copy of the Data at Key.
+     */
+    T find(const char* Key) const;
+
+  private:
+
+    /**
+     * @brief The table being read.
+     */
+    const OASeqlockHashTable& table;
+
+    /**
+     * @brief The index of the record this reader announces its epoch in.
+     */
+    std::size_t record;
+  };
+
+  /**
+   * @brief Constructor for a Hash Table of type T
+   *
+   * @param Config The config that describes the table's behavior
+   */
+  OASeqlockHashTable(const OAHTConfig& Config);
+
+  OASeqlockHashTable(const OASeqlockHashTable&) = delete;
+  OASeqlockHashTable& operator=(const OASeqlockHashTable&) = delete;
+
+  /**
+   * @brief Destructor for the table. It will call the deletion method for all
+   * the occupied slots. No Reader may be alive at this point.
+   */
+  ~OASeqlockHashTable();
+
+  /**
+   * @brief Insert a key/data pair into table. Throws an exception if the
+   * insertion is unsuccessful. Writer thread only.
+   *
+   * @param Key The key to try insert in the table.
+   * @param Data The data to insert into the table.
+   */
+  void insert(const char* Key, const T& Data);
+
+  /**
+   * @brief Delete an item by key. Throws an exception if the key doesn't exist.
+   * Writer thread only.
+   *
+   * @param Key The key to erase if it's present.
+   */
+  void remove(const char* Key);
+
+  /**
+   * @brief Find and return data by key. Throws an exception (E_ITEM_NOT_FOUND)
+   * if not found. Writer thread only, the other threads use a Reader.
+   *
+   * @param Key The key to find if it's present.
+   * @return The Data at Key
+   */
+  const T& find(const char* Key) const;
+
+  /**
+   * @brief Removes all items from the table (Doesn't deallocate table). Writer
+   * thread only.
+   */
+  void clear();
+
+  /**
+   * @brief Returns the table's statistics. Only the writer's operations are
+   * counted, readers don't touch the stats.
+   *
+   * @return The table's stats.
+   */
+  OAHTStats GetStats() const;
+
+private:
+
+  /**
+   * @brief Slots that will hold the key/data pairs, plus the version counter
+   * that readers use to validate their copy. An odd version means the writer
+   * is in the middle of changing the slot.
+   */
+  struct OAHTSlot {
+    typedef typename OAHashTable<T>::OAHTSlot::OAHTSlot_State OAHTSlot_State;
+
+    std::atomic<unsigned> Version{0};                          //!< Seqlock
+    OAHTSlot_State State{OAHashTable<T>::OAHTSlot::UNOCCUPIED}; //!< State
+    char Key[MAX_KEYLEN]{'\0'};                                 //!< Key
+    T Data{};                                                   //!< Data
+  };
+
+  /**
+   * @brief One published generation of the slot array.
+   */
+  struct SlotArray {
+    /**
+     * @brief Allocates the given amount of unoccupied slots.
+     *
+     * @param Size The amount of slots.
+     */
+    SlotArray(unsigned Size);
+
+    /**
+     * @brief Frees the slots.
+     */
+    ~SlotArray();
+
+    SlotArray(const SlotArray&) = delete;
+    SlotArray& operator=(const SlotArray&) = delete;
+
+    unsigned size;   //!< Amount of slots
+    OAHTSlot* slots; //!< The slots themselves
+    SlotArray* next; //!< Next array in the retired list
+    std::uint64_t retired_epoch; //!< Epoch at which it stopped being current
+  };
+
+  /**
+   * @brief The announcement of a reader. `epoch` is zero while the reader is
+   * outside of a lookup. The padding keeps every reader on its own cache line.
+   */
+  struct ReaderRecord {
+    std::atomic<std::uint64_t> epoch{0}; //!< Epoch seen on entry
+    std::atomic<bool> in_use{false};     //!< Whether a Reader owns the record
+    char padding[64 - sizeof(std::atomic<std::uint64_t>) - sizeof(bool)];
+  };
+
+  /**
+   * @brief The lookup shared by the writer and the readers. Readers validate
+   * every slot they look at against its version.
+   *
+   * @param array The slot array to look into.
+   * @param Key The key to look for.
+   * @param Data Where to copy the data if found.
+   * @return Whether the key was found.
+   */
+  bool find_in(const SlotArray& array, const char* Key, T& Data) const;
+
+  /**
+   * @brief Finds the slot that holds Key in the current array (writer only).
+   *
+   * @param Key The key to look for.
+   * @return The slot or null if the key isn't present.
+   */
+  OAHTSlot* find_slot(const char* Key) const;
+
+  /**
+   * @brief This will use the secondary hash mapping the function parameters to
+   * the required range of (1, TableSize - 1). When there is no secondary hash
+   * the stride is 1 (linear probing).
+   *
+   * @param Key The key to hash.
+   * @param size The size of the array being probed.
+   * @return The distance between two consecutive probes.
+   */
+  std::size_t get_stride(const char* Key, unsigned size) const;
+
+  /**
+   * @brief Publishes a new version of the slot from the writer.
+   *
+   * @param slot The slot to change.
+   * @param State The new state.
+   * @param Key The new key (null to leave it as is).
+   * @param Data The new data (null to leave it as is).
+   */
+  void write_slot(
+    OAHTSlot& slot,
+    typename OAHTSlot::OAHTSlot_State State,
+    const char* Key,
+    const T* Data
+  );
+
+  /**
+   * @brief Grows the table when the load factor would go over MaxLoadFactor,
+   * or rebuilds it at the same size if only the tombstones push it over. The
+   * new array is fully built before being published.
+   */
+  void try_grow_table();
+
+  /**
+   * @brief Frees the retired arrays that no reader can be looking at anymore.
+   */
+  void reclaim();
+
+  /**
+   * @brief Call the deletion function for the data in the slot.
+   *
+   * @param slot The slot to delete.
+   */
+  void delete_data(OAHTSlot& slot);
+
+  /**
+   * @brief The table's configuration
+   */
+  OAHTConfig config;
+
+  /**
+   * @brief The array readers should use.
+   */
+  std::atomic<SlotArray*> current{nullptr};
+
+  /**
+   * @brief Arrays that were replaced but may still be in use by readers.
+   */
+  SlotArray* retired{nullptr};
+
+  /**
+   * @brief Global epoch, bumped every time an array is retired.
+   */
+  std::atomic<std::uint64_t> epoch{1};
+
+  /**
+   * @brief The readers' announcements.
+   */
+  mutable ReaderRecord readers[MAX_READERS];
+
+  /**
+   * @brief The table's stats (writer only).
+   */
+  OAHTStats stats{};
+};
+
+  #ifndef OASEQLOCKHASHTABLE_CPP
+    #include "OASeqlockHashTable.cpp"
+  #endif
+
+#endif
@@ -0,0 +1,304 @@
+/**
+ * @file OASnapshotHashTable.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Implementation of the copy-on-write table
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+#include "Support.h"
+
+#define OASNAPSHOTHASHTABLE_CPP
+
+#ifndef OASNAPSHOTHASHTABLEH
+  #include "OASnapshotHashTable.h"
+#endif
+
+template<typename T>
+const std::size_t OASnapshotHashTable<T>::CHUNK_SLOTS;
+
+template<typename T>
+OASnapshotHashTable<T>::OASnapshotHashTable(const OAHTConfig& Config):
+    config(Config),
+    directory(make_directory(Config.InitialTableSize_)),
+    stats() {
+  stats.TableSize_ = config.InitialTableSize_;
+  stats.PrimaryHashFunc_ = config.PrimaryHashFunc_;
+  stats.SecondaryHashFunc_ = config.SecondaryHashFunc_;
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::insert(const char* Key, const T& Data) -> void {
+  try_grow_table();
+
+  std::size_t target = stats.TableSize_;
+
+  if (find_index(Key, &target) != stats.TableSize_) {
+    throw OAHashTableException(
+      OAHashTableException::E_DUPLICATE,
+      "There is a duplicate item in the list."
+    );
+  }
+
+  if (target == stats.TableSize_) {
+    throw OAHashTableException(
+      OAHashTableException::E_NO_MEMORY,
+      "There is not slot available."
+    );
+  }
+
+  OAHTSlot& slot = get_slot_mut(target);
+
+  if (slot.State == OAHashTable<T>::OAHTSlot::DELETED) {
+    stats.Tombstones_--;
+  }
+
+  slot.State = OAHashTable<T>::OAHTSlot::OCCUPIED;
+  strncpy(slot.Key, Key, MAX_KEYLEN - 1);
+  slot.Key[MAX_KEYLEN - 1] = '\0';
+  slot.Data = Data;
+  slot.Owner = config.FreeProc_ != nullptr
+    ? std::make_shared<DataOwner>(Data, config.FreeProc_)
+    : nullptr;
+  stats.Count_++;
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::remove(const char* Key) -> void {
+  const std::size_t index = find_index(Key);
+
+  if (index == stats.TableSize_) {
+    throw OAHashTableException(
+      OAHashTableException::E_ITEM_NOT_FOUND,
+      "Key not in table."
+    );
+  }
+
+  OAHTSlot& slot = get_slot_mut(index);
+
+  // Freed here unless a copy still holds the element.
+  slot.Owner.reset();
+  slot.State = OAHashTable<T>::OAHTSlot::DELETED;
+  stats.Count_--;
+  stats.Tombstones_++;
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::find(const char* Key) const -> const T& {
+  const std::size_t index = find_index(Key);
+
+  if (index == stats.TableSize_) {
+    throw OAHashTableException(
+      OAHashTableException::E_ITEM_NOT_FOUND,
+      "Item not found in table."
+    );
+  }
+
+  return get_slot(index).Data;
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::clear() -> void {
+  // The elements only this table held are freed with their chunks.
+  directory = make_directory(stats.TableSize_);
+  stats.Count_ = 0;
+  stats.Tombstones_ = 0;
+}
+
+template<typename T>
+template<typename F>
+auto OASnapshotHashTable<T>::for_each(F fn) const -> void {
+  for (const std::shared_ptr<Chunk>& chunk : directory->chunks) {
+    if (!chunk) {
+      continue;
+    }
+
+    for (const OAHTSlot& slot : chunk->slots) {
+      if (slot.State == OAHashTable<T>::OAHTSlot::OCCUPIED) {
+        fn(static_cast<const char*>(slot.Key), slot.Data);
+      }
+    }
+  }
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::GetSharedChunks() const -> std::size_t {
+  const bool shared_directory = directory.use_count() > 1;
+  std::size_t shared = 0;
+
+  for (const std::shared_ptr<Chunk>& chunk : directory->chunks) {
+    if (chunk && (shared_directory || chunk.use_count() > 1)) {
+      shared++;
+    }
+  }
+
+  return shared;
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::GetStats() const -> OAHTStats {
+  return stats;
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::make_directory(std::size_t size)
+  -> std::shared_ptr<Directory> {
+  std::shared_ptr<Directory> created = std::make_shared<Directory>();
+  created->chunks.resize((size + CHUNK_SLOTS - 1) / CHUNK_SLOTS);
+
+  return created;
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::get_slot(std::size_t index) const
+  -> const OAHTSlot& {
+  static const OAHTSlot unoccupied{};
+
+  const std::shared_ptr<Chunk>& chunk =
+    directory->chunks[index / CHUNK_SLOTS];
+
+  return chunk ? chunk->slots[index % CHUNK_SLOTS] : unoccupied;
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::get_slot_mut(std::size_t index) -> OAHTSlot& {
+  if (directory.use_count() > 1) {
+    directory = std::make_shared<Directory>(*directory);
+  }
+
+  std::shared_ptr<Chunk>& chunk = directory->chunks[index / CHUNK_SLOTS];
+
+  if (!chunk) {
+    chunk = std::make_shared<Chunk>();
+  } else if (chunk.use_count() > 1) {
+    chunk = std::make_shared<Chunk>(*chunk);
+  }
+
+  // A copy read by another thread may have just let go of the chunk, its
+  // reads have to be done before this writes.
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  return chunk->slots[index % CHUNK_SLOTS];
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::find_index(const char* Key, std::size_t* target)
+  const -> std::size_t {
+  const std::size_t size = stats.TableSize_;
+  const std::size_t index =
+    config.PrimaryHashFunc_(Key, static_cast<unsigned>(size));
+  const std::size_t stride = get_stride(Key);
+
+  if (target != nullptr) {
+    *target = size;
+  }
+
+  for (std::size_t i = 0; i < size; i++) {
+    const std::size_t probe = (index + i * stride) % size;
+    const OAHTSlot& slot = get_slot(probe);
+    stats.Probes_++;
+
+    if (slot.State == OAHashTable<T>::OAHTSlot::UNOCCUPIED) {
+      if (target != nullptr && *target == size) {
+        *target = probe;
+      }
+      break;
+    }
+
+    if (slot.State == OAHashTable<T>::OAHTSlot::DELETED) {
+      if (target != nullptr && *target == size) {
+        *target = probe;
+      }
+      continue;
+    }
+
+    if (strncmp(slot.Key, Key, MAX_KEYLEN - 1) == 0) {
+      return probe;
+    }
+  }
+
+  return size;
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::get_stride(const char* Key) const
+  -> std::size_t {
+  if (config.SecondaryHashFunc_ == nullptr) {
+    return 1;
+  }
+
+  return config.SecondaryHashFunc_(
+    Key,
+    static_cast<unsigned>(stats.TableSize_ - 1)
+  ) + 1;
+}
+
+template<typename T>
+auto OASnapshotHashTable<T>::try_grow_table() -> void {
+  const double size = static_cast<double>(stats.TableSize_);
+  const double load_factor =
+    static_cast<double>(stats.Count_ + stats.Tombstones_ + 1) / size;
+
+  if (load_factor <= config.MaxLoadFactor_) {
+    return;
+  }
+
+  const bool grow =
+    static_cast<double>(stats.Count_ + 1) / size > config.MaxLoadFactor_;
+  const std::size_t new_size = grow
+    ? static_cast<std::size_t>(
+        GetGrownTableSize(stats.TableSize_, config.GrowthFactor_)
+      )
+    : stats.TableSize_;
+
+  // The copies keep the old chunks, this table moves to new ones.
+  const std::shared_ptr<Directory> old_directory =
+    std::exchange(directory, make_directory(new_size));
+  const std::size_t old_size = stats.TableSize_;
+  stats.TableSize_ = new_size;
+  stats.Tombstones_ = 0;
+
+  for (std::size_t c = 0; c < old_directory->chunks.size(); c++) {
+    const std::shared_ptr<Chunk>& chunk = old_directory->chunks[c];
+
+    if (!chunk) {
+      continue;
+    }
+
+    for (std::size_t s = 0; s < CHUNK_SLOTS && c * CHUNK_SLOTS + s < old_size;
+         s++) {
+      const OAHTSlot& old_slot = chunk->slots[s];
+
+      if (old_slot.State != OAHashTable<T>::OAHTSlot::OCCUPIED) {
+        continue;
+      }
+
+      std::size_t target = new_size;
+      find_index(old_slot.Key, &target);
+      get_slot_mut(target) = old_slot;
+    }
+  }
+
+  if (grow) {
+    stats.Expansions_++;
+  }
+}
+
+template<typename T>
+OASnapshotHashTable<T>::DataOwner::DataOwner(
+  const T& Data,
+  FREEPROC FreeProc
+):
+    data(Data), free_proc(FreeProc) {}
+
+template<typename T>
+OASnapshotHashTable<T>::DataOwner::~DataOwner() {
+  free_proc(data);
+}
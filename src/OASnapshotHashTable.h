@@ -0,0 +1,271 @@
+/**
+ * @file OASnapshotHashTable.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Open addressing table whose copies share their slots until written.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "OAHashTable.h"
+
+#ifndef OASNAPSHOTHASHTABLEH
+  #define OASNAPSHOTHASHTABLEH
+//---------------------------------------------------------------------------
+
+/**
+ * @brief An open addressing table that is cheap to copy. The slots are split
+ * in chunks of CHUNK_SLOTS, and a copy shares the list of chunks with the
+ * table it came from (copying is O(1)). The first write to either side
+ * copies the list, and every chunk is copied the first time one of them
+ * writes to it. So a snapshot for a reader costs nothing up front, and the
+ * memory grows with how much the two diverge. A chunk nothing was written to
+ * is never allocated.
+ *
+ * The probing and sizing are the same as OAHashTable, but deletions always
+ * leave a tombstone (the `MARK` policy) since moving keys around would copy
+ * the chunks of the whole cluster. Tombstones are cleaned up when the table
+ * grows, or is rebuilt in place once they'd push it over MaxLoadFactor.
+ *
+ * A copy can be handed to another thread and read there while the table it
+ * came from keeps changing, as long as the copy is made by the writer. The
+ * copies share the data too: FreeProc_ is called once no table holds an
+ * element anymore, by whichever table (and thread) lets go of it last.
+ */
+template<typename T>
+class OASnapshotHashTable {
+public:
+
+  /**
+   * @brief Client-provided free function.
+   */
+  typedef void (*FREEPROC)(T);
+
+  /**
+   * @brief The configuration is shared with OAHashTable. `DeletionPolicy_` is
+   * ignored (see the class description).
+   */
+  typedef typename OAHashTable<T>::OAHTConfig OAHTConfig;
+
+  //! Slots in a chunk, what is shared and copied at once
+  static const std::size_t CHUNK_SLOTS = 64;
+
+  /**
+   * @brief Constructor for a Hash Table of type T
+   *
+   * @param Config The config that describes the table's behavior
+   */
+  explicit OASnapshotHashTable(const OAHTConfig& Config);
+
+  /**
+   * @brief Takes a snapshot of a table. The slots are shared until either
+   * side writes to them.
+   *
+   * @param rhs The table to copy.
+   */
+  OASnapshotHashTable(const OASnapshotHashTable& rhs) = default;
+
+  /**
+   * @brief Replaces this table with a snapshot of another one. The elements
+   * only this table held are freed.
+   *
+   * @param rhs The table to copy.
+   * @return This table.
+   */
+  OASnapshotHashTable& operator=(const OASnapshotHashTable& rhs) = default;
+
+  /**
+   * @brief Destructor for the table. It will call the deletion method for the
+   * elements no copy holds anymore.
+   */
+  ~OASnapshotHashTable() = default;
+
+  /**
+   * @brief Insert a key/data pair into table. Throws an exception if the
+   * insertion is unsuccessful.
+   *
+   * @param Key The key to try insert in the table.
+   * @param Data The data to insert into the table.
+   */
+  void insert(const char* Key, const T& Data);
+
+  /**
+   * @brief Delete an item by key. Throws an exception if the key doesn't exist.
+   *
+   * @param Key The key to erase if it's present.
+   */
+  void remove(const char* Key);
+
+  /**
+   * @brief Find and return data by key. Throws an exception (E_ITEM_NOT_FOUND)
+   * if not found.
+   *
+   * @param Key The key to find if it's present.
+   * @return The Data at Key, until the table changes.
+   */
+  const T& find(const char* Key) const;
+
+  /**
+   * @brief Removes all items from the table. The chunks are dropped, not
+   * written to, so copies keep theirs.
+   */
+  void clear();
+
+  /**
+   * @brief Calls a function with the key and data of every element, in slot
+   * order. The function must not change the table.
+   *
+   * @param fn Called as `fn(const char* Key, const T& Data)`.
+   */
+  template<typename F>
+  void for_each(F fn) const;
+
+  /**
+   * @brief The amount of chunks this table shares with a copy, so writing to
+   * them would copy them first.
+   *
+   * @return The amount of chunks.
+   */
+  std::size_t GetSharedChunks() const;
+
+  /**
+   * @brief Returns the table's statistics.
+   *
+   * @return The table's stats.
+   */
+  OAHTStats GetStats() const;
+
+private:
+
+  /**
+   * @brief Frees the data of an element once the last slot holding it is
+   * gone. The slots of a chunk and of its copies share one.
+   */
+  struct DataOwner {
+    /**
+     * @brief Takes the data to free.
+     *
+     * @param Data The data.
+     * @param FreeProc The client's free function.
+     */
+    DataOwner(const T& Data, FREEPROC FreeProc);
+
+    DataOwner(const DataOwner&) = delete;
+    DataOwner& operator=(const DataOwner&) = delete;
+
+    /**
+     * @brief Calls the free function.
+     */
+    ~DataOwner();
+
+    T data;             //!< The data to free
+    FREEPROC free_proc; //!< The client's free function
+  };
+
+  /**
+   * @brief Slots that will hold the key/data pairs.
+   */
+  struct OAHTSlot {
+    typedef typename OAHashTable<T>::OAHTSlot::OAHTSlot_State OAHTSlot_State;
+
+    OAHTSlot_State State{OAHashTable<T>::OAHTSlot::UNOCCUPIED}; //!< State
+    char Key[MAX_KEYLEN]{'\0'};                                 //!< Key
+    T Data{};                                                   //!< Data
+    std::shared_ptr<DataOwner> Owner{};                         //!< Frees Data
+  };
+
+  /**
+   * @brief A run of CHUNK_SLOTS slots.
+   */
+  struct Chunk {
+    OAHTSlot slots[CHUNK_SLOTS]{}; //!< The slots
+  };
+
+  /**
+   * @brief Every chunk of the table. A null chunk has no slot in use.
+   */
+  struct Directory {
+    std::vector<std::shared_ptr<Chunk>> chunks{}; //!< The chunks
+  };
+
+  /**
+   * @brief Creates the directory of an empty table.
+   *
+   * @param size The amount of slots.
+   * @return The directory, with no chunk allocated.
+   */
+  static std::shared_ptr<Directory> make_directory(std::size_t size);
+
+  /**
+   * @brief Reads a slot, without copying anything.
+   *
+   * @param index The slot.
+   * @return The slot.
+   */
+  const OAHTSlot& get_slot(std::size_t index) const;
+
+  /**
+   * @brief Gets a slot to write to. The directory and the chunk are copied
+   * first if a copy of the table shares them.
+   *
+   * @param index The slot.
+   * @return The slot.
+   */
+  OAHTSlot& get_slot_mut(std::size_t index);
+
+  /**
+   * @brief Looks for a key.
+   *
+   * @param Key The key to look for.
+   * @param target Set to where the key would be inserted (the first deleted
+   * or unoccupied slot), or TableSize_ if there is no room. Can be null.
+   * @return The slot of the key, or TableSize_ if it isn't there.
+   */
+  std::size_t find_index(const char* Key, std::size_t* target = nullptr)
+    const;
+
+  /**
+   * @brief This will use the secondary hash mapping the function parameters to
+   * the required range of (1, TableSize - 1). When there is no secondary hash
+   * the stride is 1 (linear probing).
+   *
+   * @param Key The key to hash.
+   * @return The distance between two consecutive probes.
+   */
+  std::size_t get_stride(const char* Key) const;
+
+  /**
+   * @brief Grows the table when the load factor would go over MaxLoadFactor,
+   * or rebuilds it in place if only the tombstones push it over. The slots go
+   * to new chunks, copies keep the old ones.
+   */
+  void try_grow_table();
+
+  /**
+   * @brief The table's configuration
+   */
+  OAHTConfig config;
+
+  /**
+   * @brief The chunks, shared with the copies of the table.
+   */
+  std::shared_ptr<Directory> directory{};
+
+  /**
+   * @brief The table's stats.
+   */
+  mutable OAHTStats stats{};
+};
+
+  #ifndef OASNAPSHOTHASHTABLE_CPP
+    #include "OASnapshotHashTable.cpp"
+  #endif
+
+#endif
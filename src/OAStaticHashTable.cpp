@@ -0,0 +1,114 @@
+/**
+ * @file OAStaticHashTable.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Implementation of the compile time table
+ */
+
+#pragma once
+
+#define OASTATICHASHTABLE_CPP
+
+#ifndef OASTATICHASHTABLEH
+  #include "OAStaticHashTable.h"
+#endif
+
+template<typename T, std::size_t N>
+constexpr std::size_t OAStaticHashTable<T, N>::TableSize_;
+
+template<typename T, std::size_t N>
+constexpr OAStaticHashTable<T, N>::OAStaticHashTable(
+  const OAStaticEntry<T> (&Entries)[N]
+):
+    slots() {
+  for (std::size_t i = 0; i < N; i++) {
+    const char* key = Entries[i].Key_;
+    OASHTSlot& slot = slots[find_slot(key)];
+
+    if (slot.Occupied) {
+      throw OAHashTableException(
+        OAHashTableException::E_DUPLICATE,
+        "There is a duplicate item in the list."
+      );
+    }
+
+    for (std::size_t c = 0; c < MAX_KEYLEN - 1 && key[c] != '\0'; c++) {
+      slot.Key[c] = key[c];
+    }
+
+    slot.Data = Entries[i].Data_;
+    slot.Occupied = true;
+  }
+}
+
+template<typename T, std::size_t N>
+constexpr auto OAStaticHashTable<T, N>::find(const char* Key) const
+  -> const T& {
+  const OASHTSlot& slot = slots[find_slot(Key)];
+
+  if (!slot.Occupied) {
+    throw OAHashTableException(
+      OAHashTableException::E_ITEM_NOT_FOUND,
+      "Item not found in table."
+    );
+  }
+
+  return slot.Data;
+}
+
+template<typename T, std::size_t N>
+constexpr auto OAStaticHashTable<T, N>::size() const -> std::size_t {
+  return N;
+}
+
+template<typename T, std::size_t N>
+constexpr auto OAStaticHashTable<T, N>::find_slot(const char* Key) const
+  -> std::size_t {
+  std::size_t index = get_hash(Key) % TableSize_;
+
+  // The load factor is at most 0.5, there is always an empty slot.
+  while (slots[index].Occupied && !is_same_key(slots[index].Key, Key)) {
+    index = (index + 1) % TableSize_;
+  }
+
+  return index;
+}
+
+template<typename T, std::size_t N>
+constexpr auto OAStaticHashTable<T, N>::get_hash(const char* Key)
+  -> std::uint64_t {
+  std::uint64_t hash = 14695981039346656037ULL;
+
+  for (std::size_t c = 0; c < MAX_KEYLEN - 1 && Key[c] != '\0'; c++) {
+    hash ^= static_cast<unsigned char>(Key[c]);
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+template<typename T, std::size_t N>
+constexpr auto OAStaticHashTable<T, N>::is_same_key(
+  const char* Stored,
+  const char* Key
+) -> bool {
+  for (std::size_t c = 0; c < MAX_KEYLEN - 1; c++) {
+    if (Stored[c] != Key[c]) {
+      return false;
+    }
+
+    if (Key[c] == '\0') {
+      return true;
+    }
+  }
+
+  return true;
+}
+
+template<typename T, std::size_t N>
+constexpr auto MakeStaticTable(const OAStaticEntry<T> (&Entries)[N])
+  -> OAStaticHashTable<T, N> {
+  return OAStaticHashTable<T, N>(Entries);
+}
@@ -0,0 +1,133 @@
+/**
+ * @file OAStaticHashTable.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Open addressing table built at compile time from a fixed key set.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+
+#include "OAHashTable.h"
+#include "Support.h"
+
+#ifndef OASTATICHASHTABLEH
+  #define OASTATICHASHTABLEH
+//---------------------------------------------------------------------------
+
+/**
+ * @brief A key/data pair the static table is built from.
+ */
+template<typename T>
+struct OAStaticEntry {
+  const char* Key_; //!< Key is a string
+  T Data_;          //!< Client data
+};
+
+/**
+ * @brief A table for key sets that are known at compile time. It's built by
+ * the compiler (see MakeStaticTable), so a `constexpr` table is fully
+ * populated in read-only data and costs nothing at startup.
+ *
+ * The size is the closest prime to twice the amount of keys (a load factor of
+ * at most 0.5, like the default OAHashTable). The keys are hashed with the
+ * same FNV-1a as GetFullHash and probed linearly, since the client hash
+ * functions can't run at compile time. Like OASeqlockHashTable, keys are cut
+ * to MAX_KEYLEN - 1 characters. T has to be a literal type.
+ */
+template<typename T, std::size_t N>
+class OAStaticHashTable {
+public:
+
+  //! The amount of slots
+  static constexpr std::size_t TableSize_ =
+    GetConstexprClosestPrime(static_cast<unsigned>(2 * N + 1));
+
+  /**
+   * @brief Builds the table. Throws an exception (E_DUPLICATE) if a key is
+   * repeated, which is a compile error for a `constexpr` table.
+   *
+   * @param Entries Every key/data pair.
+   */
+  constexpr explicit OAStaticHashTable(const OAStaticEntry<T> (&Entries)[N]);
+
+  /**
+   * @brief Find and return data by key. Throws an exception (E_ITEM_NOT_FOUND)
+   * if not found. Can be used in constant expressions.
+   *
+   * @param Key The key to find if it's present.
+   * @return The Data at Key
+   */
+  constexpr const T& find(const char* Key) const;
+
+  /**
+   * @brief The amount of elements.
+   *
+   * @return N.
+   */
+  constexpr std::size_t size() const;
+
+private:
+
+  /**
+   * @brief Slots that will hold the key/data pairs.
+   */
+  struct OASHTSlot {
+    char Key[MAX_KEYLEN]{'\0'}; //!< Key is a string
+    T Data{};                   //!< Client data
+    bool Occupied{false};       //!< Whether it holds a pair
+  };
+
+  /**
+   * @brief The slot a key is in, or the empty slot where it would go.
+   *
+   * @param Key The key to look for.
+   * @return The index of the slot.
+   */
+  constexpr std::size_t find_slot(const char* Key) const;
+
+  /**
+   * @brief 64 bit FNV-1a of a key, the same as GetFullHash.
+   *
+   * @param Key The key to hash.
+   * @return The hash.
+   */
+  static constexpr std::uint64_t get_hash(const char* Key);
+
+  /**
+   * @brief Compares a stored key with one being looked up.
+   *
+   * @param Stored The key in a slot.
+   * @param Key The key being looked up.
+   * @return Whether they match in their first MAX_KEYLEN - 1 characters.
+   */
+  static constexpr bool is_same_key(const char* Stored, const char* Key);
+
+  /**
+   * @brief The slots.
+   */
+  OASHTSlot slots[TableSize_]{};
+};
+
+/**
+ * @brief Builds a static table, letting the compiler count the entries:
+ * `constexpr auto table = MakeStaticTable(ENTRIES);`
+ *
+ * @param Entries Every key/data pair.
+ * @return The table.
+ */
+template<typename T, std::size_t N>
+constexpr OAStaticHashTable<T, N> MakeStaticTable(
+  const OAStaticEntry<T> (&Entries)[N]
+);
+
+  #ifndef OASTATICHASHTABLE_CPP
+    #include "OAStaticHashTable.cpp"
+  #endif
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file OATrace.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief A compact binary log of table operations, to replay real traffic.
+ */
+
+#include <cstring>
+
+#include "OATrace.h"
+
+//! The start of every trace file, the last byte is the version
+const unsigned char TRACE_MAGIC[8] = {'O', 'A', 'T', 'R', 'A', 'C', 'E', 1};
+
+//! The buffer is written once it has this many bytes
+const std::size_t TRACE_BUFFER_SIZE = 1 << 16;
+
+//! The most bytes a record can take: the op, the varint, the length, the key
+const std::size_t TRACE_MAX_RECORD = 1 + 10 + 1 + TRACE_MAX_KEYLEN;
+
+OATraceWriter::OATraceWriter(const char* Path):
+    file(std::fopen(Path, "wb")),
+    ok(file != nullptr),
+    buffer(),
+    last(std::chrono::steady_clock::now()) {
+  buffer.reserve(TRACE_BUFFER_SIZE + TRACE_MAX_RECORD);
+  buffer.insert(buffer.end(), TRACE_MAGIC, TRACE_MAGIC + sizeof(TRACE_MAGIC));
+}
+
+OATraceWriter::~OATraceWriter() {
+  flush();
+
+  if (file != nullptr) {
+    std::fclose(file);
+  }
+}
+
+bool OATraceWriter::good() const {
+  return ok;
+}
+
+void OATraceWriter::record(
+  OATraceOp Op,
+  OATraceOutcome Outcome,
+  const char* Key
+) {
+  const std::chrono::steady_clock::time_point now =
+    std::chrono::steady_clock::now();
+  unsigned long long delta = static_cast<unsigned long long>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count()
+  );
+  last = now;
+
+  buffer.push_back(static_cast<unsigned char>(Op | (Outcome << 2)));
+
+  while (delta >= 0x80) {
+    buffer.push_back(static_cast<unsigned char>(delta | 0x80));
+    delta >>= 7;
+  }
+  buffer.push_back(static_cast<unsigned char>(delta));
+
+  std::size_t length = 0;
+
+  if (Op != TRACE_CLEAR) {
+    while (length < TRACE_MAX_KEYLEN && Key[length] != '\0') {
+      length++;
+    }
+  }
+
+  buffer.push_back(static_cast<unsigned char>(length));
+  buffer.insert(buffer.end(), Key, Key + length);
+
+  if (buffer.size() >= TRACE_BUFFER_SIZE) {
+    flush();
+  }
+}
+
+void OATraceWriter::flush() {
+  if (file == nullptr || buffer.empty()) {
+    return;
+  }
+
+  if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+    ok = false;
+  }
+
+  buffer.clear();
+  std::fflush(file);
+}
+
+// Reader stuff
+
+OATraceReader::OATraceReader(const char* Path):
+    file(std::fopen(Path, "rb")), ok(file != nullptr) {
+  unsigned char magic[sizeof(TRACE_MAGIC)];
+
+  if (ok) {
+    ok = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic)
+      && std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+  }
+}
+
+OATraceReader::~OATraceReader() {
+  if (file != nullptr) {
+    std::fclose(file);
+  }
+}
+
+bool OATraceReader::good() const {
+  return ok;
+}
+
+bool OATraceReader::next(OATraceRecord& Record) {
+  if (!ok) {
+    return false;
+  }
+
+  const int header = std::fgetc(file);
+
+  if (header == EOF) {
+    return false;
+  }
+
+  Record.Op_ = static_cast<OATraceOp>(header & 3);
+  Record.Outcome_ = static_cast<OATraceOutcome>((header >> 2) & 3);
+  Record.Delta_ = 0;
+
+  for (unsigned shift = 0;; shift += 7) {
+    const int byte = std::fgetc(file);
+
+    if (byte == EOF || shift > 63) {
+      ok = false;
+      return false;
+    }
+
+    Record.Delta_ |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+
+    if ((byte & 0x80) == 0) {
+      break;
+    }
+  }
+
+  const int length = std::fgetc(file);
+
+  if (length == EOF
+      || std::fread(Record.Key_, 1, static_cast<std::size_t>(length), file)
+           != static_cast<std::size_t>(length)) {
+    ok = false;
+    return false;
+  }
+
+  Record.Key_[length] = '\0';
+
+  return true;
+}
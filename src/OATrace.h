@@ -0,0 +1,174 @@
+/**
+ * @file OATrace.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief A compact binary log of table operations, to replay real traffic.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#ifndef OATRACEH
+#define OATRACEH
+//---------------------------------------------------------------------------
+
+/**
+ * @brief The longest key a trace can hold.
+ */
+const unsigned TRACE_MAX_KEYLEN = 255;
+
+//! The operations that are traced
+enum OATraceOp {
+  TRACE_INSERT,
+  TRACE_FIND,
+  TRACE_REMOVE,
+  TRACE_CLEAR
+};
+
+//! How a traced operation ended
+enum OATraceOutcome {
+  TRACE_OK,
+  TRACE_NOT_FOUND, //!< Threw E_ITEM_NOT_FOUND
+  TRACE_DUPLICATE, //!< Threw E_DUPLICATE
+  TRACE_FAILED     //!< Threw anything else
+};
+
+/**
+ * @brief A single traced operation.
+ */
+struct OATraceRecord {
+  OATraceOp Op_{TRACE_FIND};         //!< The operation
+  OATraceOutcome Outcome_{TRACE_OK}; //!< How it ended
+  unsigned long long Delta_{0};      //!< Nanoseconds since the previous one
+  char Key_[TRACE_MAX_KEYLEN + 1]{}; //!< The key (empty for a clear)
+};
+
+/**
+ * @brief Writes a trace file. Records are buffered and written in big blocks,
+ * so recording an operation is a clock read and a copy of the key.
+ *
+ * The file starts with the magic "OATRACE" and a version byte, followed by
+ * the records. Every record is:
+ * - 1 byte: the operation in the low 2 bits, the outcome in the next 2.
+ * - The time since the previous record in nanoseconds, as a LEB128 varint.
+ * - 1 byte: the length of the key, followed by the key without the '\0'.
+ */
+class OATraceWriter {
+public:
+
+  /**
+   * @brief Opens (and truncates) a trace file. Check good() afterwards.
+   *
+   * @param Path The file to write to.
+   */
+  OATraceWriter(const char* Path);
+
+  OATraceWriter(const OATraceWriter&) = delete;
+  OATraceWriter& operator=(const OATraceWriter&) = delete;
+
+  /**
+   * @brief Flushes and closes the file.
+   */
+  ~OATraceWriter();
+
+  /**
+   * @brief Whether the file is open and every write went through.
+   *
+   * @return Whether the trace is fine.
+   */
+  bool good() const;
+
+  /**
+   * @brief Records an operation that just ended. Keys longer than
+   * TRACE_MAX_KEYLEN are cut.
+   *
+   * @param Op The operation.
+   * @param Outcome How it ended.
+   * @param Key The key (ignored for a clear).
+   */
+  void record(OATraceOp Op, OATraceOutcome Outcome, const char* Key);
+
+  /**
+   * @brief Writes the buffered records to the file.
+   */
+  void flush();
+
+private:
+
+  /**
+   * @brief The trace file.
+   */
+  std::FILE* file;
+
+  /**
+   * @brief Whether every write went through.
+   */
+  bool ok;
+
+  /**
+   * @brief Records that weren't written yet.
+   */
+  std::vector<unsigned char> buffer;
+
+  /**
+   * @brief When the previous record happened.
+   */
+  std::chrono::steady_clock::time_point last;
+};
+
+/**
+ * @brief Reads a trace file written by OATraceWriter.
+ */
+class OATraceReader {
+public:
+
+  /**
+   * @brief Opens a trace file. Check good() afterwards.
+   *
+   * @param Path The file to read.
+   */
+  OATraceReader(const char* Path);
+
+  OATraceReader(const OATraceReader&) = delete;
+  OATraceReader& operator=(const OATraceReader&) = delete;
+
+  /**
+   * @brief Closes the file.
+   */
+  ~OATraceReader();
+
+  /**
+   * @brief Whether the file is open, is a trace and wasn't cut short.
+   *
+   * @return Whether the trace is fine.
+   */
+  bool good() const;
+
+  /**
+   * @brief Reads the next record.
+   *
+   * @param Record Where to put the record.
+   * @return Whether there was one.
+   */
+  bool next(OATraceRecord& Record);
+
+private:
+
+  /**
+   * @brief The trace file.
+   */
+  std::FILE* file;
+
+  /**
+   * @brief Whether the file is fine so far.
+   */
+  bool ok;
+};
+
+#endif
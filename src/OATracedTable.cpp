@@ -0,0 +1,74 @@
+/**
+ * @file OATracedTable.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Implementation of the tracing wrapper
+ */
+
+#pragma once
+
+#define OATRACEDTABLE_CPP
+
+#ifndef OATRACEDTABLEH
+  #include "OATracedTable.h"
+#endif
+
+template<typename Table>
+OATracedTable<Table>::OATracedTable(Table& Wrapped, OATraceWriter& Writer):
+    table(Wrapped), writer(Writer) {}
+
+template<typename Table>
+template<typename D>
+auto OATracedTable<Table>::insert(const char* Key, const D& Data) -> void {
+  try {
+    table.insert(Key, Data);
+  } catch (const OAHashTableException& exception) {
+    writer.record(TRACE_INSERT, get_outcome(exception), Key);
+    throw;
+  }
+
+  writer.record(TRACE_INSERT, TRACE_OK, Key);
+}
+
+template<typename Table>
+auto OATracedTable<Table>::remove(const char* Key) -> void {
+  try {
+    table.remove(Key);
+  } catch (const OAHashTableException& exception) {
+    writer.record(TRACE_REMOVE, get_outcome(exception), Key);
+    throw;
+  }
+
+  writer.record(TRACE_REMOVE, TRACE_OK, Key);
+}
+
+template<typename Table>
+auto OATracedTable<Table>::find(const char* Key) const
+  -> decltype(std::declval<const Table&>().find(Key)) {
+  try {
+    decltype(std::declval<const Table&>().find(Key)) data = table.find(Key);
+    writer.record(TRACE_FIND, TRACE_OK, Key);
+    return data;
+  } catch (const OAHashTableException& exception) {
+    writer.record(TRACE_FIND, get_outcome(exception), Key);
+    throw;
+  }
+}
+
+template<typename Table>
+auto OATracedTable<Table>::clear() -> void {
+  table.clear();
+  writer.record(TRACE_CLEAR, TRACE_OK, "");
+}
+
+template<typename Table>
+auto OATracedTable<Table>::get_outcome(const OAHashTableException& exception)
+  -> OATraceOutcome {
+  switch (exception.code()) {
+    case OAHashTableException::E_ITEM_NOT_FOUND: return TRACE_NOT_FOUND;
+    case OAHashTableException::E_DUPLICATE: return TRACE_DUPLICATE;
+    default: return TRACE_FAILED;
+  }
+}
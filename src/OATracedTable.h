@@ -0,0 +1,97 @@
+/**
+ * @file OATracedTable.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief A wrapper that records every operation on a table to a trace.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#include <utility>
+
+#include "OAHashTable.h"
+#include "OATrace.h"
+
+#ifndef OATRACEDTABLEH
+  #define OATRACEDTABLEH
+//---------------------------------------------------------------------------
+
+/**
+ * @brief Forwards insert, find, remove and clear to a table and records each
+ * of them (key, operation and outcome) with an OATraceWriter. Exceptions are
+ * recorded and then rethrown, so the wrapper behaves like the table itself.
+ * Works with any table that has the OAHashTable interface and throws
+ * OAHashTableException.
+ */
+template<typename Table>
+class OATracedTable {
+public:
+
+  /**
+   * @brief Wraps a table. Both the table and the writer must outlive the
+   * wrapper.
+   *
+   * @param Wrapped The table to forward to.
+   * @param Writer Where to record the operations.
+   */
+  OATracedTable(Table& Wrapped, OATraceWriter& Writer);
+
+  /**
+   * @brief Insert a key/data pair into table and records it.
+   *
+   * @param Key The key to try insert in the table.
+   * @param Data The data to insert into the table.
+   */
+  template<typename D>
+  void insert(const char* Key, const D& Data);
+
+  /**
+   * @brief Delete an item by key and records it.
+   *
+   * @param Key The key to erase if it's present.
+   */
+  void remove(const char* Key);
+
+  /**
+   * @brief Find and return data by key and records it.
+   *
+   * @param Key The key to find if it's present.
+   * @return Whatever the table's find returns.
+   */
+  auto find(const char* Key) const
+    -> decltype(std::declval<const Table&>().find(Key));
+
+  /**
+   * @brief Removes all items from the table and records it.
+   */
+  void clear();
+
+private:
+
+  /**
+   * @brief How an exception thrown by the table is recorded.
+   *
+   * @param exception The exception.
+   * @return The outcome.
+   */
+  static OATraceOutcome get_outcome(const OAHashTableException& exception);
+
+  /**
+   * @brief The table being traced.
+   */
+  Table& table;
+
+  /**
+   * @brief Where the operations go.
+   */
+  OATraceWriter& writer;
+};
+
+  #ifndef OATRACEDTABLE_CPP
+    #include "OATracedTable.cpp"
+  #endif
+
+#endif
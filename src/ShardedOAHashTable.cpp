@@ -0,0 +1,236 @@
+/**
+ * @file ShardedOAHashTable.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Implementation of the sharded hash table
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+#include "Support.h"
+
+#define SHARDEDOAHASHTABLE_CPP
+
+#ifndef SHARDEDOAHASHTABLEH
+  #include "ShardedOAHashTable.h"
+#endif
+
+template<typename T, typename I>
+ShardedOAHashTable<T, I>::ShardedOAHashTable(
+  const OAHTConfig& Config,
+  unsigned ShardBits
+):
+    shard_bits(std::min(ShardBits, MAX_SHARD_BITS)), shards() {
+  const std::size_t count = std::size_t(1) << shard_bits;
+
+  OAHTConfig shard_config(Config);
+  shard_config.InitialTableSize_ = static_cast<std::size_t>(GetClosestPrime64(
+    std::max<std::size_t>(Config.InitialTableSize_ >> shard_bits, 3)
+  ));
+
+  // The cache as a whole holds about Capacity_ elements, not every shard.
+  if (Config.Capacity_ != 0) {
+    shard_config.Capacity_ = (Config.Capacity_ + count - 1) >> shard_bits;
+  }
+
+  shards.reserve(count);
+
+  for (std::size_t i = 0; i < count; i++) {
+    shards.emplace_back(new Shard(shard_config));
+  }
+}
+
+template<typename T, typename I>
+auto ShardedOAHashTable<T, I>::insert(const char* Key, const T& Data)
+  -> void {
+  Shard& shard = *shards[get_shard(Key)];
+  std::lock_guard<std::mutex> guard(shard.lock);
+
+  shard.table.insert(Key, Data);
+}
+
+template<typename T, typename I>
+auto ShardedOAHashTable<T, I>::insert_bulk(
+  const char* const* Keys,
+  const T* Data,
+  std::size_t Count
+) -> void {
+  std::vector<std::vector<std::size_t>> routes(shards.size());
+
+  for (std::size_t i = 0; i < Count; i++) {
+    routes[get_shard(Keys[i])].push_back(i);
+  }
+
+  fan_out([&](std::size_t index) {
+    Shard& shard = *shards[index];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    std::exception_ptr failure;
+
+    for (std::size_t i : routes[index]) {
+      try {
+        shard.table.insert(Keys[i], Data[i]);
+      } catch (...) {
+        if (!failure) {
+          failure = std::current_exception();
+        }
+      }
+    }
+
+    if (failure) {
+      std::rethrow_exception(failure);
+    }
+  });
+}
+
+template<typename T, typename I>
+auto ShardedOAHashTable<T, I>::remove(const char* Key) -> void {
+  Shard& shard = *shards[get_shard(Key)];
+  std::lock_guard<std::mutex> guard(shard.lock);
+
+  shard.table.remove(Key);
+}
+
+template<typename T, typename I>
+auto ShardedOAHashTable<T, I>::find(const char* Key) const -> T {
+  const Shard& shard = *shards[get_shard(Key)];
+  std::lock_guard<std::mutex> guard(shard.lock);
+
+  return shard.table.find(Key);
+}
+
+template<typename T, typename I>
+auto ShardedOAHashTable<T, I>::clear() -> void {
+  fan_out([this](std::size_t index) {
+    Shard& shard = *shards[index];
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    shard.table.clear();
+  });
+}
+
+template<typename T, typename I>
+auto ShardedOAHashTable<T, I>::GetStats() const -> OAHTStats {
+  OAHTStats total;
+
+  for (const std::unique_ptr<Shard>& shard : shards) {
+    std::lock_guard<std::mutex> guard(shard->lock);
+    OAHTStats stats = shard->table.GetStats();
+
+    total.Count_ += stats.Count_;
+    total.TableSize_ += stats.TableSize_;
+    total.Probes_ += stats.Probes_;
+    total.Expansions_ += stats.Expansions_;
+    total.PrimaryHashFunc_ = stats.PrimaryHashFunc_;
+    total.SecondaryHashFunc_ = stats.SecondaryHashFunc_;
+    total.Tombstones_ += stats.Tombstones_;
+    total.MaxProbeLength_ =
+      std::max(total.MaxProbeLength_, stats.MaxProbeLength_);
+    total.Displacement_ += stats.Displacement_;
+    total.Compactions_ += stats.Compactions_;
+    total.Repacked_ += stats.Repacked_;
+    total.Filtered_ += stats.Filtered_;
+    total.Rebuilds_ += stats.Rebuilds_;
+    total.Evictions_ += stats.Evictions_;
+    total.Expirations_ += stats.Expirations_;
+
+    OAHTMemory& memory = total.Memory_;
+    memory.SlotBytes_ = stats.Memory_.SlotBytes_;
+    memory.TableBytes_ += stats.Memory_.TableBytes_;
+    memory.PayloadBytes_ += stats.Memory_.PayloadBytes_;
+    memory.OverheadBytes_ += stats.Memory_.OverheadBytes_;
+    memory.UnusedBytes_ += stats.Memory_.UnusedBytes_;
+    memory.ExtraBytes_ += stats.Memory_.ExtraBytes_;
+  }
+
+  // Every shard is its own allocation, with the table object in it.
+  OAHTMemory& memory = total.Memory_;
+  memory.ExtraBytes_ += shards.size() * sizeof(Shard)
+                      + shards.capacity() * sizeof(std::unique_ptr<Shard>);
+  memory.TotalBytes_ = memory.TableBytes_ + memory.ExtraBytes_ + sizeof(*this);
+
+  if (total.Count_ != 0) {
+    memory.BytesPerEntry_ =
+      static_cast<double>(memory.TotalBytes_) / total.Count_;
+  }
+
+  return total;
+}
+
+template<typename T, typename I>
+auto ShardedOAHashTable<T, I>::GetShardStats(std::size_t Shard) const
+  -> OAHTStats {
+  std::lock_guard<std::mutex> guard(shards[Shard]->lock);
+
+  return shards[Shard]->table.GetStats();
+}
+
+template<typename T, typename I>
+auto ShardedOAHashTable<T, I>::GetShardCount() const -> std::size_t {
+  return shards.size();
+}
+
+template<typename T, typename I>
+auto ShardedOAHashTable<T, I>::get_shard(const char* Key) const
+  -> std::size_t {
+  if (shard_bits == 0) {
+    return 0;
+  }
+
+  // The high bits, the low ones are the closest to what the shards use.
+  return static_cast<std::size_t>(GetFullHash(Key) >> (64 - shard_bits));
+}
+
+template<typename T, typename I>
+template<typename F>
+auto ShardedOAHashTable<T, I>::fan_out(F work) -> void {
+  const std::size_t workers = std::min<std::size_t>(
+    shards.size(),
+    std::max(std::thread::hardware_concurrency(), 1u)
+  );
+
+  std::atomic<std::size_t> next_shard{0};
+  std::vector<std::exception_ptr> failures(workers);
+  std::vector<std::thread> threads;
+
+  auto worker = [&](std::size_t id) {
+    for (std::size_t index = next_shard++; index < shards.size();
+         index = next_shard++) {
+      try {
+        work(index);
+      } catch (...) {
+        if (!failures[id]) {
+          failures[id] = std::current_exception();
+        }
+      }
+    }
+  };
+
+  for (std::size_t id = 1; id < workers; id++) {
+    threads.emplace_back(worker, id);
+  }
+
+  worker(0);
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (std::exception_ptr& failure : failures) {
+    if (failure) {
+      std::rethrow_exception(failure);
+    }
+  }
+}
+
+// Shard stuff
+
+template<typename T, typename I>
+ShardedOAHashTable<T, I>::Shard::Shard(const OAHTConfig& Config):
+    lock(), table(Config) {}
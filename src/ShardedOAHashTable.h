@@ -0,0 +1,170 @@
+/**
+ * @file ShardedOAHashTable.h
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief A hash table split into independent OAHashTable shards.
+ */
+
+#pragma once
+
+//---------------------------------------------------------------------------
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "OAHashTable.h"
+
+#ifndef SHARDEDOAHASHTABLEH
+  #define SHARDEDOAHASHTABLEH
+//---------------------------------------------------------------------------
+
+/**
+ * @brief A hash table made of 2^k OAHashTable shards. Every key is routed to
+ * a shard by the high bits of its full width hash (GetFullHash), and every
+ * shard has its own lock, grows on its own and keeps its own stats. Threads
+ * working on different shards never wait on each other, and a single growth
+ * only has to move the data of its shard. The Instrumentation policy is passed
+ * on to the shards.
+ */
+template<typename T, typename Instrumentation = OAFullInstrumentation>
+class ShardedOAHashTable {
+public:
+
+  /**
+   * @brief The configuration is shared with OAHashTable. The initial size and
+   * the cache capacity are split evenly between the shards, the capacity
+   * rounded up so every shard holds at least one element.
+   */
+  typedef typename OAHashTable<T, Instrumentation>::OAHTConfig OAHTConfig;
+
+  //! The max amount of bits used to pick a shard.
+  static const unsigned MAX_SHARD_BITS = 16;
+
+  /**
+   * @brief Constructor for a sharded Hash Table of type T
+   *
+   * @param Config The config that describes every shard's behavior
+   * @param ShardBits The table will have 2^ShardBits shards.
+   */
+  ShardedOAHashTable(const OAHTConfig& Config, unsigned ShardBits = 4);
+
+  ShardedOAHashTable(const ShardedOAHashTable&) = delete;
+  ShardedOAHashTable& operator=(const ShardedOAHashTable&) = delete;
+
+  /**
+   * @brief Insert a key/data pair into table. Throws an exception if the
+   * insertion is unsuccessful.
+   *
+   * @param Key The key to try insert in the table.
+   * @param Data The data to insert into the table.
+   */
+  void insert(const char* Key, const T& Data);
+
+  /**
+   * @brief Inserts many key/data pairs, with every shard filled by its own
+   * thread. If some insertions fail the rest still happen and the first
+   * exception is rethrown at the end.
+   *
+   * @param Keys The keys to insert.
+   * @param Data The data to insert, one per key.
+   * @param Count The amount of keys.
+   */
+  void insert_bulk(const char* const* Keys, const T* Data, std::size_t Count);
+
+  /**
+   * @brief Delete an item by key. Throws an exception if the key doesn't exist.
+   *
+   * @param Key The key to erase if it's present.
+   */
+  void remove(const char* Key);
+
+  /**
+   * @brief Find and return data by key. Throws an exception (E_ITEM_NOT_FOUND)
+   * if not found.
+   *
+   * @param Key The key to find if it's present.
+   * @return A copy of the Data at Key (the shard may change once unlocked)
+   */
+  T find(const char* Key) const;
+
+  /**
+   * @brief Removes all items from every shard, in parallel.
+   */
+  void clear();
+
+  /**
+   * @brief Returns the statistics of all the shards added together.
+   *
+   * @return The table's stats.
+   */
+  OAHTStats GetStats() const;
+
+  /**
+   * @brief Returns the statistics of a single shard.
+   *
+   * @param Shard The index of the shard.
+   * @return The shard's stats.
+   */
+  OAHTStats GetShardStats(std::size_t Shard) const;
+
+  /**
+   * @brief The amount of shards.
+   *
+   * @return The amount of shards.
+   */
+  std::size_t GetShardCount() const;
+
+private:
+
+  /**
+   * @brief A table and the lock that guards it. Even `find` needs the lock
+   * since it updates the probe counts.
+   */
+  struct Shard {
+    /**
+     * @brief Creates an empty shard.
+     *
+     * @param Config The shard's configuration.
+     */
+    Shard(const OAHTConfig& Config);
+
+    mutable std::mutex lock;               //!< Guards the table
+    OAHashTable<T, Instrumentation> table; //!< The shard's data
+  };
+
+  /**
+   * @brief Picks the shard for a key.
+   *
+   * @param Key The key to route.
+   * @return The index of the shard.
+   */
+  std::size_t get_shard(const char* Key) const;
+
+  /**
+   * @brief Runs some work for every shard over a few threads. The first
+   * exception thrown by the work is rethrown once every thread is done.
+   *
+   * @param work Called with the index of every shard.
+   */
+  template<typename F>
+  void fan_out(F work);
+
+  /**
+   * @brief The amount of bits used to pick a shard.
+   */
+  unsigned shard_bits;
+
+  /**
+   * @brief The shards.
+   */
+  std::vector<std::unique_ptr<Shard>> shards;
+};
+
+  #ifndef SHARDEDOAHASHTABLE_CPP
+    #include "ShardedOAHashTable.cpp"
+  #endif
+
+#endif
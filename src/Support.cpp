@@ -9,6 +9,15 @@
 /*********************************************************/
 
 #include <cmath>
+#include <new>
+
+#ifdef __linux__
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+#include "Support.h"
 
 const unsigned Primes[] = {
   2,    3,    5,    7,    11,   13,   17,   19,   23,   29,   31,   37,   41,
@@ -105,7 +114,8 @@ unsigned GetClosestPrime(unsigned Value) {
       unsigned RootN = static_cast<unsigned>(std::sqrt(static_cast<double>(prime)));
       unsigned DivisorIndex = 1;
       bool IsPrime = true;
-      while ((DivisorIndex < PrimeCount) && (RootN > Primes[DivisorIndex])) {
+      // Up to and including the root, or the squares of primes pass (67^2).
+      while ((DivisorIndex < PrimeCount) && (RootN >= Primes[DivisorIndex])) {
         if (((prime / Primes[DivisorIndex]) * Primes[DivisorIndex]) == prime) {
           IsPrime = false;
           break;
@@ -119,5 +129,264 @@ unsigned GetClosestPrime(unsigned Value) {
       prime += 2;
     }
   }
+
+  // Past the table's reach, up to the largest 32 bit prime. Anything above
+  // it gets it too, the next prime doesn't fit.
+  const unsigned LargestPrime = 4294967291u;
+  if (prime >= LargestPrime) {
+    return LargestPrime;
+  }
+
+  return static_cast<unsigned>(GetClosestPrime64(prime));
+}
+
+// (a * b) % m without overflowing, by doubling when a * b doesn't fit.
+unsigned long long MulMod(
+  unsigned long long a,
+  unsigned long long b,
+  unsigned long long m
+) {
+  if (a < (1ULL << 32) && b < (1ULL << 32)) {
+    return (a * b) % m;
+  }
+
+  unsigned long long result = 0;
+  a %= m;
+
+  while (b) {
+    if (b & 1) {
+      result = result >= m - a ? result - (m - a) : result + a;
+    }
+
+    a = a >= m - a ? a - (m - a) : a + a;
+    b >>= 1;
+  }
+
+  return result;
+}
+
+static unsigned long long PowMod(
+  unsigned long long base,
+  unsigned long long exponent,
+  unsigned long long m
+) {
+  unsigned long long result = 1;
+  base %= m;
+
+  while (exponent) {
+    if (exponent & 1) {
+      result = MulMod(result, base, m);
+    }
+
+    base = MulMod(base, base, m);
+    exponent >>= 1;
+  }
+
+  return result;
+}
+
+// Miller-Rabin, these bases make it exact for every 64 bit value.
+static bool IsPrime64(unsigned long long Value) {
+  const unsigned Bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+
+  if (Value < 2) {
+    return false;
+  }
+
+  // Cheap rejection of most composites before the expensive rounds
+  for (unsigned i = 0; i < PrimeCount && Primes[i] < 64; i++) {
+    if (Value % Primes[i] == 0) {
+      return Value == Primes[i];
+    }
+  }
+
+  unsigned long long odd = Value - 1;
+  unsigned twos = 0;
+
+  while (odd % 2 == 0) {
+    odd /= 2;
+    twos++;
+  }
+
+  for (unsigned base : Bases) {
+    unsigned long long x = PowMod(base, odd, Value);
+
+    if (x == 1 || x == Value - 1) {
+      continue;
+    }
+
+    bool composite = true;
+
+    for (unsigned i = 1; i < twos && composite; i++) {
+      x = MulMod(x, x, Value);
+      composite = x != Value - 1;
+    }
+
+    if (composite) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+unsigned long long GetClosestPrime64(unsigned long long Value) {
+  if (Value <= MaxPrime) {
+    return GetClosestPrime(static_cast<unsigned>(Value));
+  }
+
+  // The largest 64 bit prime, there are none above it.
+  const unsigned long long LastPrime = 18446744073709551557ULL;
+
+  if (Value >= LastPrime) {
+    return LastPrime;
+  }
+
+  unsigned long long prime = Value | 1;
+
+  while (!IsPrime64(prime)) {
+    prime += 2;
+  }
+
   return prime;
 }
+
+unsigned long long GetGrownTableSize(
+  unsigned long long TableSize,
+  double GrowthFactor
+) {
+  double new_factor = std::ceil(static_cast<double>(TableSize) * GrowthFactor);
+
+  // Saturate instead of overflowing the conversion, callers check the limit.
+  if (new_factor >= 18446744073709551615.0) {
+    return GetClosestPrime64(~0ULL);
+  }
+
+  return GetClosestPrime64(static_cast<unsigned long long>(new_factor));
+}
+
+unsigned long long GetFullHash(const char* Key) {
+  // 64 bit FNV-1a
+  unsigned long long hash = 14695981039346656037ULL;
+
+  while (*Key) {
+    hash ^= static_cast<unsigned char>(*Key);
+    hash *= 1099511628211ULL;
+    Key++;
+  }
+
+  return hash;
+}
+
+#ifdef __linux__
+// From <numaif.h>, which comes with libnuma and isn't always installed.
+const int MPOL_PREFERRED_MODE = 1;
+const int MPOL_INTERLEAVE_MODE = 3;
+const unsigned long MPOL_F_MEMS_ALLOWED_FLAG = 1UL << 2;
+
+// Room for 1024 nodes, the kernel rejects masks shorter than its own.
+const unsigned long NODE_MASK_BITS = 1024;
+const unsigned long NODE_MASK_WORDS = NODE_MASK_BITS / (8 * sizeof(long));
+#endif
+
+std::vector<unsigned> GetNumaNodes() {
+  std::vector<unsigned> nodes;
+
+#ifdef __linux__
+  unsigned long mask[NODE_MASK_WORDS] = {};
+  const long result = syscall(
+    SYS_get_mempolicy,
+    nullptr,
+    mask,
+    NODE_MASK_BITS,
+    nullptr,
+    MPOL_F_MEMS_ALLOWED_FLAG
+  );
+
+  if (result == 0) {
+    for (unsigned node = 0; node < NODE_MASK_BITS; node++) {
+      if (mask[node / (8 * sizeof(long))] >> (node % (8 * sizeof(long))) & 1) {
+        nodes.push_back(node);
+      }
+    }
+  }
+#endif
+
+  if (nodes.empty()) {
+    nodes.push_back(0);
+  }
+
+  return nodes;
+}
+
+unsigned GetCurrentNumaNode() {
+#ifdef __linux__
+  unsigned cpu = 0;
+  unsigned node = 0;
+
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return node;
+  }
+#endif
+
+  return 0;
+}
+
+void* AllocateNumaMemory(std::size_t Bytes, int Node) {
+#ifdef __linux__
+  void* memory = mmap(
+    nullptr,
+    Bytes == 0 ? 1 : Bytes,
+    PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS,
+    -1,
+    0
+  );
+
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+
+  const std::vector<unsigned> nodes = GetNumaNodes();
+
+  // Nothing to spread over or pick from on a single node.
+  if (nodes.size() > 1) {
+    unsigned long mask[NODE_MASK_WORDS] = {};
+
+    for (unsigned node : nodes) {
+      if (Node < 0 || node == static_cast<unsigned>(Node)) {
+        mask[node / (8 * sizeof(long))] |= 1UL << (node % (8 * sizeof(long)));
+      }
+    }
+
+    // The pages aren't touched yet, so they land where the policy says.
+    syscall(
+      SYS_mbind,
+      memory,
+      Bytes == 0 ? 1 : Bytes,
+      Node < 0 ? MPOL_INTERLEAVE_MODE : MPOL_PREFERRED_MODE,
+      mask,
+      NODE_MASK_BITS,
+      0
+    );
+  }
+
+  return memory;
+#else
+  static_cast<void>(Node);
+  return ::operator new(Bytes, std::nothrow);
+#endif
+}
+
+void FreeNumaMemory(void* Memory, std::size_t Bytes) {
+  if (Memory == nullptr) {
+    return;
+  }
+
+#ifdef __linux__
+  munmap(Memory, Bytes == 0 ? 1 : Bytes);
+#else
+  static_cast<void>(Bytes);
+  ::operator delete(Memory);
+#endif
+}
@@ -3,6 +3,51 @@
 #define SUPPORTH
 //---------------------------------------------------------------------------
 
+#include <cstddef>
+#include <vector>
+
 unsigned GetClosestPrime(unsigned Value);
+unsigned long long GetClosestPrime64(unsigned long long Value);
+unsigned long long GetGrownTableSize(
+  unsigned long long TableSize,
+  double GrowthFactor
+);
+unsigned long long GetFullHash(const char* Key);
+unsigned long long MulMod(
+  unsigned long long a,
+  unsigned long long b,
+  unsigned long long m
+);
+
+// The NUMA nodes this process may allocate on ({0} without NUMA support).
+std::vector<unsigned> GetNumaNodes();
+// The node of the CPU the calling thread runs on (0 if it can't be told).
+unsigned GetCurrentNumaNode();
+// Page aligned memory interleaved over every node (Node < 0) or preferring one.
+// The policy is best effort, the memory is still returned if it can't be set.
+void* AllocateNumaMemory(std::size_t Bytes, int Node);
+void FreeNumaMemory(void* Memory, std::size_t Bytes);
+
+// GetClosestPrime for sizes known at compile time (by trial division).
+constexpr unsigned GetConstexprClosestPrime(unsigned Value) {
+  if (Value <= 2) {
+    return 2;
+  }
+
+  for (unsigned prime = Value | 1;; prime += 2) {
+    bool is_prime = true;
+
+    for (unsigned divisor = 3; divisor <= prime / divisor; divisor += 2) {
+      if (prime % divisor == 0) {
+        is_prime = false;
+        break;
+      }
+    }
+
+    if (is_prime) {
+      return prime;
+    }
+  }
+}
 
 #endif
@@ -0,0 +1,538 @@
+/**
+ * @file bench.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Microbenchmarks for OAHashTable. Every combination of the options is
+ * run through the insert, find-hit, find-miss, remove and mixed workloads (and
+ * find-hit again with pre-hashed keys and on the frozen table) and the results
+ * are written to stdout as JSON (progress goes to stderr).
+ *
+ * Usage: bench [options], every option takes a comma separated list.
+ * - `--sizes` Elements per run (default 1000,100000,1000000). 100000000 needs
+ * about 10 GB.
+ * - `--load-factors` MaxLoadFactor_ values (default 0.5,0.75,0.9).
+ * - `--growth-factors` GrowthFactor_ values (default 1.5,2).
+ * - `--policies` MARK and/or PACK (default MARK,PACK).
+ * - `--hashes` primary:secondary pairs from HASHFUNCS (default
+ * PJW:NONE,UNIVERSAL:NONE,PJW:RS,RS:UNIVERSAL).
+ * - `--bloom-bits` Bits per key of the prefilter, 0 for none (default 0).
+ * - `--full-width` 0 to place keys with the hash functions, 1 to use their
+ * full width hash instead (default 0).
+ * - `--bucket-slots` Slots per bucket for bucketized probing, 0 for none
+ * (default 0).
+ * - `--perf` Also read the hardware counters (cycles, instructions, cache,
+ * branch and dTLB misses) around every workload, reported per operation.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Bench.h"
+#include "HashFuncs.h"
+#include "OAFrozenHashTable.h"
+#include "OAHashTable.h"
+
+//! The table every run starts with, so the growth is part of the inserts.
+const unsigned INITIAL_TABLE_SIZE = 97;
+
+//! The most misses looked up per run, since every miss throws.
+const std::size_t MAX_MISS_OPS = 1 << 16;
+
+//! The table being measured
+typedef OAHashTable<int> Table;
+
+/**
+ * @brief One combination of the options.
+ */
+struct BenchConfig {
+  unsigned Size_;             //!< Amount of elements
+  double MaxLoadFactor_;      //!< Maximum LF before growing
+  double GrowthFactor_;       //!< The amount to grow the table
+  OAHTDeletionPolicy Policy_; //!< MARK or PACK
+  unsigned Primary_;          //!< Index into HashingFuncs
+  unsigned Secondary_;        //!< Index into HashingFuncs
+  unsigned BloomBits_;        //!< Prefilter bits per key
+  bool FullWidth_;            //!< Place keys by their full width hash
+  unsigned BucketSlots_;      //!< Slots per probed bucket
+};
+
+/**
+ * @brief Every value of every option.
+ */
+struct BenchSweep {
+  std::vector<unsigned> Sizes_{1000, 100000, 1000000};   //!< Elements
+  std::vector<double> LoadFactors_{0.5, 0.75, 0.9};      //!< Max LFs
+  std::vector<double> GrowthFactors_{1.5, 2.0};          //!< Growth factors
+  std::vector<OAHTDeletionPolicy> Policies_{MARK, PACK}; //!< Policies
+
+  //! Primary and secondary hash functions, as indices into HashingFuncs
+  std::vector<std::pair<unsigned, unsigned>> Hashes_{
+    {PJW, NONE}, {UNIVERSAL, NONE}, {PJW, RS}, {RS, UNIVERSAL}
+  };
+
+  std::vector<unsigned> BloomBits_{0};   //!< Prefilter bits per key
+  std::vector<bool> FullWidth_{false};   //!< Full width hashing or not
+  std::vector<unsigned> BucketSlots_{0}; //!< Slots per probed bucket
+  bool Perf_{false};                     //!< Read the hardware counters
+};
+
+/**
+ * @brief Prints how to use the tool and exits.
+ *
+ * @param Program The name of the program.
+ */
+void Usage(const char* Program) {
+  std::cerr << "Usage: " << Program << " [--sizes N,...]"
+            << " [--load-factors LF,...] [--growth-factors GF,...]"
+            << " [--policies MARK,PACK] [--hashes PRIMARY:SECONDARY,...]"
+            << " [--bloom-bits N,...] [--full-width 0,1]"
+            << " [--bucket-slots N,...] [--perf]\n";
+  std::exit(1);
+}
+
+/**
+ * @brief Splits a comma separated list.
+ *
+ * @param List The list.
+ * @return The items.
+ */
+std::vector<std::string> Split(const std::string& List) {
+  std::vector<std::string> items;
+  std::stringstream stream(List);
+  std::string item;
+
+  while (std::getline(stream, item, ',')) {
+    items.push_back(item);
+  }
+
+  return items;
+}
+
+/**
+ * @brief Finds a hash function by name.
+ *
+ * @param Name The name, as in HashingFuncLabels.
+ * @param Program The name of the program, for the usage.
+ * @return The index into HashingFuncs.
+ */
+unsigned GetHash(const std::string& Name, const char* Program) {
+  const int hash = FindHashingFunc(Name.c_str());
+
+  if (hash < 0) {
+    std::cerr << "Unknown hash function " << Name << "\n";
+    Usage(Program);
+  }
+
+  return static_cast<unsigned>(hash);
+}
+
+/**
+ * @brief Reads the command line.
+ *
+ * @param argc The amount of arguments.
+ * @param argv The arguments.
+ * @return The values to sweep over.
+ */
+BenchSweep ParseSweep(int argc, char** argv) {
+  BenchSweep sweep;
+
+  for (int i = 1; i < argc; i += 2) {
+    // The only option without a value.
+    if (std::strcmp(argv[i], "--perf") == 0) {
+      sweep.Perf_ = true;
+      i--;
+      continue;
+    }
+
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+    }
+
+    const std::string option = argv[i];
+    const std::vector<std::string> values = Split(argv[i + 1]);
+
+    if (option == "--sizes") {
+      sweep.Sizes_.clear();
+      for (const std::string& value : values) {
+        sweep.Sizes_.push_back(
+          static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10))
+        );
+      }
+    } else if (option == "--load-factors") {
+      sweep.LoadFactors_.clear();
+      for (const std::string& value : values) {
+        sweep.LoadFactors_.push_back(std::strtod(value.c_str(), nullptr));
+      }
+    } else if (option == "--growth-factors") {
+      sweep.GrowthFactors_.clear();
+      for (const std::string& value : values) {
+        sweep.GrowthFactors_.push_back(std::strtod(value.c_str(), nullptr));
+      }
+    } else if (option == "--policies") {
+      sweep.Policies_.clear();
+      for (const std::string& value : values) {
+        if (value != "MARK" && value != "PACK") {
+          Usage(argv[0]);
+        }
+        sweep.Policies_.push_back(value == "MARK" ? MARK : PACK);
+      }
+    } else if (option == "--bloom-bits") {
+      sweep.BloomBits_.clear();
+      for (const std::string& value : values) {
+        sweep.BloomBits_.push_back(
+          static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10))
+        );
+      }
+    } else if (option == "--full-width") {
+      sweep.FullWidth_.clear();
+      for (const std::string& value : values) {
+        if (value != "0" && value != "1") {
+          Usage(argv[0]);
+        }
+        sweep.FullWidth_.push_back(value == "1");
+      }
+    } else if (option == "--bucket-slots") {
+      sweep.BucketSlots_.clear();
+      for (const std::string& value : values) {
+        sweep.BucketSlots_.push_back(
+          static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10))
+        );
+      }
+    } else if (option == "--hashes") {
+      sweep.Hashes_.clear();
+      for (const std::string& value : values) {
+        const std::size_t colon = value.find(':');
+
+        if (colon == std::string::npos) {
+          Usage(argv[0]);
+        }
+
+        sweep.Hashes_.emplace_back(
+          GetHash(value.substr(0, colon), argv[0]),
+          GetHash(value.substr(colon + 1), argv[0])
+        );
+      }
+    } else {
+      Usage(argv[0]);
+    }
+  }
+
+  return sweep;
+}
+
+/**
+ * @brief Runs an operation a number of times and measures the time, the
+ * probes and the hardware counters it took.
+ *
+ * @param table The table the operation works on.
+ * @param counters The hardware counters (may have none open).
+ * @param Ops The amount of times to run it.
+ * @param op Called with the number of the operation.
+ * @return The measurements.
+ */
+template<typename Engine, typename F>
+BenchResult Measure(
+  const Engine& table,
+  BenchCounters& counters,
+  std::size_t Ops,
+  F op
+) {
+  BenchResult result;
+  const std::uint64_t probes = table.GetStats().Probes_;
+  BenchTimer timer;
+  counters.start();
+
+  for (std::size_t i = 0; i < Ops; i++) {
+    op(i);
+  }
+
+  counters.stop(result);
+  result.Seconds_ = timer.Seconds();
+  result.Ops_ = Ops;
+  result.Probes_ = table.GetStats().Probes_ - probes;
+
+  return result;
+}
+
+/**
+ * @brief Writes the result of a workload as a member of the JSON object.
+ *
+ * @param out Where to write.
+ * @param Name The name of the workload.
+ * @param Result The result.
+ */
+void WriteWorkload(
+  std::ostream& out,
+  const char* Name,
+  const BenchResult& Result
+) {
+  out << ",\n      \"" << Name << "\": ";
+  WriteBenchResult(out, Result);
+}
+
+/**
+ * @brief Writes what a table costs as a member of the JSON object.
+ *
+ * @param out Where to write.
+ * @param Memory The breakdown.
+ */
+void WriteMemory(std::ostream& out, const OAHTMemory& Memory) {
+  out << ",\n      \"memory\": {\"slot_bytes\": " << Memory.SlotBytes_
+      << ", \"table_bytes\": " << Memory.TableBytes_
+      << ", \"payload_bytes\": " << Memory.PayloadBytes_
+      << ", \"overhead_bytes\": " << Memory.OverheadBytes_
+      << ", \"unused_bytes\": " << Memory.UnusedBytes_
+      << ", \"extra_bytes\": " << Memory.ExtraBytes_
+      << ", \"total_bytes\": " << Memory.TotalBytes_
+      << ", \"bytes_per_entry\": " << Memory.BytesPerEntry_ << "}";
+}
+
+/**
+ * @brief Runs every workload for one combination of the options.
+ *
+ * @param Config The combination.
+ * @param hits Keys that are inserted.
+ * @param misses Keys that are never inserted, except by the mixed workload.
+ * @param counters The hardware counters (may have none open).
+ * @param out Where to write the JSON object.
+ */
+void RunConfig(
+  const BenchConfig& Config,
+  const BenchKeys& hits,
+  const BenchKeys& misses,
+  BenchCounters& counters,
+  std::ostream& out
+) {
+  const Table::OAHTConfig config(
+    INITIAL_TABLE_SIZE,
+    HashingFuncs[Config.Primary_].Fn,
+    HashingFuncs[Config.Secondary_].Fn,
+    Config.MaxLoadFactor_,
+    Config.GrowthFactor_,
+    Config.Policy_,
+    nullptr,
+    Config.BloomBits_,
+    0,
+    Config.FullWidth_,
+    NUMA_DEFAULT,
+    0,
+    Config.BucketSlots_
+  );
+
+  const std::size_t size = Config.Size_;
+  volatile int sink = 0;
+
+  out << "    {\"size\": " << size
+      << ", \"max_load_factor\": " << Config.MaxLoadFactor_
+      << ", \"growth_factor\": " << Config.GrowthFactor_
+      << ", \"policy\": \"" << (Config.Policy_ == MARK ? "MARK" : "PACK")
+      << "\", \"primary\": \"" << HashingFuncLabels[Config.Primary_]
+      << "\", \"secondary\": \"" << HashingFuncLabels[Config.Secondary_]
+      << "\", \"bloom_bits\": " << Config.BloomBits_
+      << ", \"full_width\": " << (Config.FullWidth_ ? "true" : "false")
+      << ", \"bucket_slots\": " << Config.BucketSlots_;
+
+  try {
+    Table table(config);
+
+    const BenchResult insert =
+      Measure(table, counters, size, [&](std::size_t i) {
+        table.insert(hits[i], 0);
+      });
+    WriteWorkload(out, "insert", insert);
+
+    const OAHTStats grown = table.GetStats();
+    out << ",\n      \"table_size\": " << grown.TableSize_
+        << ", \"expansions\": " << grown.Expansions_;
+    WriteMemory(out, grown.Memory_);
+
+    const BenchResult find_hit =
+      Measure(table, counters, size, [&](std::size_t i) {
+        sink = sink + table.find(hits[i]);
+      });
+    WriteWorkload(out, "find_hit", find_hit);
+
+    // The same lookups with the keys hashed beforehand
+    std::vector<OAHashedKey> hashed;
+    hashed.reserve(size);
+    for (std::size_t i = 0; i < size; i++) {
+      hashed.emplace_back(hits[i]);
+    }
+
+    const BenchResult hashed_find_hit =
+      Measure(table, counters, size, [&](std::size_t i) {
+        sink = sink + table.find(hashed[i]);
+      });
+    WriteWorkload(out, "hashed_find_hit", hashed_find_hit);
+
+    // The same lookups once the table is frozen
+    const OAFrozenHashTable<int> frozen(table);
+    const BenchResult frozen_find_hit =
+      Measure(frozen, counters, size, [&](std::size_t i) {
+        sink = sink + frozen.find(hits[i]);
+      });
+    WriteWorkload(out, "frozen_find_hit", frozen_find_hit);
+    out << ",\n      \"frozen_bytes_per_entry\": "
+        << frozen.memory_usage().BytesPerEntry_;
+
+    const std::size_t miss_ops = std::min(size, MAX_MISS_OPS);
+    const BenchResult find_miss =
+      Measure(table, counters, miss_ops, [&](std::size_t i) {
+        try {
+          sink = sink + table.find(misses[i]);
+        } catch (const OAHashTableException&) {
+          // The miss is what is being measured.
+        }
+      });
+    WriteWorkload(out, "find_miss", find_miss);
+
+    const BenchResult remove =
+      Measure(table, counters, size, [&](std::size_t i) {
+        table.remove(hits[i]);
+      });
+    WriteWorkload(out, "remove", remove);
+
+    // 80% finds, 10% inserts of new keys and 10% removes of the oldest keys,
+    // over a table that starts full.
+    Table mixed(config);
+    for (std::size_t i = 0; i < size; i++) {
+      mixed.insert(hits[i], 0);
+    }
+
+    std::size_t removed = 0;
+    std::size_t inserted = 0;
+    unsigned random = 280;
+
+    const BenchResult mixed_ops =
+      Measure(mixed, counters, size, [&](std::size_t) {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+
+        const unsigned roll = random % 10;
+
+        if (roll == 0) {
+          mixed.insert(misses[inserted++], 0);
+        } else if (roll == 1 && removed + 1 < size) {
+          mixed.remove(hits[removed++]);
+        } else {
+          std::size_t live = size - removed;
+          sink = sink + mixed.find(hits[removed + (random >> 4) % live]);
+        }
+      });
+    WriteWorkload(out, "mixed", mixed_ops);
+
+    // Half of the keys merged into a table with another half, a quarter of
+    // them in both. One operation per element of the merged table.
+    Table merged(config);
+    Table other(config);
+    for (std::size_t i = 0; i < size / 2; i++) {
+      merged.insert(hits[i], 0);
+      other.insert(hits[i + size / 4], 0);
+    }
+
+    BenchResult merge = Measure(merged, counters, 1, [&](std::size_t) {
+      merged.merge_from(other, [](const char*, const int& Mine, const int&) {
+        return Mine;
+      });
+    });
+    merge.Ops_ = size / 2;
+    WriteWorkload(out, "merge", merge);
+  } catch (const OAHashTableException& exception) {
+    out << ",\n      \"error\": ";
+    WriteJsonString(out, exception.what());
+  }
+
+  out << "}";
+}
+
+/**
+ * @brief Every combination of the values to sweep over.
+ *
+ * @param Sweep The values.
+ * @return The combinations, in the order they're run.
+ */
+std::vector<BenchConfig> GetConfigs(const BenchSweep& Sweep) {
+  std::vector<BenchConfig> configs;
+
+  for (unsigned size : Sweep.Sizes_) {
+    for (double load_factor : Sweep.LoadFactors_) {
+      for (double growth_factor : Sweep.GrowthFactors_) {
+        for (OAHTDeletionPolicy policy : Sweep.Policies_) {
+          for (const std::pair<unsigned, unsigned>& hash : Sweep.Hashes_) {
+            for (unsigned bloom_bits : Sweep.BloomBits_) {
+              for (bool full_width : Sweep.FullWidth_) {
+                for (unsigned bucket_slots : Sweep.BucketSlots_) {
+                  configs.push_back(BenchConfig{
+                    size,
+                    load_factor,
+                    growth_factor,
+                    policy,
+                    hash.first,
+                    hash.second,
+                    bloom_bits,
+                    full_width,
+                    bucket_slots
+                  });
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return configs;
+}
+
+int main(int argc, char** argv) {
+  const BenchSweep sweep = ParseSweep(argc, argv);
+  unsigned largest = 0;
+
+  for (unsigned size : sweep.Sizes_) {
+    largest = std::max(largest, size);
+  }
+
+  const BenchKeys hits(0, largest);
+  const BenchKeys misses(largest, largest);
+  BenchCounters counters(sweep.Perf_);
+  bool first = true;
+
+  if (sweep.Perf_ && !counters.available()) {
+    std::cerr << "Couldn't open any hardware counter (see"
+              << " /proc/sys/kernel/perf_event_paranoid)\n";
+  }
+
+  std::cout << "{\n  \"benchmark\": \"OAHashTable\",\n  \"results\": [\n";
+
+  for (const BenchConfig& config : GetConfigs(sweep)) {
+    std::cerr << "size " << config.Size_ << " lf " << config.MaxLoadFactor_
+              << " gf " << config.GrowthFactor_ << " "
+              << (config.Policy_ == MARK ? "MARK" : "PACK") << " "
+              << HashingFuncLabels[config.Primary_] << ":"
+              << HashingFuncLabels[config.Secondary_] << " bloom "
+              << config.BloomBits_ << " full width " << config.FullWidth_
+              << " bucket slots " << config.BucketSlots_ << "\n";
+
+    if (!first) {
+      std::cout << ",\n";
+    }
+    first = false;
+
+    RunConfig(config, hits, misses, counters, std::cout);
+    std::cout.flush();
+  }
+
+  std::cout << "\n  ]\n}\n";
+
+  return 0;
+}
@@ -0,0 +1,505 @@
+/**
+ * @file checks.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Checks the features of OAHashTable the drivers don't reach, against
+ * results worked out by hand. Every check is registered with ctest.
+ *
+ * Usage: checks NAME
+ * - `NAME` The check to run (see CHECKS).
+ *
+ * Prints what went wrong and exits with 1 if the check fails.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HashFuncs.h"
+#include "OAFrozenHashTable.h"
+#include "OAHashTable.h"
+#include "OAReplicatedHashTable.h"
+
+//! Whether any check failed
+bool failed = false;
+
+/**
+ * @brief Records a failed check.
+ *
+ * @param ok Whether the check passed.
+ * @param What What was checked.
+ */
+void Expect(bool ok, const char* What) {
+  if (!ok) {
+    std::cerr << "FAILED: " << What << std::endl;
+    failed = true;
+  }
+}
+
+/**
+ * @brief Whether a table has a key, by find.
+ *
+ * @param Table The table.
+ * @param Key The key.
+ * @return Whether find returned it.
+ */
+template<typename Container>
+bool Has(const Container& Table, const char* Key) {
+  try {
+    Table.find(Key);
+    return true;
+  } catch (const OAHashTableException&) {
+    return false;
+  }
+}
+
+/**
+ * @brief Every key hashes to the same home, so they all sit on one probe
+ * path.
+ *
+ * @return Always 0.
+ */
+unsigned SameHome(const char*, unsigned) {
+  return 0;
+}
+
+//! Long enough for anything the checks do between an insert and a lookup
+const std::chrono::hours LONG_TTL(1);
+
+//! Short enough to wait out, long enough for the checks before it expires
+const std::chrono::milliseconds SHORT_TTL(200);
+
+//! Comfortably past SHORT_TTL and a tick of the timing wheel
+const std::chrono::milliseconds WAIT(300);
+
+/**
+ * @brief Elements with a TTL are found until they expire, and absent from
+ * find, for_each and the iterators afterwards, without anything writing to
+ * the table. Then a remove, an insert of the same key, an insert whose probe
+ * path crosses them and expire() each reclaim them.
+ *
+ * @param Policy The deletion policy.
+ * @param Bloom Prefilter bits per key, 0 for none.
+ */
+void CheckTtl(OAHTDeletionPolicy Policy, unsigned Bloom) {
+  typedef OAHashTable<int> Table;
+
+  Table table(Table::OAHTConfig(17, SameHome, nullptr, 0.9, 2.0, Policy,
+                                nullptr, Bloom));
+
+  table.insert("short1", 1, SHORT_TTL);
+  table.insert("long", 2, LONG_TTL);
+  table.insert("short2", 3, SHORT_TTL);
+  table.insert("forever", 4);
+
+  Expect(Has(table, "short1") && table.find("short2") == 3, "ttl found");
+
+  std::this_thread::sleep_for(WAIT);
+
+  Expect(!Has(table, "short1") && !Has(table, "short2"), "ttl expired");
+  Expect(table.find("long") == 2 && table.find("forever") == 4, "ttl kept");
+
+  unsigned visited = 0;
+  table.for_each([&visited](const char* Key, const int&) {
+    Expect(strncmp(Key, "short", 5) != 0, "ttl for_each visits expired");
+    visited++;
+  });
+  Expect(visited == 2, "ttl for_each count");
+
+  visited = 0;
+  for (const Table::OAHTSlot& slot : table) {
+    Expect(strncmp(slot.Key, "short", 5) != 0, "ttl iterator visits expired");
+    visited++;
+  }
+  Expect(visited == 2, "ttl iterator count");
+
+  // Nothing wrote to the table, the expired elements are still in it.
+  Expect(table.GetStats().Count_ == 4, "ttl reclaimed by a read");
+  Expect(table.GetStats().Expirations_ == 0, "ttl expirations by a read");
+
+  // A remove of an expired key reclaims it and doesn't find it.
+  try {
+    table.remove("short1");
+    Expect(false, "ttl removed an expired key");
+  } catch (const OAHashTableException& exception) {
+    Expect(
+      exception.code() == OAHashTableException::E_ITEM_NOT_FOUND,
+      "ttl remove exception"
+    );
+  }
+
+  Expect(table.GetStats().Count_ == 2, "ttl count after remove");
+  Expect(table.GetStats().Expirations_ == 2, "ttl expirations after remove");
+
+  // The same key can be inserted again, on the path the old one was on.
+  table.insert("short1", 5, SHORT_TTL);
+  table.insert("short2", 6, SHORT_TTL);
+  Expect(table.find("short1") == 5, "ttl reinserted");
+
+  std::this_thread::sleep_for(WAIT);
+
+  // Another key on the same path gets past them and reclaims them.
+  table.insert("new", 7);
+  Expect(table.find("new") == 7, "ttl insert past expired");
+  Expect(table.GetStats().Count_ == 3, "ttl count after insert");
+  Expect(table.GetStats().Expirations_ == 4, "ttl expirations after insert");
+  Expect(table.GetStats().TableSize_ == 17, "ttl grew for expired elements");
+
+  // The wheel reclaims what nothing looked up.
+  table.insert("wheel1", 8, SHORT_TTL);
+  table.insert("wheel2", 9, SHORT_TTL);
+
+  std::this_thread::sleep_for(WAIT);
+
+  Expect(table.expire() == 2, "ttl wheel sweep");
+  Expect(table.GetStats().Count_ == 3, "ttl count after sweep");
+  Expect(table.expire() == 0, "ttl wheel sweeps twice");
+  Expect(table.find("long") == 2, "ttl wheel kept the long ttl");
+}
+
+/**
+ * @brief CheckTtl with every deletion policy, with and without a prefilter.
+ */
+void CheckTtls() {
+  CheckTtl(OAHTDeletionPolicy::MARK, 0);
+  CheckTtl(OAHTDeletionPolicy::PACK, 0);
+  CheckTtl(OAHTDeletionPolicy::PACK, 10);
+}
+
+/**
+ * @brief Freezing a table leaves out what expired, and keeps what hasn't yet
+ * (without its TTL).
+ */
+void CheckFrozenTtl() {
+  typedef OAHashTable<int> Table;
+
+  Table table(Table::OAHTConfig(17, PJWHash));
+  table.insert("short", 1, SHORT_TTL);
+  table.insert("long", 2, LONG_TTL);
+  table.insert("forever", 3);
+
+  std::this_thread::sleep_for(WAIT);
+
+  const OAFrozenHashTable<int> frozen(table);
+  Expect(!Has(frozen, "short"), "frozen ttl expired");
+  Expect(frozen.find("long") == 2, "frozen ttl long");
+  Expect(frozen.find("forever") == 3, "frozen ttl forever");
+  Expect(frozen.GetStats().Count_ == 2, "frozen ttl count");
+}
+
+//! The replicated table whose data FreeReplicated frees
+const OAReplicatedHashTable<int*>* freeing = nullptr;
+
+//! The data inserted into freeing
+unsigned inserted = 0;
+
+//! The data FreeReplicated freed
+unsigned freed = 0;
+
+/**
+ * @brief Frees the data of a replicated table, and checks that no other
+ * replica has it anymore. The last replica frees it while holding its lock,
+ * so only the others are looked at: they must hold less than is still
+ * allocated.
+ *
+ * @param Data The data.
+ */
+void FreeReplicated(int* Data) {
+  const unsigned held = inserted - freed;
+
+  for (std::size_t i = 0; i + 1 < freeing->GetReplicaCount(); i++) {
+    Expect(
+      freeing->GetReplicaStats(i).Count_ < held,
+      "replicated freed while another replica has it"
+    );
+  }
+
+  delete Data;
+  freed++;
+}
+
+/**
+ * @brief Three replicas (all on the first node) share the data. Removing and
+ * clearing free every element exactly once, after every replica let go of it.
+ */
+void CheckReplicatedFree() {
+  typedef OAReplicatedHashTable<int*> Table;
+
+  Table::OAHTConfig config(17, PJWHash);
+  config.FreeProc_ = FreeReplicated;
+
+  const std::vector<unsigned> nodes(3, GetNumaNodes().front());
+  Table table(config, nodes);
+  freeing = &table;
+
+  for (int i = 0; i < 100; i++) {
+    table.insert(std::to_string(i).c_str(), new int(i));
+    inserted++;
+  }
+
+  try {
+    table.insert("7", nullptr);
+    Expect(false, "replicated duplicate inserted");
+  } catch (const OAHashTableException&) {
+    // The duplicate is caught by the first replica, nothing is freed.
+  }
+
+  for (int i = 0; i < 50; i++) {
+    table.remove(std::to_string(i).c_str());
+  }
+
+  Expect(freed == 50, "replicated freed by remove");
+  Expect(*table.find("75") == 75, "replicated data kept");
+
+  table.clear();
+  Expect(freed == 100, "replicated freed by clear");
+}
+
+//! The elements of a table, sorted by key
+typedef std::map<std::string, int> Contents;
+
+/**
+ * @brief The elements of a table, by for_each.
+ *
+ * @param Table The table.
+ * @return Its elements.
+ */
+template<typename Container>
+Contents GetContents(const Container& Table) {
+  Contents contents;
+
+  Table.for_each([&contents](const char* Key, const int& Data) {
+    contents[Key] = Data;
+  });
+
+  return contents;
+}
+
+/**
+ * @brief Keeps the sum of the data of a key in both tables.
+ *
+ * @return Mine + Theirs.
+ */
+int AddData(const char*, const int& Mine, const int& Theirs) {
+  return Mine + Theirs;
+}
+
+/**
+ * @brief merge_from, union_into, intersect_with and difference between a
+ * table and a smaller one, called on either. Both have elements that
+ * expired, which count as missing, and elements with a TTL that hasn't.
+ *
+ * @param BucketSlots Slots per probed bucket, 0 for none.
+ */
+template<typename I, typename I2>
+void CheckSetOps(std::size_t BucketSlots) {
+  typedef OAHashTable<int, I> Big;
+  typedef OAHashTable<int, I2> Small;
+
+  Big big(typename Big::OAHTConfig(7, PJWHash, nullptr, 0.5, 2.0,
+                                   OAHTDeletionPolicy::PACK, nullptr, 0, 0,
+                                   false, NUMA_DEFAULT, 0, BucketSlots));
+  Small small(typename Small::OAHTConfig(7, PJWHash, nullptr, 0.5, 2.0,
+                                         OAHTDeletionPolicy::PACK, nullptr, 0,
+                                         0, false, NUMA_DEFAULT, 0,
+                                         BucketSlots));
+
+  for (int i = 0; i < 10; i++) {
+    big.insert(("k" + std::to_string(i)).c_str(), i);
+  }
+
+  big.insert("k10", 10, SHORT_TTL);
+  big.insert("k11", 11, LONG_TTL);
+
+  small.insert("k0", 100, SHORT_TTL);
+  small.insert("k5", 105);
+  small.insert("k6", 106);
+  small.insert("k12", 112);
+  small.insert("k13", 113, SHORT_TTL);
+  small.insert("k14", 114, LONG_TTL);
+
+  // Merged before they expire, the short TTL of k13 comes along.
+  Big early(big);
+  early.merge_from(small, AddData);
+
+  std::this_thread::sleep_for(WAIT);
+
+  const Contents merged = {
+    {"k0", 0}, {"k1", 1}, {"k2", 2}, {"k3", 3}, {"k4", 4}, {"k5", 110},
+    {"k6", 112}, {"k7", 7}, {"k8", 8}, {"k9", 9}, {"k11", 11}, {"k12", 112},
+    {"k14", 114}
+  };
+  const Contents both = {{"k5", 110}, {"k6", 112}};
+
+  // k0 was in both, it was resolved into the element of big, without a TTL.
+  Contents early_merged = merged;
+  early_merged["k0"] = 100;
+  Expect(GetContents(early) == early_merged, "set ops merged ttl");
+
+  Big merged_big(big);
+  merged_big.merge_from(small, AddData);
+  Expect(GetContents(merged_big) == merged, "set ops big merge_from small");
+
+  Small merged_small(small);
+  merged_small.merge_from(big, AddData);
+  Expect(GetContents(merged_small) == merged, "set ops small merge_from big");
+
+  Big united(big);
+  small.union_into(united, AddData);
+  Expect(GetContents(united) == merged, "set ops small union_into big");
+
+  Small united_small(small);
+  big.union_into(united_small, AddData);
+  Expect(GetContents(united_small) == merged, "set ops big union_into small");
+
+  Big intersected_big(big);
+  intersected_big.intersect_with(small, AddData);
+  Expect(GetContents(intersected_big) == both, "set ops big intersect_with");
+
+  Small intersected_small(small);
+  intersected_small.intersect_with(big, AddData);
+  Expect(GetContents(intersected_small) == both, "set ops small intersect");
+
+  Big differed_big(big);
+  differed_big.difference(small);
+  Expect(
+    GetContents(differed_big) == Contents({
+      {"k0", 0}, {"k1", 1}, {"k2", 2}, {"k3", 3}, {"k4", 4}, {"k7", 7},
+      {"k8", 8}, {"k9", 9}, {"k11", 11}
+    }),
+    "set ops big difference small"
+  );
+
+  Small differed_small(small);
+  differed_small.difference(big);
+  Expect(
+    GetContents(differed_small) == Contents({{"k12", 112}, {"k14", 114}}),
+    "set ops small difference big"
+  );
+
+  Big self(big);
+  self.merge_from(self, AddData);
+  Expect(self.find("k3") == 6 && !Has(self, "k10"), "set ops merge itself");
+}
+
+//! The data FreeResolved freed
+unsigned resolved_freed = 0;
+
+/**
+ * @brief Frees the data of the tables CheckResolveFree merges into.
+ *
+ * @param Data The data.
+ */
+void FreeResolved(int* Data) {
+  delete Data;
+  resolved_freed++;
+}
+
+/**
+ * @brief Keeps Mine for "keep" and a new sum of both for the rest.
+ *
+ * @return The data kept.
+ */
+int* ResolveAlloc(const char* Key, int* const& Mine, int* const& Theirs) {
+  if (strcmp(Key, "keep") == 0) {
+    return Mine;
+  }
+
+  return new int(*Mine + *Theirs);
+}
+
+/**
+ * @brief The data Resolve replaces is freed, the data it keeps isn't.
+ */
+void CheckResolveFree() {
+  typedef OAHashTable<int*> Table;
+
+  Table::OAHTConfig config(7, PJWHash);
+  config.FreeProc_ = FreeResolved;
+
+  // Theirs is owned here, only the data of mine is freed.
+  int one = 1;
+  int two = 2;
+  Table theirs(Table::OAHTConfig(7, PJWHash));
+  theirs.insert("keep", &one);
+  theirs.insert("sum", &two);
+
+  Table merged(config);
+  merged.insert("keep", new int(10));
+  merged.insert("sum", new int(20));
+  merged.merge_from(theirs, ResolveAlloc);
+
+  Expect(resolved_freed == 1, "resolve freed by merge_from");
+  Expect(*merged.find("keep") == 10 && *merged.find("sum") == 22,
+         "resolve merged");
+
+  Table intersected(config);
+  intersected.insert("keep", new int(30));
+  intersected.insert("sum", new int(40));
+  intersected.insert("gone", new int(50));
+  intersected.intersect_with(theirs, ResolveAlloc);
+
+  Expect(resolved_freed == 3, "resolve freed by intersect_with");
+  Expect(*intersected.find("sum") == 42, "resolve intersected");
+
+  merged.clear();
+  intersected.clear();
+  Expect(resolved_freed == 7, "resolve freed by clear");
+}
+
+/**
+ * @brief CheckSetOps between tables of either instrumentation, with and
+ * without buckets.
+ */
+void CheckSetOpsAll() {
+  CheckSetOps<OAFullInstrumentation, OAFullInstrumentation>(0);
+  CheckSetOps<OAFullInstrumentation, OASampledInstrumentation>(4);
+  CheckSetOps<OASampledInstrumentation, OAFullInstrumentation>(0);
+}
+
+/**
+ * @brief A check that can be run.
+ */
+struct TableCheck {
+  const char* Name_; //!< Name on the command line
+  void (*Run_)();    //!< Runs the check
+};
+
+//! Every check, add new checks here and to CMakeLists.txt.
+const TableCheck CHECKS[] = {
+  {"ttl",             CheckTtls          },
+  {"frozen_ttl",      CheckFrozenTtl     },
+  {"replicated_free", CheckReplicatedFree},
+  {"set_ops",         CheckSetOpsAll     },
+  {"resolve_free",    CheckResolveFree   }
+};
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " NAME\nChecks:";
+
+    for (const TableCheck& check : CHECKS) {
+      std::cerr << ' ' << check.Name_;
+    }
+
+    std::cerr << std::endl;
+    return 1;
+  }
+
+  for (const TableCheck& check : CHECKS) {
+    if (strcmp(check.Name_, argv[1]) == 0) {
+      check.Run_();
+      return failed ? 1 : 0;
+    }
+  }
+
+  std::cerr << "Unknown check: " << argv[1] << std::endl;
+  return 1;
+}
@@ -0,0 +1,358 @@
+/**
+ * @file compare.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Runs the same workload against std::unordered_map and every engine in
+ * this project and writes throughput, p99 latency, peak RSS and bytes per
+ * entry as JSON. Every run happens in its own process so the memory numbers
+ * only belong to one engine.
+ *
+ * A run loads the keys and then does a mix of finds (of keys that are in the
+ * table), inserts of new keys and removes of the oldest keys. Latency is the
+ * time between two consecutive timestamps, so it includes one clock read.
+ *
+ * Usage: compare [options], every option takes a comma separated list.
+ * - `--engines` Engines to run (default all, see ENGINES).
+ * - `--sizes` Elements loaded (default 100000,1000000).
+ * - `--read-percents` Share of finds in the mix (default 50,90,99). The rest
+ * is split evenly between inserts and removes.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Bench.h"
+#include "HashFuncs.h"
+#include "BenchEngines.h"
+
+//! The table every engine starts with, so the growth is part of the load.
+const unsigned INITIAL_TABLE_SIZE = 97;
+
+/**
+ * @brief The configuration every engine is built with.
+ *
+ * @param Policy MARK or PACK.
+ * @return The configuration.
+ */
+EngineConfig GetConfig(OAHTDeletionPolicy Policy) {
+  return EngineConfig(INITIAL_TABLE_SIZE, PJWHash, 0, 0.5, 2.0, Policy);
+}
+
+/**
+ * @brief What a single run should do.
+ */
+struct CompareRun {
+  std::size_t Size_;          //!< Amount of elements loaded
+  unsigned ReadPercent_;      //!< Share of finds in the mix
+  OAHTDeletionPolicy Policy_; //!< MARK or PACK
+};
+
+/**
+ * @brief Loads the keys and runs the mix, writing the results as the members
+ * of a JSON object.
+ *
+ * @param Run What to do.
+ * @param out Where to write.
+ */
+template<typename Engine>
+void RunEngine(const CompareRun& Run, std::ostream& out) {
+  const std::size_t size = Run.Size_;
+  const BenchKeys keys(0, size);
+  const BenchKeys fresh(size, size);
+  std::vector<unsigned> latencies(size);
+  volatile BenchValue sink = 0;
+
+  const std::size_t before = GetResidentBytes();
+  Engine engine(GetConfig(Run.Policy_));
+
+  // Load
+  BenchTimer load_timer;
+  for (std::size_t i = 0; i < size; i++) {
+    engine.insert(keys[i], static_cast<BenchValue>(i));
+  }
+  const double load_seconds = load_timer.Seconds();
+  const std::size_t after = GetResidentBytes();
+
+  // Mix
+  std::size_t removed = 0;
+  std::size_t inserted = 0;
+  unsigned random = 280;
+
+  auto previous = std::chrono::steady_clock::now();
+  const auto start = previous;
+
+  for (std::size_t i = 0; i < size; i++) {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+
+    const unsigned roll = random % 100;
+
+    if (roll >= Run.ReadPercent_ && roll % 2 == 0) {
+      engine.insert(fresh[inserted++], 0);
+    } else if (roll >= Run.ReadPercent_ && removed + 1 < size) {
+      engine.remove(keys[removed++]);
+    } else {
+      const std::size_t live = size - removed;
+      sink = sink + engine.find(keys[removed + (random >> 7) % live]);
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    latencies[i] = static_cast<unsigned>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now - previous)
+        .count()
+    );
+    previous = now;
+  }
+
+  std::chrono::duration<double> mix_seconds = previous - start;
+
+  BenchResult load;
+  load.Ops_ = size;
+  load.Seconds_ = load_seconds;
+  load.Probes_ = -1;
+
+  BenchResult mix;
+  mix.Ops_ = size;
+  mix.Seconds_ = mix_seconds.count();
+  mix.Probes_ = -1;
+
+  out << "\"load\": ";
+  WriteBenchResult(out, load);
+  out << ", \"mix\": ";
+  WriteBenchResult(out, mix);
+  out << ", \"p50_ns\": " << GetPercentile(latencies, 50)
+      << ", \"p99_ns\": " << GetPercentile(latencies, 99)
+      << ", \"p999_ns\": " << GetPercentile(latencies, 99.9)
+      << ", \"bytes_per_entry\": "
+      << (after > before ? static_cast<double>(after - before) / size : 0.0);
+}
+
+/**
+ * @brief An engine that can be compared.
+ */
+struct CompareEngine {
+  const char* Name_;                              //!< Name on the command line
+  void (*Run_)(const CompareRun&, std::ostream&); //!< Runs the engine
+  OAHTDeletionPolicy Policy_;                     //!< MARK or PACK
+};
+
+//! Every engine, add new engine modes here.
+const CompareEngine ENGINES[] = {
+  {"unordered_map",   RunEngine<UnorderedMapEngine>,                 PACK},
+  {"oa_full_pack",    RunEngine<OAEngine<OAFullInstrumentation>>,    PACK},
+  {"oa_full_mark",    RunEngine<OAEngine<OAFullInstrumentation>>,    MARK},
+  {"oa_sampled_pack", RunEngine<OAEngine<OASampledInstrumentation>>, PACK},
+  {"oa_none_pack",    RunEngine<OAEngine<OANoInstrumentation>>,      PACK},
+  {"oa_none_mark",    RunEngine<OAEngine<OANoInstrumentation>>,      MARK},
+  {"oa_interleave",   RunEngine<InterleavedEngine>,                  PACK},
+  {"sharded",         RunEngine<ShardedEngine>,                      PACK},
+  {"replicated",      RunEngine<ReplicatedEngine>,                   PACK},
+  {"seqlock",         RunEngine<SeqlockEngine>,                      MARK},
+  {"snapshot",        RunEngine<SnapshotEngine>,                     MARK},
+  {"lockfree",        RunEngine<LockFreeEngine>,                     MARK}
+};
+
+/**
+ * @brief Runs an engine in a child process and writes its results, with the
+ * peak RSS of the child, as a JSON object.
+ *
+ * @param Engine The engine.
+ * @param Run What to do.
+ * @param out Where to write.
+ */
+void RunIsolated(
+  const CompareEngine& Engine,
+  const CompareRun& Run,
+  std::ostream& out
+) {
+  int channel[2];
+
+  out << "    {\"engine\": \"" << Engine.Name_ << "\", \"size\": " << Run.Size_
+      << ", \"read_percent\": " << Run.ReadPercent_ << ", ";
+
+  if (pipe(channel) != 0) {
+    out << "\"error\": \"pipe failed\"}";
+    return;
+  }
+
+  const pid_t child = fork();
+
+  if (child == 0) {
+    std::ostringstream result;
+    result << std::fixed;
+
+    try {
+      Engine.Run_(Run, result);
+    } catch (const OAHashTableException& exception) {
+      result.str("");
+      result << "\"error\": ";
+      WriteJsonString(result, exception.what());
+    }
+
+    const std::string text = result.str();
+    std::size_t written = 0;
+
+    while (written < text.size()) {
+      const ssize_t count =
+        write(channel[1], text.data() + written, text.size() - written);
+
+      if (count <= 0) {
+        break;
+      }
+      written += static_cast<std::size_t>(count);
+    }
+
+    _exit(0);
+  }
+
+  close(channel[1]);
+
+  std::string text;
+  char buffer[4096];
+  ssize_t count = 0;
+
+  while ((count = read(channel[0], buffer, sizeof(buffer))) > 0) {
+    text.append(buffer, static_cast<std::size_t>(count));
+  }
+
+  close(channel[0]);
+
+  int status = 0;
+  struct rusage usage;
+  std::memset(&usage, 0, sizeof(usage));
+
+  if (child < 0 || wait4(child, &status, 0, &usage) != child
+      || !WIFEXITED(status) || text.empty()) {
+    out << "\"error\": \"the run crashed\"}";
+    return;
+  }
+
+  // ru_maxrss is in kilobytes on Linux.
+  out << text << ", \"peak_rss_kb\": " << usage.ru_maxrss << "}";
+}
+
+/**
+ * @brief Prints how to use the tool and exits.
+ *
+ * @param Program The name of the program.
+ */
+void Usage(const char* Program) {
+  std::cerr << "Usage: " << Program << " [--engines NAME,...]"
+            << " [--sizes N,...] [--read-percents P,...]\nEngines:";
+
+  for (const CompareEngine& engine : ENGINES) {
+    std::cerr << " " << engine.Name_;
+  }
+
+  std::cerr << "\n";
+  std::exit(1);
+}
+
+/**
+ * @brief Splits a comma separated list.
+ *
+ * @param List The list.
+ * @return The items.
+ */
+std::vector<std::string> Split(const std::string& List) {
+  std::vector<std::string> items;
+  std::stringstream stream(List);
+  std::string item;
+
+  while (std::getline(stream, item, ',')) {
+    items.push_back(item);
+  }
+
+  return items;
+}
+
+int main(int argc, char** argv) {
+  std::vector<const CompareEngine*> engines;
+  std::vector<std::size_t> sizes{100000, 1000000};
+  std::vector<unsigned> read_percents{50, 90, 99};
+
+  for (const CompareEngine& engine : ENGINES) {
+    engines.push_back(&engine);
+  }
+
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+    }
+
+    const std::string option = argv[i];
+    const std::vector<std::string> values = Split(argv[i + 1]);
+
+    if (option == "--engines") {
+      engines.clear();
+
+      for (const std::string& value : values) {
+        const CompareEngine* found = nullptr;
+
+        for (const CompareEngine& engine : ENGINES) {
+          if (value == engine.Name_) {
+            found = &engine;
+          }
+        }
+
+        if (found == nullptr) {
+          Usage(argv[0]);
+        }
+        engines.push_back(found);
+      }
+    } else if (option == "--sizes") {
+      sizes.clear();
+      for (const std::string& value : values) {
+        sizes.push_back(std::strtoul(value.c_str(), nullptr, 10));
+      }
+    } else if (option == "--read-percents") {
+      read_percents.clear();
+      for (const std::string& value : values) {
+        read_percents.push_back(
+          std::min(100u, static_cast<unsigned>(std::atoi(value.c_str())))
+        );
+      }
+    } else {
+      Usage(argv[0]);
+    }
+  }
+
+  bool first = true;
+
+  std::cout << "{\n  \"benchmark\": \"compare\",\n  \"results\": [\n";
+
+  for (std::size_t size : sizes) {
+    for (unsigned read_percent : read_percents) {
+      for (const CompareEngine* engine : engines) {
+        std::cerr << engine->Name_ << " size " << size << " reads "
+                  << read_percent << "%\n";
+
+        if (!first) {
+          std::cout << ",\n";
+        }
+        first = false;
+
+        const CompareRun run{size, read_percent, engine->Policy_};
+        RunIsolated(*engine, run, std::cout);
+        std::cout.flush();
+      }
+    }
+  }
+
+  std::cout << "\n  ]\n}\n";
+
+  return 0;
+}
@@ -0,0 +1,526 @@
+/**
+ * @file concurrency.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Runs the tables meant for many threads with many threads, and checks
+ * that every thread only ever sees data that was really in the table. Every
+ * check is registered with ctest.
+ *
+ * Usage: concurrency NAME
+ * - `NAME` The check to run (see CHECKS).
+ *
+ * Prints what went wrong and exits with 1 if the check fails.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HashFuncs.h"
+#include "OAHashTable.h"
+#include "OALockFreeHashTable.h"
+#include "OASeqlockHashTable.h"
+#include "ShardedOAHashTable.h"
+
+//! The threads reading while the writers work
+const unsigned READERS = 4;
+
+//! The threads writing to the tables that take many writers
+const unsigned WRITERS = 8;
+
+//! Whether any check failed
+std::atomic<bool> failed{false};
+
+/**
+ * @brief Records a failed check, from any thread.
+ *
+ * @param ok Whether the check passed.
+ * @param What What was checked.
+ */
+void Expect(bool ok, const char* What) {
+  if (!ok && !failed.exchange(true)) {
+    std::cerr << "FAILED: " << What << std::endl;
+  }
+}
+
+/**
+ * @brief The key for a number.
+ *
+ * @param Number The number.
+ * @return The key, short enough for MAX_KEYLEN.
+ */
+std::string MakeKey(unsigned Number) {
+  char key[MAX_KEYLEN];
+  snprintf(key, sizeof(key), "key%u", Number);
+  return key;
+}
+
+/**
+ * @brief One writer inserts keys from a tiny table (so it grows many times
+ * and retires many arrays) and removes the even ones, while the readers look
+ * up keys. A key that is found must have its own number as data, and once
+ * the writer is done exactly the odd keys are left.
+ */
+void CheckSeqlock() {
+  const unsigned count = 50000;
+  std::vector<std::string> keys;
+
+  for (unsigned i = 0; i < count; i++) {
+    keys.push_back(MakeKey(i));
+  }
+
+  OASeqlockHashTable<unsigned> table(
+    OASeqlockHashTable<unsigned>::OAHTConfig(7, PJWHash, UHash, 0.5, 2.0)
+  );
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+
+  for (unsigned r = 0; r < READERS; r++) {
+    readers.emplace_back([&, r]() {
+      OASeqlockHashTable<unsigned>::Reader reader(table);
+      unsigned i = r;
+
+      while (!done.load()) {
+        i = (i * 1103515245u + 12345u) % count;
+
+        try {
+          Expect(reader.find(keys[i].c_str()) == i, "seqlock data");
+        } catch (const OAHashTableException& exception) {
+          Expect(
+            exception.code() == OAHashTableException::E_ITEM_NOT_FOUND,
+            "seqlock exception"
+          );
+        }
+      }
+    });
+  }
+
+  for (unsigned i = 0; i < count; i++) {
+    table.insert(keys[i].c_str(), i);
+  }
+
+  for (unsigned i = 0; i < count; i += 2) {
+    table.remove(keys[i].c_str());
+  }
+
+  done.store(true);
+
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  OASeqlockHashTable<unsigned>::Reader reader(table);
+
+  for (unsigned i = 0; i < count; i++) {
+    try {
+      const unsigned data = reader.find(keys[i].c_str());
+      Expect(i % 2 == 1 && data == i, "seqlock end");
+    } catch (const OAHashTableException&) {
+      Expect(i % 2 == 0, "seqlock missing");
+    }
+  }
+
+  Expect(table.GetStats().Count_ == count / 2, "seqlock count");
+}
+
+/**
+ * @brief One writer keeps a thousand keys alive while inserting and
+ * removing many more, so the table is mostly tombstones unless they are
+ * cleaned up, while the readers look up the live keys. The table must not
+ * grow for it, and must keep free slots that end the probes of a miss.
+ */
+void CheckSeqlockChurn() {
+  const unsigned count = 200000;
+  const unsigned live = 1000;
+  std::vector<std::string> keys;
+
+  for (unsigned i = 0; i < count; i++) {
+    keys.push_back(MakeKey(i));
+  }
+
+  OASeqlockHashTable<unsigned> table(
+    OASeqlockHashTable<unsigned>::OAHTConfig(7, PJWHash, UHash, 0.5, 2.0)
+  );
+  std::atomic<unsigned> inserted{0};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+
+  for (unsigned r = 0; r < READERS; r++) {
+    readers.emplace_back([&]() {
+      OASeqlockHashTable<unsigned>::Reader reader(table);
+
+      while (!done.load()) {
+        const unsigned i = inserted.load();
+
+        try {
+          Expect(reader.find(keys[i].c_str()) == i, "seqlock churn data");
+        } catch (const OAHashTableException&) {
+          // The writer removed it already.
+        }
+      }
+    });
+  }
+
+  for (unsigned i = 0; i < count; i++) {
+    table.insert(keys[i].c_str(), i);
+    inserted.store(i);
+
+    if (i >= live) {
+      table.remove(keys[i - live].c_str());
+    }
+  }
+
+  done.store(true);
+
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  const OAHTStats stats = table.GetStats();
+  Expect(stats.Count_ == live, "seqlock churn count");
+  Expect(stats.TableSize_ < 4 * live, "seqlock churn grew");
+  Expect(
+    stats.Count_ + stats.Tombstones_ < stats.TableSize_,
+    "seqlock churn has no free slot"
+  );
+
+  // Without free slots every insert would probe the whole table.
+  Expect(stats.Probes_ < 16 * std::uint64_t(count), "seqlock churn probes");
+}
+
+/**
+ * @brief Every writer adds to the same counters, starting from a tiny table so
+ * the counters are migrated many times while being added to, and then
+ * removes its share of them. The readers check that no counter ever goes
+ * back, and at the end every counter holds every addition.
+ */
+void CheckLockFreeCounters() {
+  const unsigned counters = 2000;
+  const unsigned rounds = 50;
+
+  OALockFreeHashTable<long> table(OALockFreeHashTable<long>::OALFConfig(7));
+  std::atomic<bool> done{false};
+  std::vector<std::thread> threads;
+
+  for (unsigned r = 0; r < READERS; r++) {
+    threads.emplace_back([&]() {
+      std::vector<long> seen(counters + 1, 0);
+
+      while (!done.load()) {
+        for (unsigned key = 1; key <= counters; key++) {
+          try {
+            const long value = table.find(key);
+            Expect(value >= seen[key], "lockfree counter went back");
+            seen[key] = value;
+          } catch (const OAHashTableException&) {
+            Expect(seen[key] == 0, "lockfree counter lost");
+          }
+        }
+      }
+    });
+  }
+
+  std::vector<std::thread> writers;
+
+  for (unsigned w = 0; w < WRITERS; w++) {
+    writers.emplace_back([&]() {
+      for (unsigned round = 0; round < rounds; round++) {
+        for (unsigned key = 1; key <= counters; key++) {
+          table.add(key, 1);
+        }
+      }
+    });
+  }
+
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+
+  done.store(true);
+
+  for (std::thread& reader : threads) {
+    reader.join();
+  }
+
+  for (unsigned key = 1; key <= counters; key++) {
+    Expect(table.find(key) == WRITERS * rounds, "lockfree counter total");
+  }
+
+  // Every writer removes the keys that are its own, the rest stay.
+  writers.clear();
+
+  for (unsigned w = 0; w < WRITERS; w++) {
+    writers.emplace_back([&, w]() {
+      for (unsigned key = 1 + w; key <= counters; key += 2 * WRITERS) {
+        table.remove(key);
+      }
+    });
+  }
+
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+
+  unsigned left = 0;
+
+  for (unsigned key = 1; key <= counters; key++) {
+    const bool removed = (key - 1) % (2 * WRITERS) < WRITERS;
+
+    try {
+      table.find(key);
+      Expect(!removed, "lockfree removed key found");
+      left++;
+    } catch (const OAHashTableException&) {
+      Expect(removed, "lockfree key lost");
+    }
+  }
+
+  Expect(table.GetStats().Count_ == left, "lockfree count");
+}
+
+/**
+ * @brief The writers insert keys of their own from a tiny table, so it keeps
+ * growing, and publish how far they got. The readers look up keys the
+ * writers already inserted, so every lookup runs while arrays are attached,
+ * frozen and migrated, and must find them.
+ */
+void CheckLockFreeGrowth() {
+  const unsigned per_writer = 100000;
+
+  OALockFreeHashTable<long> table(
+    OALockFreeHashTable<long>::OALFConfig(7, 0.5, 2.0, true)
+  );
+  std::vector<std::atomic<unsigned>> inserted(WRITERS);
+  std::atomic<unsigned> writing{WRITERS};
+  std::vector<std::thread> threads;
+
+  for (std::atomic<unsigned>& count : inserted) {
+    count.store(0);
+  }
+
+  for (unsigned w = 0; w < WRITERS; w++) {
+    threads.emplace_back([&, w]() {
+      for (unsigned i = 0; i < per_writer; i++) {
+        table.insert(std::uint64_t(w) << 32 | (i + 1), i);
+        inserted[w].store(i + 1, std::memory_order_release);
+      }
+
+      writing.fetch_sub(1);
+    });
+  }
+
+  for (unsigned r = 0; r < READERS; r++) {
+    threads.emplace_back([&, r]() {
+      unsigned random = r + 1;
+
+      while (writing.load() != 0) {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+
+        const unsigned w = random % WRITERS;
+        const unsigned count = inserted[w].load(std::memory_order_acquire);
+
+        if (count == 0) {
+          continue;
+        }
+
+        const unsigned i = (random >> 8) % count;
+
+        try {
+          const long data = table.find(std::uint64_t(w) << 32 | (i + 1));
+          Expect(data == i, "lockfree growth data");
+        } catch (const OAHashTableException&) {
+          Expect(false, "lockfree key missing during growth");
+        }
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  Expect(
+    table.GetStats().Count_ == WRITERS * per_writer,
+    "lockfree growth count"
+  );
+}
+
+/**
+ * @brief Every writer inserts keys of its own, looks up the keys of the
+ * others and removes half of its own, while a bulk insert fills every shard
+ * from its own threads. Everything a thread finds must carry its own data,
+ * and the end result is checked key by key.
+ */
+void CheckSharded() {
+  const unsigned per_writer = 20000;
+  const unsigned bulk = 20000;
+  const unsigned count = WRITERS * per_writer;
+  std::vector<std::string> keys;
+
+  for (unsigned i = 0; i < count + bulk; i++) {
+    keys.push_back(MakeKey(i));
+  }
+
+  ShardedOAHashTable<unsigned, OANoInstrumentation> table(
+    ShardedOAHashTable<unsigned, OANoInstrumentation>::OAHTConfig(
+      7,
+      PJWHash
+    ),
+    3
+  );
+  std::vector<std::thread> threads;
+
+  for (unsigned w = 0; w < WRITERS; w++) {
+    threads.emplace_back([&, w]() {
+      for (unsigned i = w; i < count; i += WRITERS) {
+        table.insert(keys[i].c_str(), i);
+
+        const unsigned other = (i + 1) % count;
+
+        try {
+          Expect(table.find(keys[other].c_str()) == other, "sharded data");
+        } catch (const OAHashTableException&) {
+          // The other writer didn't get there yet.
+        }
+      }
+
+      for (unsigned i = w; i < count; i += 2 * WRITERS) {
+        table.remove(keys[i].c_str());
+      }
+    });
+  }
+
+  std::vector<const char*> bulk_keys;
+  std::vector<unsigned> bulk_data;
+
+  for (unsigned i = count; i < count + bulk; i++) {
+    bulk_keys.push_back(keys[i].c_str());
+    bulk_data.push_back(i);
+  }
+
+  table.insert_bulk(bulk_keys.data(), bulk_data.data(), bulk);
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  unsigned left = 0;
+
+  for (unsigned i = 0; i < count + bulk; i++) {
+    const bool removed = i < count && i % (2 * WRITERS) < WRITERS;
+
+    try {
+      const unsigned data = table.find(keys[i].c_str());
+      Expect(!removed && data == i, "sharded end");
+      left++;
+    } catch (const OAHashTableException&) {
+      Expect(removed, "sharded key lost");
+    }
+  }
+
+  Expect(table.GetStats().Count_ == left, "sharded count");
+}
+
+/**
+ * @brief Every writer inserts keys of its own into a sharded cache, far more
+ * than it holds. The shards split the capacity, so the whole table never
+ * holds more than it (rounded up to a multiple of the shards), and every key
+ * it still has carries its own data.
+ */
+void CheckShardedCache() {
+  const unsigned per_writer = 20000;
+  const std::size_t capacity = 1000;
+  const unsigned shard_bits = 3;
+  const unsigned count = WRITERS * per_writer;
+  std::vector<std::string> keys;
+
+  for (unsigned i = 0; i < count; i++) {
+    keys.push_back(MakeKey(i));
+  }
+
+  ShardedOAHashTable<unsigned, OANoInstrumentation>::OAHTConfig config(
+    7,
+    PJWHash
+  );
+  config.Capacity_ = capacity;
+
+  ShardedOAHashTable<unsigned, OANoInstrumentation> table(config, shard_bits);
+  std::vector<std::thread> threads;
+
+  for (unsigned w = 0; w < WRITERS; w++) {
+    threads.emplace_back([&, w]() {
+      for (unsigned i = w; i < count; i += WRITERS) {
+        table.insert(keys[i].c_str(), i);
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  unsigned left = 0;
+
+  for (unsigned i = 0; i < count; i++) {
+    try {
+      Expect(table.find(keys[i].c_str()) == i, "sharded cache data");
+      left++;
+    } catch (const OAHashTableException&) {
+      // Evicted.
+    }
+  }
+
+  const std::size_t shards = std::size_t(1) << shard_bits;
+  const std::size_t limit = (capacity + shards - 1) / shards * shards;
+  Expect(table.GetStats().Count_ == left, "sharded cache count");
+  Expect(left <= limit, "sharded cache over its capacity");
+}
+
+/**
+ * @brief A check that can be run.
+ */
+struct ConcurrencyCheck {
+  const char* Name_; //!< Name on the command line
+  void (*Run_)();    //!< Runs the check
+};
+
+//! Every check, add new checks here and to CMakeLists.txt.
+const ConcurrencyCheck CHECKS[] = {
+  {"seqlock",         CheckSeqlock         },
+  {"seqlock_churn",   CheckSeqlockChurn    },
+  {"lockfree",        CheckLockFreeCounters},
+  {"lockfree_growth", CheckLockFreeGrowth  },
+  {"sharded",         CheckSharded         },
+  {"sharded_cache",   CheckShardedCache    }
+};
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " NAME\nChecks:";
+
+    for (const ConcurrencyCheck& check : CHECKS) {
+      std::cerr << ' ' << check.Name_;
+    }
+
+    std::cerr << std::endl;
+    return 1;
+  }
+
+  for (const ConcurrencyCheck& check : CHECKS) {
+    if (strcmp(check.Name_, argv[1]) == 0) {
+      check.Run_();
+      return failed.load() ? 1 : 0;
+    }
+  }
+
+  std::cerr << "Unknown check: " << argv[1] << std::endl;
+  return 1;
+}
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "HashFuncs.h"
 #include "OAHashTable.h"
 
 using std::cout;
@@ -90,12 +91,6 @@ void FillPersonRecs(void) {
   }
 }
 
-unsigned ConstantHash(const char*, unsigned) { return 1; }
-
-unsigned ReflexiveHash(const char* Key, unsigned TableSize) {
-  return static_cast<unsigned>(atoi(Key)) % TableSize;
-}
-
 void RevString(char* Key) {
   size_t len = strlen(Key);
   for (size_t i = 0; i < len / 2; i++) {
@@ -105,124 +100,6 @@ void RevString(char* Key) {
   }
 }
 
-unsigned PJWHash(const char* Key, unsigned TableSize) {
-  // Initial value of hash
-  unsigned hash = 0;
-
-  // Process each char in the string
-  while (*Key) {
-    // Shift hash left 4
-    hash = (hash << 4);
-
-    // Add in current char
-    hash = hash + static_cast<unsigned>(*Key);
-
-    // Get the four high-order bits
-    unsigned bits = hash & 0xF0000000;
-
-    // If any of the four bits are non-zero,
-    if (bits) {
-      // Shift the four bits right 24 positions (...bbbb0000)
-      // and XOR them back in to the hash
-      hash = hash ^ (bits >> 24);
-
-      // Now, XOR the four bits back in
-      hash = hash ^ bits;
-    }
-
-    // Next char
-    Key++;
-  }
-
-  // Modulo so hash is within 0 - TableSize
-  return hash % TableSize;
-}
-
-unsigned SimpleHash(const char* Key, unsigned TableSize) {
-  // Initial value of hash
-  unsigned hash = 0;
-
-  // Process each char in the string
-  while (*Key) {
-    // Add in current char
-    hash += static_cast<unsigned>(*Key);
-
-    // Next char
-    Key++;
-  }
-
-  // Modulo so hash is within the table
-  return hash % TableSize;
-}
-
-unsigned RSHash(const char* Key, unsigned TableSize) {
-  unsigned hash = 0;         // Initial value of hash
-  unsigned multiplier = 127; // Prevent anomalies
-
-  // Process each char in the string
-  while (*Key) {
-    // Adjust hash total
-    hash = hash * multiplier;
-
-    // Add in current char and mod result
-    hash = (hash + static_cast<unsigned>(*Key)) % TableSize;
-
-    // Next char
-    Key++;
-  }
-
-  // Hash is within 0 - TableSize
-  return hash;
-}
-
-unsigned UHash(const char* Key, unsigned TableSize) {
-  unsigned hash = 0;      // Initial value of hash
-  unsigned rand1 = 31415; // "Random" 1
-  unsigned rand2 = 27183; // "Random" 2
-
-  // Process each char in string
-  while (*Key) {
-    // Multiply hash by random
-    hash = hash * rand1;
-
-    // Add in current char, keep within TableSize
-    hash = (hash + static_cast<unsigned>(*Key)) % TableSize;
-
-    // Update rand1 for next "random" number
-    rand1 = (rand1 * rand2) % (TableSize - 1);
-
-    // Next char
-    Key++;
-  }
-  // Hash value is within 0 - TableSize - 1
-  return hash;
-}
-
-struct HashData {
-  HASHFUNC Fn;
-  const char* Name;
-};
-
-enum HASHFUNCS {
-  NONE,
-  CONSTANT,
-  REFLEXIVE,
-  SIMPLE,
-  RS,
-  UNIVERSAL,
-  PJW
-};
-
-HashData HashingFuncs[] = {
-  {0,             "None (Linear probing)"},
-  {ConstantHash,  "Constant Hash (1)"    },
-  {ReflexiveHash, "Reflexive Hash"       },
-  {SimpleHash,    "Simple Hash"          },
-  {RSHash,        "RS Hash"              },
-  {UHash,         "Universal Hash"       },
-  {PJWHash,       "PJW Hash"             }
-};
-
 void Dispose(void*) {}
 
 template<typename T>
@@ -0,0 +1,424 @@
+/**
+ * @file hashanalyzer.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Measures the quality of every function in HashingFuncs over a set of
+ * keys: how evenly they spread the keys, how much a one bit change in a key
+ * changes the hash, the probe lengths they lead to and how fast they are.
+ *
+ * Usage: hash_analyzer [options]
+ * - `--keys FILE` Reads the keys from a file, one per line.
+ * - `--generate ids|sequential|random` Generates the keys (default ids).
+ * - `--count N` The amount of keys to generate (default 10000).
+ * - `--sizes A,B,C` The table sizes to test (default 101,1009,10007).
+ * - `--load LF` The load factor used for the probe lengths (default 0.5).
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "HashFuncs.h"
+#include "OAHashTable.h"
+
+//! The table size used for the avalanche test, the biggest 31 bit prime.
+const unsigned AVALANCHE_TABLE_SIZE = 2147483647u;
+
+//! The amount of output bits looked at in the avalanche test.
+const unsigned AVALANCHE_BITS = 31;
+
+//! The amount of keys the avalanche test flips bits in.
+const std::size_t AVALANCHE_KEYS = 1000;
+
+//! The amount of bytes hashed for the throughput.
+const double THROUGHPUT_BYTES = 64.0 * 1024 * 1024;
+
+/**
+ * @brief What the user asked for.
+ */
+struct Options {
+  std::string KeyFile_{};                         //!< Keys to read
+  std::string Generator_{"ids"};                  //!< Keys to generate
+  std::size_t Count_{10000};                      //!< Keys generated
+  std::vector<unsigned> Sizes_{101, 1009, 10007}; //!< Table sizes
+  double LoadFactor_{0.5};                        //!< For probe lengths
+};
+
+/**
+ * @brief How a function spreads the keys over a table.
+ */
+struct Distribution {
+  double ChiSquare_{0};    //!< Chi-square over the degrees of freedom
+  unsigned Collisions_{0}; //!< Keys that landed on a used bucket
+};
+
+/**
+ * @brief How much a one bit change in the key changes the hash.
+ */
+struct Avalanche {
+  double MeanBias_{0};  //!< Mean of |P(flip) - 0.5| over the output bits
+  double WorstBias_{0}; //!< Worst |P(flip) - 0.5| over the output bits
+};
+
+/**
+ * @brief Prints how to use the tool and exits.
+ *
+ * @param Program The name of the program.
+ */
+void Usage(const char* Program) {
+  std::cerr << "Usage: " << Program << " [--keys FILE]"
+            << " [--generate ids|sequential|random] [--count N]"
+            << " [--sizes A,B,C] [--load LF]\n";
+  std::exit(1);
+}
+
+/**
+ * @brief Reads the command line.
+ *
+ * @param argc The amount of arguments.
+ * @param argv The arguments.
+ * @return The options.
+ */
+Options ParseOptions(int argc, char** argv) {
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+    }
+
+    std::string value = argv[++i];
+
+    if (arg == "--keys") {
+      options.KeyFile_ = value;
+    } else if (arg == "--generate") {
+      options.Generator_ = value;
+    } else if (arg == "--count") {
+      options.Count_ = std::strtoul(value.c_str(), nullptr, 10);
+    } else if (arg == "--load") {
+      options.LoadFactor_ = std::strtod(value.c_str(), nullptr);
+    } else if (arg == "--sizes") {
+      std::stringstream sizes(value);
+      std::string size;
+      options.Sizes_.clear();
+
+      while (std::getline(sizes, size, ',')) {
+        options.Sizes_.push_back(
+          static_cast<unsigned>(std::strtoul(size.c_str(), nullptr, 10))
+        );
+      }
+    } else {
+      Usage(argv[0]);
+    }
+  }
+
+  if (options.Sizes_.empty() || options.LoadFactor_ <= 0
+      || options.LoadFactor_ > 1) {
+    Usage(argv[0]);
+  }
+
+  for (unsigned size : options.Sizes_) {
+    if (size < 3) {
+      Usage(argv[0]);
+    }
+  }
+
+  return options;
+}
+
+/**
+ * @brief Gets the keys, either from the file or from the generator. Keys
+ * longer than the table allows are cut.
+ *
+ * @param options The options.
+ * @return The keys.
+ */
+std::vector<std::string> GetKeys(const Options& options) {
+  std::vector<std::string> keys;
+
+  if (!options.KeyFile_.empty()) {
+    std::ifstream file(options.KeyFile_);
+    std::string line;
+
+    if (!file) {
+      std::cerr << "Can't open " << options.KeyFile_ << "\n";
+      std::exit(1);
+    }
+
+    while (std::getline(file, line)) {
+      if (!line.empty()) {
+        keys.push_back(line.substr(0, MAX_KEYLEN - 1));
+      }
+    }
+
+    return keys;
+  }
+
+  std::mt19937 random(280);
+
+  for (std::size_t i = 0; i < options.Count_; i++) {
+    std::stringstream key;
+
+    if (options.Generator_ == "ids") {
+      // Like the drivers' Person IDs: 6 digits.
+      key << std::setw(6) << std::setfill('0') << random() % 1000000;
+    } else if (options.Generator_ == "sequential") {
+      key << "key" << i;
+    } else if (options.Generator_ == "random") {
+      std::size_t length = 4 + random() % 12;
+
+      for (std::size_t c = 0; c < length; c++) {
+        key << static_cast<char>('a' + random() % 26);
+      }
+    } else {
+      std::cerr << "Unknown generator " << options.Generator_ << "\n";
+      std::exit(1);
+    }
+
+    keys.push_back(key.str());
+  }
+
+  return keys;
+}
+
+/**
+ * @brief Puts every key in a bucket and compares the counts against a uniform
+ * spread.
+ *
+ * @param Fn The hash function.
+ * @param keys The keys.
+ * @param TableSize The amount of buckets.
+ * @return The distribution of the keys.
+ */
+Distribution GetDistribution(
+  HASHFUNC Fn,
+  const std::vector<std::string>& keys,
+  unsigned TableSize
+) {
+  Distribution distribution;
+  std::vector<unsigned> buckets(TableSize, 0);
+
+  for (const std::string& key : keys) {
+    unsigned& bucket = buckets[Fn(key.c_str(), TableSize)];
+
+    if (bucket != 0) {
+      distribution.Collisions_++;
+    }
+    bucket++;
+  }
+
+  const double expected =
+    static_cast<double>(keys.size()) / static_cast<double>(TableSize);
+
+  for (unsigned bucket : buckets) {
+    const double difference = bucket - expected;
+    distribution.ChiSquare_ += difference * difference / expected;
+  }
+
+  distribution.ChiSquare_ /= TableSize - 1;
+
+  return distribution;
+}
+
+/**
+ * @brief Flips every bit of the first keys (except the ones that would end the
+ * string) and measures how often each bit of the hash flips with it.
+ *
+ * @param Fn The hash function.
+ * @param keys The keys.
+ * @return The bias of the output bits.
+ */
+Avalanche GetAvalanche(HASHFUNC Fn, const std::vector<std::string>& keys) {
+  Avalanche avalanche;
+  std::vector<double> flips(AVALANCHE_BITS, 0);
+  double trials = 0;
+  const std::size_t count = std::min(keys.size(), AVALANCHE_KEYS);
+
+  for (std::size_t k = 0; k < count; k++) {
+    char key[MAX_KEYLEN];
+    std::strcpy(key, keys[k].c_str());
+
+    const unsigned hash = Fn(key, AVALANCHE_TABLE_SIZE);
+
+    for (std::size_t c = 0; key[c] != '\0'; c++) {
+      for (unsigned bit = 0; bit < 8; bit++) {
+        const char original = key[c];
+        key[c] = static_cast<char>(original ^ (1 << bit));
+
+        if (key[c] != '\0') {
+          const unsigned changed = hash ^ Fn(key, AVALANCHE_TABLE_SIZE);
+
+          for (unsigned out = 0; out < AVALANCHE_BITS; out++) {
+            flips[out] += (changed >> out) & 1;
+          }
+          trials++;
+        }
+
+        key[c] = original;
+      }
+    }
+  }
+
+  if (trials == 0) {
+    return avalanche;
+  }
+
+  for (double flip : flips) {
+    const double bias = std::fabs(flip / trials - 0.5);
+    avalanche.MeanBias_ += bias / AVALANCHE_BITS;
+    avalanche.WorstBias_ = std::max(avalanche.WorstBias_, bias);
+  }
+
+  return avalanche;
+}
+
+/**
+ * @brief Fills a table up to the load factor and analyzes it.
+ *
+ * @param Primary The primary hash function.
+ * @param Secondary The secondary hash function (0 for linear probing).
+ * @param keys The keys.
+ * @param TableSize The size of the table.
+ * @param LoadFactor How full to make the table.
+ * @return The analysis of the table.
+ */
+OAHTAnalysis GetProbes(
+  HASHFUNC Primary,
+  HASHFUNC Secondary,
+  const std::vector<std::string>& keys,
+  unsigned TableSize,
+  double LoadFactor
+) {
+  // A max load factor of 1 so the table never grows under the test.
+  OAHashTable<int, OANoInstrumentation> table(
+    OAHashTable<int, OANoInstrumentation>::OAHTConfig(
+      TableSize,
+      Primary,
+      Secondary,
+      1.0
+    )
+  );
+
+  const std::size_t target = static_cast<std::size_t>(TableSize * LoadFactor);
+  std::size_t inserted = 0;
+
+  for (std::size_t i = 0; i < keys.size() && inserted < target; i++) {
+    try {
+      table.insert(keys[i].c_str(), 0);
+      inserted++;
+    } catch (const OAHashTableException&) {
+      // Duplicate keys are skipped.
+    }
+  }
+
+  return table.Analyze();
+}
+
+/**
+ * @brief Hashes the keys over and over and measures the speed.
+ *
+ * @param Fn The hash function.
+ * @param keys The keys.
+ * @param TableSize The table size given to the function.
+ * @return The speed in GB/s.
+ */
+double GetThroughput(
+  HASHFUNC Fn,
+  const std::vector<std::string>& keys,
+  unsigned TableSize
+) {
+  std::size_t bytes_per_pass = 0;
+
+  for (const std::string& key : keys) {
+    bytes_per_pass += key.size();
+  }
+
+  if (bytes_per_pass == 0) {
+    return 0;
+  }
+
+  const std::size_t passes = static_cast<std::size_t>(
+    std::ceil(THROUGHPUT_BYTES / static_cast<double>(bytes_per_pass))
+  );
+
+  // Keeps the calls from being optimized away.
+  volatile unsigned sink = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t pass = 0; pass < passes; pass++) {
+    for (const std::string& key : keys) {
+      sink = sink + Fn(key.c_str(), TableSize);
+    }
+  }
+
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  return static_cast<double>(bytes_per_pass * passes) / elapsed.count() / 1e9;
+}
+
+int main(int argc, char** argv) {
+  const Options options = ParseOptions(argc, argv);
+  const std::vector<std::string> keys = GetKeys(options);
+
+  if (keys.empty()) {
+    std::cerr << "There are no keys.\n";
+    return 1;
+  }
+
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "Keys: " << keys.size() << "\n";
+
+  for (unsigned primary = CONSTANT; primary <= PJW; primary++) {
+    HASHFUNC fn = HashingFuncs[primary].Fn;
+    const Avalanche avalanche = GetAvalanche(fn, keys);
+
+    std::cout << "\n" << HashingFuncs[primary].Name << "\n";
+    std::cout << "  Avalanche bias: mean " << avalanche.MeanBias_ << ", worst "
+              << avalanche.WorstBias_ << "\n";
+
+    for (unsigned size : options.Sizes_) {
+      const Distribution distribution = GetDistribution(fn, keys, size);
+
+      std::cout << "  Size " << size << "\n";
+      std::cout << "    Chi-square/df: " << distribution.ChiSquare_
+                << ", collisions: " << distribution.Collisions_
+                << ", throughput: " << GetThroughput(fn, keys, size)
+                << " GB/s\n";
+
+      // Linear probing first, then every function as the secondary.
+      for (unsigned secondary = NONE; secondary <= PJW; secondary++) {
+        const OAHTAnalysis analysis = GetProbes(
+          fn,
+          HashingFuncs[secondary].Fn,
+          keys,
+          size,
+          options.LoadFactor_
+        );
+
+        std::cout << "    " << std::left << std::setw(24)
+                  << (secondary == NONE ? "Linear probing"
+                                        : HashingFuncs[secondary].Name)
+                  << std::right << " hit " << std::setw(9)
+                  << analysis.AverageSuccessfulProbes_ << "  miss "
+                  << std::setw(9) << analysis.AverageUnsuccessfulProbes_
+                  << "  max " << analysis.MaxProbeLength_ << "\n";
+      }
+    }
+  }
+
+  return 0;
+}
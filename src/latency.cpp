@@ -0,0 +1,390 @@
+/**
+ * @file latency.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Measures the latency of every single operation on an OAHashTable
+ * and writes the percentiles of each operation type as JSON. Every operation
+ * is tagged with what it set off, a growth of the table (expansion) or a PACK
+ * removal re-inserting a cluster (compaction), so the slow ones can be
+ * attributed.
+ *
+ * Usage: latency [options]
+ * - `--size N` Elements inserted and removed (default 1000000).
+ * - `--policies MARK,PACK` The deletion policies to run (default both).
+ * - `--primary` and `--secondary` Hash functions from HASHFUNCS (default PJW
+ * and NONE).
+ * - `--load-factor LF` and `--growth-factor GF` (default 0.5 and 2).
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "HashFuncs.h"
+#include "OAHashTable.h"
+
+//! The table every run starts with, so the growth is part of the inserts.
+const unsigned INITIAL_TABLE_SIZE = 97;
+
+//! The most misses looked up per run, since every miss throws.
+const std::size_t MAX_MISS_OPS = 1 << 16;
+
+//! The amount of slowest operations listed for every type
+const std::size_t SLOWEST_KEPT = 10;
+
+//! The table being measured, without probe counting in the way
+typedef OAHashTable<int, OANoInstrumentation> Table;
+
+//! The operation types
+enum LatencyOp {
+  OP_INSERT,
+  OP_FIND_HIT,
+  OP_FIND_MISS,
+  OP_REMOVE,
+  OP_COUNT
+};
+
+//! The names of the operation types
+const char* const OP_NAMES[OP_COUNT] = {
+  "insert", "find_hit", "find_miss", "remove"
+};
+
+//! What an operation set off
+enum LatencyCause {
+  CAUSE_NONE,
+  CAUSE_EXPANSION,
+  CAUSE_COMPACTION,
+  CAUSE_COUNT
+};
+
+//! The names of the causes
+const char* const CAUSE_NAMES[CAUSE_COUNT] = {
+  "none", "expansion", "compaction"
+};
+
+/**
+ * @brief One slow operation.
+ */
+struct Outlier {
+  std::uint64_t Nanoseconds_; //!< How long it took
+  LatencyCause Cause_;        //!< What it set off
+  unsigned Detail_;           //!< New table size, or items re-inserted
+};
+
+/**
+ * @brief Everything measured for one operation type.
+ */
+struct OpLatencies {
+  BenchHistogram All_{};                 //!< Every operation
+  BenchHistogram Causes_[CAUSE_COUNT]{}; //!< Split by what they set off
+  std::vector<Outlier> Slowest_{};       //!< The slowest, as a min-heap
+};
+
+/**
+ * @brief What the user asked for.
+ */
+struct LatencyOptions {
+  std::size_t Size_{1000000};                            //!< Elements
+  std::vector<OAHTDeletionPolicy> Policies_{MARK, PACK}; //!< Policies
+  HASHFUNC Primary_{PJWHash};                            //!< Primary hash
+  HASHFUNC Secondary_{nullptr};                          //!< Secondary hash
+  double LoadFactor_{0.5};                               //!< Max LF
+  double GrowthFactor_{2.0};                             //!< Growth factor
+};
+
+/**
+ * @brief Orders outliers so the fastest is on top of the heap.
+ *
+ * @param Left An outlier.
+ * @param Right An outlier.
+ * @return Whether Left is slower.
+ */
+bool IsSlower(const Outlier& Left, const Outlier& Right) {
+  return Left.Nanoseconds_ > Right.Nanoseconds_;
+}
+
+/**
+ * @brief Runs an operation, timing it and working out what it set off.
+ *
+ * @param table The table the operation works on.
+ * @param latencies Where to count the operation.
+ * @param op The operation.
+ */
+template<typename F>
+void Measure(const Table& table, OpLatencies& latencies, F op) {
+  static const double nanoseconds_per_tick = GetNanosecondsPerTick();
+  const OAHTStats before = table.GetStats();
+
+  const std::uint64_t start = GetTicks();
+  op();
+  const std::uint64_t ticks = GetTicks() - start;
+
+  const OAHTStats after = table.GetStats();
+  Outlier outlier{
+    static_cast<std::uint64_t>(ticks * nanoseconds_per_tick + 0.5),
+    CAUSE_NONE,
+    0
+  };
+
+  if (after.Expansions_ != before.Expansions_) {
+    outlier.Cause_ = CAUSE_EXPANSION;
+    outlier.Detail_ = after.TableSize_;
+  } else if (after.Compactions_ != before.Compactions_) {
+    outlier.Cause_ = CAUSE_COMPACTION;
+    outlier.Detail_ = after.Repacked_ - before.Repacked_;
+  }
+
+  latencies.All_.record(outlier.Nanoseconds_);
+  latencies.Causes_[outlier.Cause_].record(outlier.Nanoseconds_);
+
+  std::vector<Outlier>& slowest = latencies.Slowest_;
+
+  if (slowest.size() < SLOWEST_KEPT) {
+    slowest.push_back(outlier);
+    std::push_heap(slowest.begin(), slowest.end(), IsSlower);
+  } else if (IsSlower(outlier, slowest.front())) {
+    std::pop_heap(slowest.begin(), slowest.end(), IsSlower);
+    slowest.back() = outlier;
+    std::push_heap(slowest.begin(), slowest.end(), IsSlower);
+  }
+}
+
+/**
+ * @brief Writes what was measured for an operation type as a JSON object.
+ *
+ * @param out Where to write.
+ * @param latencies What was measured.
+ */
+void WriteLatencies(std::ostream& out, OpLatencies& latencies) {
+  const std::uint64_t threshold = latencies.All_.percentile(99.9);
+
+  out << "{\"all\": ";
+  latencies.All_.write(out);
+
+  for (unsigned cause = 0; cause < CAUSE_COUNT; cause++) {
+    out << ",\n        \"" << CAUSE_NAMES[cause] << "\": ";
+    latencies.Causes_[cause].write(out);
+  }
+
+  // Operations slower than the p99.9 of their type, by cause.
+  out << ",\n        \"outliers\": {\"threshold_ns\": " << threshold;
+
+  for (unsigned cause = 0; cause < CAUSE_COUNT; cause++) {
+    out << ", \"" << CAUSE_NAMES[cause]
+        << "\": " << latencies.Causes_[cause].count_above(threshold);
+  }
+
+  out << "},\n        \"slowest\": [";
+
+  std::sort_heap(
+    latencies.Slowest_.begin(),
+    latencies.Slowest_.end(),
+    IsSlower
+  );
+
+  for (std::size_t i = 0; i < latencies.Slowest_.size(); i++) {
+    const Outlier& outlier = latencies.Slowest_[i];
+
+    out << (i == 0 ? "" : ", ") << "{\"ns\": " << outlier.Nanoseconds_
+        << ", \"cause\": \"" << CAUSE_NAMES[outlier.Cause_] << "\"";
+
+    if (outlier.Cause_ == CAUSE_EXPANSION) {
+      out << ", \"table_size\": " << outlier.Detail_;
+    } else if (outlier.Cause_ == CAUSE_COMPACTION) {
+      out << ", \"repacked\": " << outlier.Detail_;
+    }
+
+    out << "}";
+  }
+
+  out << "]}";
+}
+
+/**
+ * @brief Inserts, finds and removes every key with a policy and writes the
+ * latencies as a JSON object.
+ *
+ * @param Options What the user asked for.
+ * @param Policy The deletion policy.
+ * @param hits The keys that are inserted.
+ * @param misses The keys that are looked up but never inserted.
+ * @param out Where to write.
+ */
+void RunPolicy(
+  const LatencyOptions& Options,
+  OAHTDeletionPolicy Policy,
+  const BenchKeys& hits,
+  const BenchKeys& misses,
+  std::ostream& out
+) {
+  Table table(Table::OAHTConfig(
+    INITIAL_TABLE_SIZE,
+    Options.Primary_,
+    Options.Secondary_,
+    Options.LoadFactor_,
+    Options.GrowthFactor_,
+    Policy
+  ));
+
+  std::vector<OpLatencies> latencies(OP_COUNT);
+  volatile int sink = 0;
+  std::string error;
+
+  out << "    {\"policy\": \"" << (Policy == MARK ? "MARK" : "PACK")
+      << "\", \"size\": " << Options.Size_;
+
+  try {
+    for (std::size_t i = 0; i < Options.Size_; i++) {
+      Measure(table, latencies[OP_INSERT], [&] {
+        table.insert(hits[i], 0);
+      });
+    }
+
+    for (std::size_t i = 0; i < Options.Size_; i++) {
+      Measure(table, latencies[OP_FIND_HIT], [&] {
+        sink = sink + table.find(hits[i]);
+      });
+    }
+
+    for (std::size_t i = 0; i < std::min(Options.Size_, MAX_MISS_OPS); i++) {
+      Measure(table, latencies[OP_FIND_MISS], [&] {
+        try {
+          sink = sink + table.find(misses[i]);
+        } catch (const OAHashTableException&) {
+          // The miss is what is being measured.
+        }
+      });
+    }
+
+    for (std::size_t i = 0; i < Options.Size_; i++) {
+      Measure(table, latencies[OP_REMOVE], [&] {
+        table.remove(hits[i]);
+      });
+    }
+  } catch (const OAHashTableException& exception) {
+    error = exception.what();
+  }
+
+  if (!error.empty()) {
+    out << ", \"error\": ";
+    WriteJsonString(out, error.c_str());
+  }
+
+  out << ",\n      \"ops\": {";
+
+  for (unsigned op = 0; op < OP_COUNT; op++) {
+    out << (op == 0 ? "\n" : ",\n") << "      \"" << OP_NAMES[op] << "\": ";
+    WriteLatencies(out, latencies[op]);
+  }
+
+  out << "}}";
+}
+
+/**
+ * @brief Prints how to use the tool and exits.
+ *
+ * @param Program The name of the program.
+ */
+void Usage(const char* Program) {
+  std::cerr << "Usage: " << Program << " [--size N] [--policies MARK,PACK]"
+            << " [--primary HASH] [--secondary HASH] [--load-factor LF]"
+            << " [--growth-factor GF]\n";
+  std::exit(1);
+}
+
+/**
+ * @brief Finds a hash function by name, or exits.
+ *
+ * @param Label The name.
+ * @param Program The name of the program, for the usage.
+ * @return The hash function.
+ */
+HASHFUNC GetHash(const char* Label, const char* Program) {
+  const int hash = FindHashingFunc(Label);
+
+  if (hash < 0) {
+    Usage(Program);
+  }
+
+  return HashingFuncs[hash].Fn;
+}
+
+/**
+ * @brief Reads the command line.
+ *
+ * @param argc The amount of arguments.
+ * @param argv The arguments.
+ * @return The options.
+ */
+LatencyOptions ParseOptions(int argc, char** argv) {
+  LatencyOptions options;
+
+  for (int i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+    }
+
+    const std::string option = argv[i];
+    const std::string value = argv[i + 1];
+
+    if (option == "--size") {
+      options.Size_ = std::strtoul(value.c_str(), nullptr, 10);
+    } else if (option == "--policies") {
+      options.Policies_.clear();
+
+      if (value.find("MARK") != std::string::npos) {
+        options.Policies_.push_back(MARK);
+      }
+      if (value.find("PACK") != std::string::npos) {
+        options.Policies_.push_back(PACK);
+      }
+      if (options.Policies_.empty()) {
+        Usage(argv[0]);
+      }
+    } else if (option == "--primary") {
+      options.Primary_ = GetHash(value.c_str(), argv[0]);
+
+      if (options.Primary_ == nullptr) {
+        Usage(argv[0]);
+      }
+    } else if (option == "--secondary") {
+      options.Secondary_ = GetHash(value.c_str(), argv[0]);
+    } else if (option == "--load-factor") {
+      options.LoadFactor_ = std::strtod(value.c_str(), nullptr);
+    } else if (option == "--growth-factor") {
+      options.GrowthFactor_ = std::strtod(value.c_str(), nullptr);
+    } else {
+      Usage(argv[0]);
+    }
+  }
+
+  return options;
+}
+
+int main(int argc, char** argv) {
+  const LatencyOptions options = ParseOptions(argc, argv);
+  const BenchKeys hits(0, options.Size_);
+  const BenchKeys misses(options.Size_, options.Size_);
+
+  std::cout << "{\n  \"benchmark\": \"latency\", \"ns_per_tick\": "
+            << GetNanosecondsPerTick() << ",\n  \"results\": [\n";
+
+  for (std::size_t i = 0; i < options.Policies_.size(); i++) {
+    if (i != 0) {
+      std::cout << ",\n";
+    }
+
+    RunPolicy(options, options.Policies_[i], hits, misses, std::cout);
+  }
+
+  std::cout << "\n  ]\n}\n";
+
+  return 0;
+}
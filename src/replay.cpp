@@ -0,0 +1,343 @@
+/**
+ * @file replay.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Drives a table from a trace recorded with OATracedTable and writes
+ * the results as JSON: the time it took, the stats of the table and how many
+ * operations ended differently than when they were recorded.
+ *
+ * Usage: replay TRACE [options]
+ * - `--engine` The engine to drive (default oa_full, see ENGINES).
+ * - `--rate max|recorded` Replay as fast as possible (default) or keeping the
+ * recorded time between operations.
+ * - `--size N` The initial table size (default 97).
+ * - `--primary` and `--secondary` Hash functions from HASHFUNCS (default PJW
+ * and NONE).
+ * - `--policy MARK|PACK` The deletion policy (default PACK).
+ * - `--load-factor LF` and `--growth-factor GF` (default 0.5 and 2).
+ * - `--record N` First record N made up operations on the engine to TRACE
+ * (through OATracedTable), then replay them. Fails if any of them ends
+ * differently the second time.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "Bench.h"
+#include "BenchEngines.h"
+#include "HashFuncs.h"
+#include "OATrace.h"
+#include "OATracedTable.h"
+
+/**
+ * @brief How to replay.
+ */
+struct ReplayOptions {
+  const char* Trace_{nullptr}; //!< The trace file
+  bool Recorded_{false};       //!< Keep the recorded rate
+  std::size_t Record_{0};      //!< Operations to record first (0 for none)
+};
+
+/**
+ * @brief Runs an operation and returns how it ended.
+ *
+ * @param engine The table.
+ * @param Record The operation.
+ * @return The outcome.
+ */
+template<typename Engine>
+OATraceOutcome Replay(Engine& engine, const OATraceRecord& Record) {
+  static volatile BenchValue sink = 0;
+
+  try {
+    switch (Record.Op_) {
+      case TRACE_INSERT: engine.insert(Record.Key_, 0); break;
+      case TRACE_FIND: sink = sink + engine.find(Record.Key_); break;
+      case TRACE_REMOVE: engine.remove(Record.Key_); break;
+      case TRACE_CLEAR: engine.clear(); break;
+    }
+  } catch (const OAHashTableException& exception) {
+    switch (exception.code()) {
+      case OAHashTableException::E_ITEM_NOT_FOUND: return TRACE_NOT_FOUND;
+      case OAHashTableException::E_DUPLICATE: return TRACE_DUPLICATE;
+      default: return TRACE_FAILED;
+    }
+  }
+
+  return TRACE_OK;
+}
+
+/**
+ * @brief Records a made up workload on an engine: inserts (some of them
+ * duplicates), finds that hit and miss, removes and a clear halfway through.
+ *
+ * @param Options Where to record and how many operations.
+ * @param Config The configuration of the engine.
+ * @return Whether the whole trace was written.
+ */
+template<typename Engine>
+bool RecordTrace(const ReplayOptions& Options, const EngineConfig& Config) {
+  static volatile BenchValue sink = 0;
+
+  OATraceWriter writer(Options.Trace_);
+  Engine engine(Config);
+  OATracedTable<Engine> traced(engine, writer);
+
+  const std::size_t ops = Options.Record_;
+  const BenchKeys keys(0, ops / 4 + 1);
+  unsigned random = 280;
+
+  for (std::size_t i = 0; i < ops; i++) {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+
+    const char* key = keys[(random >> 4) % keys.size()];
+    const unsigned roll = random % 10;
+
+    // The failures are part of the trace, the wrapper records them.
+    try {
+      if (i == ops / 2) {
+        traced.clear();
+      } else if (roll < 4) {
+        traced.insert(key, 0);
+      } else if (roll < 8) {
+        sink = sink + traced.find(key);
+      } else {
+        traced.remove(key);
+      }
+    } catch (const OAHashTableException&) {}
+  }
+
+  writer.flush();
+  return writer.good();
+}
+
+/**
+ * @brief Replays the whole trace on an engine and writes the results as the
+ * members of a JSON object.
+ *
+ * @param Options How to replay.
+ * @param Config The configuration of the engine.
+ * @param out Where to write.
+ * @return Whether the trace could be read to the end (and replayed the same
+ * way, if it was just recorded).
+ */
+template<typename Engine>
+bool ReplayEngine(
+  const ReplayOptions& Options,
+  const EngineConfig& Config,
+  std::ostream& out
+) {
+  if (Options.Record_ != 0 && !RecordTrace<Engine>(Options, Config)) {
+    return false;
+  }
+
+  OATraceReader reader(Options.Trace_);
+
+  if (!reader.good()) {
+    return false;
+  }
+
+  Engine engine(Config);
+  OATraceRecord record;
+  std::size_t ops[TRACE_CLEAR + 1] = {};
+  std::size_t mismatches = 0;
+  std::chrono::nanoseconds offset(0);
+
+  const std::uint64_t probes = engine.GetStats().Probes_;
+  const std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  while (reader.next(record)) {
+    if (Options.Recorded_) {
+      offset += std::chrono::nanoseconds(record.Delta_);
+      std::this_thread::sleep_until(start + offset);
+    }
+
+    if (Replay(engine, record) != record.Outcome_) {
+      mismatches++;
+    }
+
+    ops[record.Op_]++;
+  }
+
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  const OAHTStats stats = engine.GetStats();
+
+  BenchResult result;
+  result.Seconds_ = elapsed.count();
+  result.Probes_ = stats.Probes_ - probes;
+
+  for (std::size_t count : ops) {
+    result.Ops_ += count;
+  }
+
+  out << "\"inserts\": " << ops[TRACE_INSERT]
+      << ", \"finds\": " << ops[TRACE_FIND]
+      << ", \"removes\": " << ops[TRACE_REMOVE]
+      << ", \"clears\": " << ops[TRACE_CLEAR] << ",\n  \"replay\": ";
+  WriteBenchResult(out, result);
+  out << ",\n  \"mismatches\": " << mismatches
+      << ", \"count\": " << stats.Count_
+      << ", \"table_size\": " << stats.TableSize_
+      << ", \"expansions\": " << stats.Expansions_;
+
+  // The engine is deterministic, a trace it just recorded must match.
+  return reader.good() && (Options.Record_ == 0 || mismatches == 0);
+}
+
+/**
+ * @brief An engine that can be replayed on.
+ */
+struct ReplayEngineEntry {
+  const char* Name_; //!< Name on the command line
+
+  //! Replays on the engine
+  bool (*Run_)(const ReplayOptions&, const EngineConfig&, std::ostream&);
+};
+
+//! Every engine, add new engine modes here.
+const ReplayEngineEntry ENGINES[] = {
+  {"oa_full",       ReplayEngine<OAEngine<OAFullInstrumentation>>   },
+  {"oa_sampled",    ReplayEngine<OAEngine<OASampledInstrumentation>>},
+  {"oa_none",       ReplayEngine<OAEngine<OANoInstrumentation>>     },
+  {"unordered_map", ReplayEngine<UnorderedMapEngine>                },
+  {"oa_interleave", ReplayEngine<InterleavedEngine>                 },
+  {"sharded",       ReplayEngine<ShardedEngine>                     },
+  {"replicated",    ReplayEngine<ReplicatedEngine>                  },
+  {"seqlock",       ReplayEngine<SeqlockEngine>                     },
+  {"snapshot",      ReplayEngine<SnapshotEngine>                    },
+  {"lockfree",      ReplayEngine<LockFreeEngine>                    }
+};
+
+/**
+ * @brief Prints how to use the tool and exits.
+ *
+ * @param Program The name of the program.
+ */
+void Usage(const char* Program) {
+  std::cerr << "Usage: " << Program << " TRACE [--engine NAME]"
+            << " [--rate max|recorded] [--size N] [--primary HASH]"
+            << " [--secondary HASH] [--policy MARK|PACK]"
+            << " [--load-factor LF] [--growth-factor GF] [--record N]"
+            << "\nEngines:";
+
+  for (const ReplayEngineEntry& engine : ENGINES) {
+    std::cerr << " " << engine.Name_;
+  }
+
+  std::cerr << "\n";
+  std::exit(1);
+}
+
+/**
+ * @brief Finds a hash function by name, or exits.
+ *
+ * @param Label The name.
+ * @param Program The name of the program, for the usage.
+ * @return The hash function.
+ */
+HASHFUNC GetHash(const char* Label, const char* Program) {
+  const int hash = FindHashingFunc(Label);
+
+  if (hash < 0) {
+    Usage(Program);
+  }
+
+  return HashingFuncs[hash].Fn;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    Usage(argv[0]);
+  }
+
+  ReplayOptions options;
+  options.Trace_ = argv[1];
+
+  const ReplayEngineEntry* engine = &ENGINES[0];
+  EngineConfig config(97, PJWHash, 0, 0.5, 2.0, PACK);
+
+  for (int i = 2; i < argc; i += 2) {
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+    }
+
+    const std::string option = argv[i];
+    const char* value = argv[i + 1];
+
+    if (option == "--engine") {
+      engine = nullptr;
+
+      for (const ReplayEngineEntry& entry : ENGINES) {
+        if (std::strcmp(value, entry.Name_) == 0) {
+          engine = &entry;
+        }
+      }
+
+      if (engine == nullptr) {
+        Usage(argv[0]);
+      }
+    } else if (option == "--rate") {
+      if (std::strcmp(value, "max") != 0
+          && std::strcmp(value, "recorded") != 0) {
+        Usage(argv[0]);
+      }
+      options.Recorded_ = std::strcmp(value, "recorded") == 0;
+    } else if (option == "--size") {
+      config.InitialTableSize_ = static_cast<std::size_t>(
+        GetClosestPrime64(std::strtoull(value, nullptr, 10))
+      );
+    } else if (option == "--primary") {
+      config.PrimaryHashFunc_ = GetHash(value, argv[0]);
+
+      if (config.PrimaryHashFunc_ == nullptr) {
+        Usage(argv[0]);
+      }
+    } else if (option == "--secondary") {
+      config.SecondaryHashFunc_ = GetHash(value, argv[0]);
+    } else if (option == "--policy") {
+      if (std::strcmp(value, "MARK") != 0 && std::strcmp(value, "PACK") != 0) {
+        Usage(argv[0]);
+      }
+      config.DeletionPolicy_ = std::strcmp(value, "MARK") == 0 ? MARK : PACK;
+    } else if (option == "--load-factor") {
+      config.MaxLoadFactor_ = std::strtod(value, nullptr);
+    } else if (option == "--growth-factor") {
+      config.GrowthFactor_ = std::strtod(value, nullptr);
+    } else if (option == "--record") {
+      options.Record_ = std::strtoull(value, nullptr, 10);
+    } else {
+      Usage(argv[0]);
+    }
+  }
+
+  if (options.Record_ == 0 && !OATraceReader(options.Trace_).good()) {
+    std::cerr << options.Trace_ << " is not a trace\n";
+    return 1;
+  }
+
+  std::cout << "{\"engine\": \"" << engine->Name_ << "\", \"rate\": \""
+            << (options.Recorded_ ? "recorded" : "max") << "\",\n  ";
+
+  const bool complete = engine->Run_(options, config, std::cout);
+
+  std::cout << ", \"complete\": " << (complete ? "true" : "false") << "}\n";
+
+  if (!complete) {
+    std::cerr << "Couldn't read all of " << options.Trace_
+              << (options.Record_ != 0 ? ", or it didn't replay the same\n"
+                                       : "\n");
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file statictable.cpp
+ * @author Edgar Jose Donoso Mansilla (e.donosomansilla)
+ * @course CS280
+ * @term Spring 2025
+ *
+ * @brief Checks OAStaticHashTable and GetConstexprClosestPrime. Most of the
+ * checks are static_asserts, so building this file is the test. The rest
+ * compare the compile time primes with GetClosestPrime and run with ctest.
+ *
+ * Prints what went wrong and exits with 1 if a check fails.
+ */
+
+#include <cstdint>
+#include <iostream>
+
+#include "OAStaticHashTable.h"
+#include "Support.h"
+
+//! The pairs of the table built at compile time
+constexpr OAStaticEntry<int> COLORS[] = {
+  {"red",     1},
+  {"green",   2},
+  {"blue",    3},
+  {"cyan",    4},
+  {"magenta", 5},
+  {"yellow",  6},
+  {"a key longer than MAX_KEYLEN, so it's cut", 7}
+};
+
+//! Built by the compiler, lives in read-only data
+constexpr auto COLOR_TABLE = MakeStaticTable(COLORS);
+
+static_assert(COLOR_TABLE.size() == 7, "every pair is counted");
+static_assert(decltype(COLOR_TABLE)::TableSize_ == 17, "the prime after 15");
+static_assert(COLOR_TABLE.find("red") == 1, "first key");
+static_assert(COLOR_TABLE.find("magenta") == 5, "middle key");
+static_assert(COLOR_TABLE.find("yellow") == 6, "last short key");
+static_assert(
+  COLOR_TABLE.find("a key longer than MAX_KEYLEN, so it's cut") == 7,
+  "a long key is found by its first MAX_KEYLEN - 1 characters"
+);
+
+static_assert(GetConstexprClosestPrime(0) == 2, "below the first prime");
+static_assert(GetConstexprClosestPrime(2) == 2, "the even prime");
+static_assert(GetConstexprClosestPrime(4484) == 4493, "67^2 isn't prime");
+static_assert(
+  GetConstexprClosestPrime(4294967290u) == 4294967291u,
+  "the largest 32 bit prime"
+);
+
+//! Every value up to this is compared with GetClosestPrime
+const unsigned DENSE_LIMIT = 1u << 20;
+
+//! Values spread over the rest of the 32 bit range that are compared too
+const unsigned SPARSE_SAMPLES = 2000;
+
+int main() {
+  bool failed = false;
+
+  try {
+    COLOR_TABLE.find("purple");
+    std::cerr << "FAILED: a missing key was found" << std::endl;
+    failed = true;
+  } catch (const OAHashTableException& exception) {
+    if (exception.code() != OAHashTableException::E_ITEM_NOT_FOUND) {
+      std::cerr << "FAILED: wrong exception for a missing key" << std::endl;
+      failed = true;
+    }
+  }
+
+  // There is no larger 32 bit prime, the values above it are clamped.
+  for (unsigned value = 4294967291u; value != 0; value++) {
+    if (GetClosestPrime(value) != 4294967291u) {
+      std::cerr << "FAILED: GetClosestPrime(" << value << ") is "
+                << GetClosestPrime(value) << std::endl;
+      failed = true;
+    }
+  }
+
+  unsigned random = 4484;
+
+  for (unsigned i = 2; i < DENSE_LIMIT + SPARSE_SAMPLES; i++) {
+    unsigned value = i;
+
+    // Past the largest 32 bit prime there is no closest prime to agree on.
+    if (i >= DENSE_LIMIT) {
+      random ^= random << 13;
+      random ^= random >> 17;
+      random ^= random << 5;
+      value = random % 4294967291u;
+    }
+
+    if (value >= 2
+        && GetClosestPrime(value) != GetConstexprClosestPrime(value)) {
+      std::cerr << "FAILED: GetClosestPrime(" << value << ") is "
+                << GetClosestPrime(value) << ", not "
+                << GetConstexprClosestPrime(value) << std::endl;
+      failed = true;
+    }
+  }
+
+  return failed ? 1 : 0;
+}